@@ -111,6 +111,18 @@ GpgME::Data::Data(int fd)
     d.reset(new Private(e ? nullptr : data));
 }
 
+GpgME::Error GpgME::Data::createPipe(Data &writer, Data &reader)
+{
+    gpgme_data_t w, r;
+    const gpgme_error_t e = gpgme_data_new_pipe(&w, &r);
+    if (e) {
+        return Error(e);
+    }
+    writer = Data(w);
+    reader = Data(r);
+    return Error();
+}
+
 GpgME::Data::Data(DataProvider *dp)
 {
     d.reset(new Private);
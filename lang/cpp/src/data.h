@@ -58,6 +58,12 @@ public:
     // Callback-Based Data Buffers:
     explicit Data(DataProvider *provider);
 
+    /** Create a pipe and store data objects for its ends in @p writer
+     * and @p reader.  The output of one operation written to @p writer
+     * can be read as input by another operation running concurrently.
+     * Each end may only be used for one operation.  */
+    static Error createPipe(Data &writer, Data &reader);
+
     static const Null null;
 
     const Data &operator=(Data other)
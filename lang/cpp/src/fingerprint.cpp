@@ -0,0 +1,72 @@
+/* fingerprint.cpp - binary key fingerprints
+  Copyright (C) 2021 g10 Code GmbH
+  This file is part of GPGME++.
+
+  GPGME++ is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  GPGME++ is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with GPGME++; see the file COPYING.LIB.  If not, write to the
+  Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+
+#ifdef HAVE_CONFIG_H
+ #include "config.h"
+#endif
+
+#include "fingerprint.h"
+
+using namespace GpgME;
+
+// maps a hex digit to its value and everything else to -1
+static const signed char hexvals[256] = {
+#define X16 -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+    X16, X16, X16,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    X16,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    X16, X16, X16, X16, X16, X16, X16, X16, X16
+#undef X16
+};
+
+Fingerprint::Fingerprint(const char *hex)
+    : mSize(0)
+{
+    if (!hex) {
+        return;
+    }
+    const std::size_t len = std::strlen(hex);
+    if (len != 32 && len != 40 && len != 64) {
+        return;
+    }
+    for (std::size_t i = 0; i < len; i += 2) {
+        const int hi = hexvals[static_cast<unsigned char>(hex[i])];
+        const int lo = hexvals[static_cast<unsigned char>(hex[i + 1])];
+        if (hi < 0 || lo < 0) {
+            return;
+        }
+        mData[i / 2] = static_cast<unsigned char>(hi << 4 | lo);
+    }
+    mSize = len / 2;
+}
+
+std::string Fingerprint::toString() const
+{
+    static const char digits[] = "0123456789ABCDEF";
+    std::string result;
+    result.reserve(2 * mSize);
+    for (unsigned int i = 0; i < mSize; ++i) {
+        result += digits[mData[i] >> 4];
+        result += digits[mData[i] & 15];
+    }
+    return result;
+}
@@ -0,0 +1,117 @@
+/*
+  fingerprint.h - binary key fingerprints
+  Copyright (C) 2021 g10 Code GmbH
+
+  This file is part of GPGME++.
+
+  GPGME++ is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  GPGME++ is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with GPGME++; see the file COPYING.LIB.  If not, write to the
+  Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+
+#ifndef __GPGMEPP_FINGERPRINT_H__
+#define __GPGMEPP_FINGERPRINT_H__
+
+#include "gpgmepp_export.h"
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <string>
+
+namespace GpgME
+{
+
+/**
+ * A fingerprint in binary form.
+ *
+ * Comparing, ordering and hashing a Fingerprint is much cheaper than
+ * doing the same with the hex string.  The order is the same as that
+ * of the upper case hex strings used by gpgme.
+ */
+class GPGMEPP_EXPORT Fingerprint
+{
+public:
+    /** Creates a null fingerprint. */
+    Fingerprint() : mSize(0) {}
+
+    /** Creates a fingerprint from the hex string @p hex.  The result
+     * is null unless @p hex has 32 (MD5, v3 keys), 40 (SHA-1) or 64
+     * (SHA-256) hex digits. */
+    explicit Fingerprint(const char *hex);
+    explicit Fingerprint(const std::string &hex) : Fingerprint(hex.c_str()) {}
+
+    bool isNull() const
+    {
+        return !mSize;
+    }
+
+    /** The number of bytes, i.e. 0, 16, 20 or 32. */
+    unsigned int size() const
+    {
+        return mSize;
+    }
+
+    const unsigned char *data() const
+    {
+        return mData;
+    }
+
+    /** The fingerprint as upper case hex string. */
+    std::string toString() const;
+
+    std::size_t hash() const
+    {
+        // the bytes of a fingerprint are uniformly distributed
+        std::size_t h = 0;
+        std::memcpy(&h, mData, mSize < sizeof h ? mSize : sizeof h);
+        return h;
+    }
+
+    bool operator==(const Fingerprint &other) const
+    {
+        return mSize == other.mSize && !std::memcmp(mData, other.mData, mSize);
+    }
+
+    bool operator!=(const Fingerprint &other) const
+    {
+        return !operator==(other);
+    }
+
+    bool operator<(const Fingerprint &other) const
+    {
+        const int cmp = std::memcmp(mData, other.mData,
+                                    mSize < other.mSize ? mSize : other.mSize);
+        return cmp < 0 || (!cmp && mSize < other.mSize);
+    }
+
+private:
+    unsigned char mSize;
+    unsigned char mData[32];
+};
+
+} // namespace GpgME
+
+namespace std
+{
+template <>
+struct hash<GpgME::Fingerprint> {
+    std::size_t operator()(const GpgME::Fingerprint &fpr) const
+    {
+        return fpr.hash();
+    }
+};
+}
+
+#endif // __GPGMEPP_FINGERPRINT_H__
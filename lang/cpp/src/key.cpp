@@ -299,6 +299,11 @@ const char *Key::primaryFingerprint() const
     return nullptr;
 }
 
+Fingerprint Key::fingerprint() const
+{
+    return Fingerprint(primaryFingerprint());
+}
+
 unsigned int Key::keyListMode() const
 {
     return key ? convert_from_gpgme_keylist_mode_t(key->keylist_mode) : 0;
@@ -398,6 +403,8 @@ Key Key::locate(const char *mbox)
     }
 
     ctx->setKeyListMode (Extern | Local);
+    // Only the first key is used; stop the engine right after it.
+    ctx->setFlag("keylist-limit", "1");
 
     Error e = ctx->startKeyListing (mbox);
     auto ret = ctx->nextKey (e);
@@ -615,6 +622,17 @@ static gpgme_user_id_t verify_uid(const shared_gpgme_key_t &key, gpgme_user_id_t
     return nullptr;
 }
 
+// the signatures of a key listed with the "lazy-key-sigs" flag are
+// parsed on first use, hence don't access uid->signatures directly
+static gpgme_key_sig_t uid_signatures(const shared_gpgme_key_t &key, gpgme_user_id_t uid)
+{
+    gpgme_key_sig_t sigs = nullptr;
+    if (key && uid && gpgme_key_get_signatures(key.get(), uid, &sigs)) {
+        return nullptr;
+    }
+    return sigs;
+}
+
 UserID::UserID() : key(), uid(nullptr) {}
 
 UserID::UserID(const shared_gpgme_key_t &k, gpgme_user_id_t u)
@@ -645,7 +663,7 @@ unsigned int UserID::numSignatures() const
         return 0;
     }
     unsigned int count = 0;
-    for (gpgme_key_sig_t sig = uid->signatures ; sig ; sig = sig->next) {
+    for (gpgme_key_sig_t sig = uid_signatures(key, uid) ; sig ; sig = sig->next) {
         ++count;
     }
     return count;
@@ -659,7 +677,7 @@ std::vector<UserID::Signature> UserID::signatures() const
 
     std::vector<Signature> v;
     v.reserve(numSignatures());
-    for (gpgme_key_sig_t sig = uid->signatures ; sig ; sig = sig->next) {
+    for (gpgme_key_sig_t sig = uid_signatures(key, uid) ; sig ; sig = sig->next) {
         v.push_back(Signature(key, uid, sig));
     }
     return v;
@@ -740,14 +758,15 @@ TofuInfo UserID::tofuInfo() const
     return TofuInfo(uid->tofu);
 }
 
-static gpgme_key_sig_t find_last_valid_sig_for_keyid (gpgme_user_id_t uid,
+static gpgme_key_sig_t find_last_valid_sig_for_keyid (const shared_gpgme_key_t &key,
+                                                      gpgme_user_id_t uid,
                                                       const char *keyid)
 {
     if (!keyid) {
         return nullptr;
     }
     gpgme_key_sig_t ret = NULL;
-    for (gpgme_key_sig_t s = uid->signatures ; s ; s = s->next) {
+    for (gpgme_key_sig_t s = uid_signatures(key, uid) ; s ; s = s->next) {
         if (s->keyid && !strcmp(keyid, s->keyid)) {
             if (!s->expired && !s->revoked && !s->invalid && !s->status) {
                 if (!ret) {
@@ -780,7 +799,7 @@ const char *UserID::remark(const Key &remarker, Error &err) const
         return nullptr;
     }
 
-    gpgme_key_sig_t s = find_last_valid_sig_for_keyid(uid, remarker.keyID());
+    gpgme_key_sig_t s = find_last_valid_sig_for_keyid(key, uid, remarker.keyID());
 
     if (!s) {
         return nullptr;
@@ -816,10 +835,10 @@ std::vector<std::string> UserID::remarks(std::vector<Key> keys, Error &err) cons
 //
 //
 
-static gpgme_key_sig_t find_signature(gpgme_user_id_t uid, unsigned int idx)
+static gpgme_key_sig_t find_signature(const shared_gpgme_key_t &key, gpgme_user_id_t uid, unsigned int idx)
 {
     if (uid) {
-        for (gpgme_key_sig_t s = uid->signatures ; s ; s = s->next, --idx) {
+        for (gpgme_key_sig_t s = uid_signatures(key, uid) ; s ; s = s->next, --idx) {
             if (idx == 0) {
                 return s;
             }
@@ -828,10 +847,10 @@ static gpgme_key_sig_t find_signature(gpgme_user_id_t uid, unsigned int idx)
     return nullptr;
 }
 
-static gpgme_key_sig_t verify_signature(gpgme_user_id_t uid, gpgme_key_sig_t sig)
+static gpgme_key_sig_t verify_signature(const shared_gpgme_key_t &key, gpgme_user_id_t uid, gpgme_key_sig_t sig)
 {
     if (uid) {
-        for (gpgme_key_sig_t s = uid->signatures ; s ; s = s->next) {
+        for (gpgme_key_sig_t s = uid_signatures(key, uid) ; s ; s = s->next) {
             if (s == sig) {
                 return sig;
             }
@@ -840,11 +859,11 @@ static gpgme_key_sig_t verify_signature(gpgme_user_id_t uid, gpgme_key_sig_t sig
     return nullptr;
 }
 
-static int signature_index(gpgme_user_id_t uid, gpgme_key_sig_t sig)
+static int signature_index(const shared_gpgme_key_t &key, gpgme_user_id_t uid, gpgme_key_sig_t sig)
 {
     if (uid) {
         int i = 0;
-        for (gpgme_key_sig_t s = uid->signatures ; s ; s = s->next, ++i) {
+        for (gpgme_key_sig_t s = uid_signatures(key, uid) ; s ; s = s->next, ++i) {
             if (s == sig) {
                 return i;
             }
@@ -856,12 +875,12 @@ static int signature_index(gpgme_user_id_t uid, gpgme_key_sig_t sig)
 UserID::Signature::Signature() : key(), uid(nullptr), sig(nullptr) {}
 
 UserID::Signature::Signature(const shared_gpgme_key_t &k, gpgme_user_id_t u, unsigned int idx)
-    : key(k), uid(verify_uid(k, u)), sig(find_signature(uid, idx))
+    : key(k), uid(verify_uid(k, u)), sig(find_signature(key, uid, idx))
 {
 }
 
 UserID::Signature::Signature(const shared_gpgme_key_t &k, gpgme_user_id_t u, gpgme_key_sig_t s)
-    : key(k), uid(verify_uid(k, u)), sig(verify_signature(uid, s))
+    : key(k), uid(verify_uid(k, u)), sig(verify_signature(key, uid, s))
 {
 }
 
@@ -915,7 +934,7 @@ bool UserID::Signature::operator<(const Signature &other) const
     }
 
     // to make the sort stable we compare the indexes of the signatures as last resort
-    return signature_index(uid, sig) < signature_index(uid, other.sig);
+    return signature_index(key, uid, sig) < signature_index(key, uid, other.sig);
 }
 
 UserID UserID::Signature::parent() const
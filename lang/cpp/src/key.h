@@ -26,6 +26,7 @@
 
 #include "global.h"
 #include "notation.h"
+#include "fingerprint.h"
 
 #include "gpgmefw.h"
 
@@ -149,6 +150,10 @@ public:
     const char *shortKeyID() const;
     const char *primaryFingerprint() const;
 
+    /*! The primary fingerprint in binary form.  Prefer it over
+     * primaryFingerprint() for comparing, sorting or hashing keys. */
+    Fingerprint fingerprint() const;
+
     unsigned int keyListMode() const;
 
     /*! Update information about this key.
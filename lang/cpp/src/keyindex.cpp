@@ -0,0 +1,206 @@
+/* keyindex.cpp - a hash map of keys by fingerprint
+  Copyright (C) 2021 g10 Code GmbH
+  This file is part of GPGME++.
+
+  GPGME++ is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  GPGME++ is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with GPGME++; see the file COPYING.LIB.  If not, write to the
+  Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+
+#ifdef HAVE_CONFIG_H
+ #include "config.h"
+#endif
+
+#include "keyindex.h"
+
+#include <algorithm>
+
+using namespace GpgME;
+
+// Open addressing with linear probing.  The slots hold the index of
+// an entry plus one, 0 marks an empty slot.  The number of slots is
+// a power of two and at least twice the number of entries.  Entries
+// with a null fingerprint have no slot.
+class KeyIndex::Private
+{
+public:
+    struct Entry {
+        Fingerprint fpr;
+        Key key;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<std::size_t> slots;
+
+    void grow(std::size_t expectedSize)
+    {
+        if (2 * expectedSize <= slots.size()) {
+            return;
+        }
+        std::size_t n = 16;
+        while (n < 2 * expectedSize) {
+            n *= 2;
+        }
+        slots.assign(n, 0);
+        for (std::size_t i = 0; i < entries.size(); ++i) {
+            if (!entries[i].fpr.isNull()) {
+                slots[findSlot(entries[i].fpr)] = i + 1;
+            }
+        }
+    }
+
+    // Returns the slot holding FPR or the empty slot for it.
+    std::size_t findSlot(const Fingerprint &fpr) const
+    {
+        const std::size_t mask = slots.size() - 1;
+        std::size_t i = fpr.hash() & mask;
+        while (slots[i] && entries[slots[i] - 1].fpr != fpr) {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    Entry *find(const Fingerprint &fpr)
+    {
+        if (fpr.isNull() || slots.empty()) {
+            return nullptr;
+        }
+        const std::size_t slot = slots[findSlot(fpr)];
+        return slot ? &entries[slot - 1] : nullptr;
+    }
+
+    void add(const Fingerprint &fpr, const Key &key)
+    {
+        grow(entries.size() + 1);
+        if (!fpr.isNull()) {
+            slots[findSlot(fpr)] = entries.size() + 1;
+        }
+        entries.push_back({fpr, key});
+    }
+};
+
+KeyIndex::KeyIndex()
+    : d(new Private)
+{
+}
+
+KeyIndex::KeyIndex(std::size_t expectedSize)
+    : d(new Private)
+{
+    reserve(expectedSize);
+}
+
+KeyIndex::KeyIndex(const KeyIndex &other)
+    : d(new Private(*other.d))
+{
+}
+
+KeyIndex::~KeyIndex()
+{
+}
+
+void KeyIndex::reserve(std::size_t expectedSize)
+{
+    d->entries.reserve(expectedSize);
+    d->grow(expectedSize);
+}
+
+void KeyIndex::clear()
+{
+    d->entries.clear();
+    std::fill(d->slots.begin(), d->slots.end(), 0);
+}
+
+std::size_t KeyIndex::size() const
+{
+    return d->entries.size();
+}
+
+bool KeyIndex::empty() const
+{
+    return d->entries.empty();
+}
+
+bool KeyIndex::insert(const Key &key)
+{
+    if (key.isNull()) {
+        return false;
+    }
+    const Fingerprint fpr(key.primaryFingerprint());
+    if (d->find(fpr)) {
+        return false;
+    }
+    d->add(fpr, key);
+    return true;
+}
+
+void KeyIndex::merge(const Key &key)
+{
+    if (key.isNull()) {
+        return;
+    }
+    const Fingerprint fpr(key.primaryFingerprint());
+    if (Private::Entry *const entry = d->find(fpr)) {
+        entry->key.mergeWith(key);
+    } else {
+        d->add(fpr, key);
+    }
+}
+
+bool KeyIndex::contains(const Fingerprint &fpr) const
+{
+    return d->find(fpr);
+}
+
+bool KeyIndex::contains(const Key &key) const
+{
+    return contains(Fingerprint(key.primaryFingerprint()));
+}
+
+Key KeyIndex::find(const Fingerprint &fpr) const
+{
+    const Private::Entry *const entry = d->find(fpr);
+    return entry ? entry->key : Key();
+}
+
+std::vector<Key> KeyIndex::keys() const
+{
+    std::vector<Key> result;
+    result.reserve(d->entries.size());
+    for (const auto &entry : d->entries) {
+        result.push_back(entry.key);
+    }
+    return result;
+}
+
+std::vector<Key> KeyIndex::sortedKeys() const
+{
+    std::vector<const Private::Entry *> sorted;
+    sorted.reserve(d->entries.size());
+    for (const auto &entry : d->entries) {
+        sorted.push_back(&entry);
+    }
+    // keys without fingerprint come first in the order they were added
+    std::stable_sort(sorted.begin(), sorted.end(),
+              [](const Private::Entry *lhs, const Private::Entry *rhs) {
+                  return lhs->fpr < rhs->fpr;
+              });
+
+    std::vector<Key> result;
+    result.reserve(sorted.size());
+    for (const auto entry : sorted) {
+        result.push_back(entry->key);
+    }
+    return result;
+}
@@ -0,0 +1,99 @@
+/*
+  keyindex.h - a hash map of keys by fingerprint
+  Copyright (C) 2021 g10 Code GmbH
+  This file is part of GPGME++.
+
+  GPGME++ is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  GPGME++ is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with GPGME++; see the file COPYING.LIB.  If not, write to the
+  Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+
+#ifndef __GPGMEPP_KEYINDEX_H__
+#define __GPGMEPP_KEYINDEX_H__
+
+#include "gpgmepp_export.h"
+
+#include "fingerprint.h"
+#include "key.h"
+
+#include <memory>
+#include <vector>
+
+namespace GpgME
+{
+
+/**
+ * A set of keys indexed by their binary primary fingerprint.
+ *
+ * Use it instead of sorting keys by fingerprint strings to find,
+ * deduplicate or merge keys.  Keys without a valid fingerprint are
+ * kept as they are; they can neither be found nor merged.
+ */
+class GPGMEPP_EXPORT KeyIndex
+{
+public:
+    KeyIndex();
+    /** Creates an index with room for @p expectedSize keys. */
+    explicit KeyIndex(std::size_t expectedSize);
+    KeyIndex(const KeyIndex &other);
+    ~KeyIndex();
+
+    const KeyIndex &operator=(KeyIndex other)
+    {
+        swap(other);
+        return *this;
+    }
+
+    void swap(KeyIndex &other)
+    {
+        using std::swap;
+        swap(this->d, other.d);
+    }
+
+    void reserve(std::size_t expectedSize);
+    void clear();
+
+    std::size_t size() const;
+    bool empty() const;
+
+    /** Adds @p key unless a key with the same fingerprint is in the
+     * index.  Returns true if @p key was added. */
+    bool insert(const Key &key);
+
+    /** Adds @p key or merges it into the key with the same fingerprint
+     * using Key::mergeWith(). */
+    void merge(const Key &key);
+
+    bool contains(const Fingerprint &fpr) const;
+    bool contains(const Key &key) const;
+
+    /** Returns the key with the fingerprint @p fpr or a null key. */
+    Key find(const Fingerprint &fpr) const;
+
+    /** Returns the keys in the order they were added. */
+    std::vector<Key> keys() const;
+
+    /** Returns the keys ordered by fingerprint. */
+    std::vector<Key> sortedKeys() const;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace GpgME
+
+GPGMEPP_MAKE_STD_SWAP_SPECIALIZATION(KeyIndex)
+
+#endif // __GPGMEPP_KEYINDEX_H__
@@ -28,6 +28,13 @@ import { gpgme_error } from './Errors';
 import { GPGME_Message, createMessage } from './Message';
 import { decode, atobArray, Utf8ArrayToStr } from './Helpers';
 
+/**
+ * Counter for the ids of requests. The id is echoed by gpgme-json and
+ * allows to match responses if requests are processed concurrently.
+ * @private
+ */
+let lastRequestId = 0;
+
 /**
  * A Connection handles the nativeMessaging interaction via a port. As the
  * protocol only allows up to 1MB of message sent from the nativeApp to the
@@ -146,10 +153,15 @@ export class Connection{
             return Promise.reject(gpgme_error('MSG_INCOMPLETE'));
         }
         let chunksize = message.chunksize;
+        const requestId = ++lastRequestId;
         const me = this;
         const nativeCommunication = new Promise(function (resolve, reject){
             let answer = new Answer(message);
             let listener = function (msg) {
+                if (msg && msg.hasOwnProperty('id') && msg.id !== requestId){
+                    // A response to another request on this port.
+                    return;
+                }
                 if (!msg){
                     me._connection.onMessage.removeListener(listener);
                     me._connection.disconnect();
@@ -164,7 +176,8 @@ export class Connection{
                         if (msg.more === true){
                             me._connection.postMessage({
                                 'op': 'getmore',
-                                'chunksize': chunksize
+                                'chunksize': chunksize,
+                                'id': requestId
                             });
                         } else {
                             me._connection.onMessage.removeListener(listener);
@@ -180,7 +193,8 @@ export class Connection{
                 }
             };
             me._connection.onMessage.addListener(listener);
-            me._connection.postMessage(message.message);
+            me._connection.postMessage(
+                Object.assign({ 'id': requestId }, message.message));
 
             // check for browser messaging errors after a while
             // (browsers' extension permission checks take some time)
@@ -293,7 +307,8 @@ class Answer{
                 }
                 break;
             }
-            case 'base64': {
+            case 'base64':
+            case 'id': {
                 break;
             }
             case 'msg': {
@@ -656,6 +656,15 @@ _gpg_wrap_gpgme_data_t(gpgme_data_t data)
   return SWIG_NewPointerObj(data, SWIGTYPE_p_gpgme_data, 0);
 }
 
+PyObject *
+_gpg_wrap_gpgme_key_t(gpgme_key_t key)
+{
+  /* See above.  */
+  PyObject* self = NULL;
+  (void) self;
+  return SWIG_NewPointerObj(key, SWIGTYPE_p__gpgme_key, 0);
+}
+
 gpgme_ctx_t
 _gpg_unwrap_gpgme_ctx_t(PyObject *wrapped)
 {
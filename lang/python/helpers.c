@@ -913,6 +913,198 @@ static ssize_t pyDataWriteCb(void *hook, const void *buffer, size_t size)
   return result;
 }
 
+/* Return a memoryview over SIZE bytes at BUFFER.  The view is
+   writable unless READONLY is set.  */
+static PyObject *
+pyMemoryView(void *buffer, size_t size, int readonly)
+{
+  Py_buffer info;
+
+  if (PyBuffer_FillInfo(&info, NULL, buffer, (Py_ssize_t) size, readonly,
+                        PyBUF_CONTIG_RO) < 0)
+    return NULL;
+  return PyMemoryView_FromBuffer(&info);
+}
+
+/* Release the memoryview VIEW so that Python code can not access
+   gpgme's buffer after the callback returned.  The release fails with
+   a BufferError if the callback kept an export of the view.  This is
+   an error of the callback: unless FAILED is set, because an error
+   has already been stashed, the exception is stashed in the wrapper
+   object SELF.  Returns -1 if the view could not be released.  */
+static int
+pyMemoryViewRelease(PyObject *self, PyObject *view, int failed)
+{
+  PyObject *retval;
+
+  if (! view)
+    return 0;
+  retval = PyObject_CallMethod(view, "release", NULL);
+  Py_DECREF(view);
+  if (! retval) {
+    if (failed)
+      PyErr_Clear();
+    else
+      _gpg_stash_callback_exception(self);
+    return -1;
+  }
+  Py_DECREF(retval);
+  return 0;
+}
+
+/* Like pyDataReadCb, but the read callback is given a writable
+   memoryview over BUFFER to store the data and returns the number of
+   bytes stored, just like io.RawIOBase.readinto.  This saves the
+   allocation of a bytes object and a copy for every chunk.  */
+static ssize_t pyDataReadIntoCb(void *hook, void *buffer, size_t size)
+{
+  PyGILState_STATE state = PyGILState_Ensure();
+  ssize_t result;
+  PyObject *pyhook = (PyObject *) hook;
+  PyObject *self = NULL;
+  PyObject *func = NULL;
+  PyObject *dataarg = NULL;
+  PyObject *pyargs = NULL;
+  PyObject *view = NULL;
+  PyObject *retval = NULL;
+
+  assert (PyTuple_Check(pyhook));
+  assert (PyTuple_Size(pyhook) == 5 || PyTuple_Size(pyhook) == 6);
+
+  self = PyTuple_GetItem(pyhook, 0);
+  func = PyTuple_GetItem(pyhook, 1);
+  if (PyTuple_Size(pyhook) == 6) {
+    dataarg = PyTuple_GetItem(pyhook, 5);
+    pyargs = PyTuple_New(2);
+  } else {
+    pyargs = PyTuple_New(1);
+  }
+
+  view = pyMemoryView(buffer, size, 0);
+  if (view == NULL) {
+    Py_DECREF(pyargs);
+    _gpg_stash_callback_exception(self);
+    result = -1;
+    goto leave;
+  }
+  Py_INCREF(view);
+  PyTuple_SetItem(pyargs, 0, view);
+  if (dataarg) {
+    Py_INCREF(dataarg);
+    PyTuple_SetItem(pyargs, 1, dataarg);
+  }
+
+  retval = PyObject_CallObject(func, pyargs);
+  Py_DECREF(pyargs);
+  if (PyErr_Occurred()) {
+    _gpg_stash_callback_exception(self);
+    result = -1;
+    goto leave;
+  }
+
+#if PY_MAJOR_VERSION < 3
+  if (PyInt_Check(retval))
+    result = PyInt_AsSsize_t(retval);
+  else
+#endif
+  if (PyLong_Check(retval))
+    result = PyLong_AsSsize_t(retval);
+  else {
+    PyErr_Format(PyExc_TypeError,
+                 "expected int from read callback, got %s",
+                 retval->ob_type->tp_name);
+    _gpg_stash_callback_exception(self);
+    result = -1;
+    goto leave;
+  }
+
+  if (result < 0 || (size_t) result > size) {
+    PyErr_Format(PyExc_ValueError,
+                 "expected at most %zu bytes from read callback, got %zd",
+                 size, result);
+    _gpg_stash_callback_exception(self);
+    result = -1;
+  }
+
+ leave:
+  if (pyMemoryViewRelease(self, view, result == -1) < 0)
+    result = -1;
+  Py_XDECREF(retval);
+  PyGILState_Release(state);
+  return result;
+}
+
+/* Like pyDataWriteCb, but the write callback is given a read-only
+   memoryview over BUFFER instead of a copy in a bytes object.  */
+static ssize_t pyDataWriteViewCb(void *hook, const void *buffer, size_t size)
+{
+  PyGILState_STATE state = PyGILState_Ensure();
+  ssize_t result;
+  PyObject *pyhook = (PyObject *) hook;
+  PyObject *self = NULL;
+  PyObject *func = NULL;
+  PyObject *dataarg = NULL;
+  PyObject *pyargs = NULL;
+  PyObject *view = NULL;
+  PyObject *retval = NULL;
+
+  assert (PyTuple_Check(pyhook));
+  assert (PyTuple_Size(pyhook) == 5 || PyTuple_Size(pyhook) == 6);
+
+  self = PyTuple_GetItem(pyhook, 0);
+  func = PyTuple_GetItem(pyhook, 2);
+  if (PyTuple_Size(pyhook) == 6) {
+    dataarg = PyTuple_GetItem(pyhook, 5);
+    pyargs = PyTuple_New(2);
+  } else {
+    pyargs = PyTuple_New(1);
+  }
+
+  view = pyMemoryView((void *) buffer, size, 1);
+  if (view == NULL) {
+    Py_DECREF(pyargs);
+    _gpg_stash_callback_exception(self);
+    result = -1;
+    goto leave;
+  }
+  Py_INCREF(view);
+  PyTuple_SetItem(pyargs, 0, view);
+  if (dataarg) {
+    Py_INCREF(dataarg);
+    PyTuple_SetItem(pyargs, 1, dataarg);
+  }
+
+  retval = PyObject_CallObject(func, pyargs);
+  Py_DECREF(pyargs);
+  if (PyErr_Occurred()) {
+    _gpg_stash_callback_exception(self);
+    result = -1;
+    goto leave;
+  }
+
+#if PY_MAJOR_VERSION < 3
+  if (PyInt_Check(retval))
+    result = PyInt_AsSsize_t(retval);
+  else
+#endif
+  if (PyLong_Check(retval))
+    result = PyLong_AsSsize_t(retval);
+  else {
+    PyErr_Format(PyExc_TypeError,
+                 "expected int from write callback, got %s",
+                 retval->ob_type->tp_name);
+    _gpg_stash_callback_exception(self);
+    result = -1;
+  }
+
+ leave:
+  if (pyMemoryViewRelease(self, view, result == -1) < 0)
+    result = -1;
+  Py_XDECREF(retval);
+  PyGILState_Release(state);
+  return result;
+}
+
 /* Set the current position from where the next read or write starts
    in the data object with the handle HOOK to OFFSET, relative to
    WHENCE.  Returns the new offset in bytes from the beginning of the
@@ -1020,35 +1212,183 @@ static void pyDataReleaseCb(void *hook)
   PyGILState_Release(state);
 }
 
+static PyObject *
+data_new_from_cbs(PyObject *self, PyObject *pycbs, gpgme_data_t *r_data,
+                  struct gpgme_data_cbs *cbs)
+{
+  PyGILState_STATE state = PyGILState_Ensure();
+  PyObject *result = NULL;
+  gpgme_error_t err;
+
+  if (! PyTuple_Check(pycbs))
+    {
+      PyErr_Format(PyExc_TypeError, "pycbs must be a tuple");
+      goto leave;
+    }
+  if (PyTuple_Size(pycbs) != 5 && PyTuple_Size(pycbs) != 6)
+    {
+      PyErr_Format(PyExc_TypeError, "pycbs must be a tuple of size 5 or 6");
+      goto leave;
+    }
+
+  err = gpgme_data_new_from_cbs(r_data, cbs, (void *) pycbs);
+  if (err)
+    {
+      _gpg_raise_exception(err);
+      goto leave;
+    }
+
+  PyObject_SetAttrString(self, "_data_cbs", pycbs);
+
+  Py_INCREF(Py_None);
+  result = Py_None;
+
+ leave:
+  PyGILState_Release(state);
+  return result;
+}
+
 PyObject *
 gpg_data_new_from_cbs(PyObject *self,
                        PyObject *pycbs,
                        gpgme_data_t *r_data)
 {
-  PyGILState_STATE state = PyGILState_Ensure();
   static struct gpgme_data_cbs cbs = {
     pyDataReadCb,
     pyDataWriteCb,
     pyDataSeekCb,
     pyDataReleaseCb,
   };
-  gpgme_error_t err;
 
-  if (! PyTuple_Check(pycbs))
-    return PyErr_Format(PyExc_TypeError, "pycbs must be a tuple");
-  if (PyTuple_Size(pycbs) != 5 && PyTuple_Size(pycbs) != 6)
-    return PyErr_Format(PyExc_TypeError,
-                        "pycbs must be a tuple of size 5 or 6");
+  return data_new_from_cbs(self, pycbs, r_data, &cbs);
+}
 
-  err = gpgme_data_new_from_cbs(r_data, &cbs, (void *) pycbs);
-  if (err)
-    return _gpg_raise_exception(err);
+/* Same as gpg_data_new_from_cbs but the read and write callbacks
+   operate on memoryviews of gpgme's buffers.  */
+PyObject *
+gpg_data_new_from_buffer_cbs(PyObject *self,
+                              PyObject *pycbs,
+                              gpgme_data_t *r_data)
+{
+  static struct gpgme_data_cbs cbs = {
+    pyDataReadIntoCb,
+    pyDataWriteViewCb,
+    pyDataSeekCb,
+    pyDataReleaseCb,
+  };
 
-  PyObject_SetAttrString(self, "_data_cbs", pycbs);
+  return data_new_from_cbs(self, pycbs, r_data, &cbs);
+}
 
-  Py_INCREF(Py_None);
+
+
+/* Key listing.  */
+
+/* The attribute of the context holding an error of the key listing
+   which is raised by the next call of gpg_keylist_next_batch.  */
+#define KEYLIST_ERROR	"_keylist_error"
+
+/* Return a list with up to MAX keys from the key listing running in
+   the context wrapped by SELF.  An empty list is returned at the end
+   of the listing.  The keys are retrieved without holding the GIL, so
+   that other threads may run while the engine is busy.  If an error
+   occurs after some keys have been retrieved, these keys are returned
+   and the error is raised by the next call.  */
+PyObject *
+gpg_keylist_next_batch(PyObject *self, int max)
+{
+  PyGILState_STATE state = PyGILState_Ensure();
+  PyObject *wrapped, *pending, *result = NULL;
+  gpgme_ctx_t ctx;
+  gpgme_key_t *keys = NULL;
+  gpgme_error_t err = 0;
+  int i, n = 0;
+
+  if (max <= 0)
+    {
+      PyErr_SetString(PyExc_ValueError, "max must be positive");
+      goto leave;
+    }
+
+  pending = PyObject_GetAttrString(self, KEYLIST_ERROR);
+  if (pending == NULL)
+    PyErr_Clear();
+  else if (pending == Py_None)
+    Py_DECREF(pending);
+  else
+    {
+      err = (gpgme_error_t) PyLong_AsUnsignedLong(pending);
+      Py_DECREF(pending);
+      if (PyObject_SetAttrString(self, KEYLIST_ERROR, Py_None) == 0)
+        _gpg_raise_exception(err);
+      goto leave;
+    }
+
+  wrapped = PyObject_GetAttrString(self, "wrapped");
+  if (wrapped == NULL)
+    goto leave;
+  ctx = _gpg_unwrap_gpgme_ctx_t(wrapped);
+  Py_DECREF(wrapped);
+  if (ctx == NULL)
+    {
+      if (! PyErr_Occurred())
+        PyErr_SetString(PyExc_RuntimeError, "wrapped is NULL");
+      goto leave;
+    }
+
+  keys = malloc(max * sizeof *keys);
+  if (keys == NULL)
+    {
+      PyErr_NoMemory();
+      goto leave;
+    }
+
+  Py_BEGIN_ALLOW_THREADS
+  while (n < max && ! (err = gpgme_op_keylist_next(ctx, &keys[n])))
+    n++;
+  Py_END_ALLOW_THREADS
+
+  if (err && gpgme_err_code(err) != GPG_ERR_EOF)
+    {
+      if (n == 0)
+        {
+          _gpg_raise_exception(err);
+          goto leave;
+        }
+
+      pending = PyLong_FromUnsignedLong(err);
+      if (pending == NULL
+          || PyObject_SetAttrString(self, KEYLIST_ERROR, pending) < 0)
+        {
+          Py_XDECREF(pending);
+          for (i = 0; i < n; i++)
+            gpgme_key_unref(keys[i]);
+          goto leave;
+        }
+      Py_DECREF(pending);
+    }
+
+  /* The wrappers do not own the keys; the references are only taken
+     over by the caller.  */
+  result = PyList_New(n);
+  for (i = 0; result && i < n; i++)
+    {
+      PyObject *o = _gpg_wrap_gpgme_key_t(keys[i]);
+      if (o == NULL)
+        {
+          Py_CLEAR(result);
+          break;
+        }
+      PyList_SET_ITEM(result, i, o);
+    }
+  if (result == NULL)
+    for (i = 0; i < n; i++)
+      gpgme_key_unref(keys[i]);
+
+ leave:
+  free(keys);
   PyGILState_Release(state);
-  return Py_None;
+  return result;
 }
 
 
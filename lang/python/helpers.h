@@ -41,3 +41,7 @@ PyObject *gpg_set_status_cb(PyObject *self, PyObject *cb);
 
 PyObject *gpg_data_new_from_cbs(PyObject *self, PyObject *pycbs,
 				 gpgme_data_t *r_data);
+PyObject *gpg_data_new_from_buffer_cbs(PyObject *self, PyObject *pycbs,
+					gpgme_data_t *r_data);
+
+PyObject *gpg_keylist_next_batch(PyObject *self, int max);
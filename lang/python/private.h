@@ -49,6 +49,7 @@ gpgme_error_t _gpg_assuan_status_cb (void *hook,
 /* SWIG runtime support.  Implemented in gpgme.i.  */
 
 PyObject *_gpg_wrap_gpgme_data_t(gpgme_data_t data);
+PyObject *_gpg_wrap_gpgme_key_t(gpgme_key_t key);
 gpgme_ctx_t _gpg_unwrap_gpgme_ctx_t(PyObject *wrapped);
 
 #endif /* _GPG_PRIVATE_H_ */
@@ -726,7 +726,8 @@ class Context(GpgmeWrapper):
                 pattern=None,
                 secret=False,
                 mode=constants.keylist.mode.LOCAL,
-                source=None):
+                source=None,
+                batch_size=None):
         """List keys
 
         Keyword arguments:
@@ -735,6 +736,8 @@ class Context(GpgmeWrapper):
         mode    -- keylist mode (default: list local keys)
         source  -- read keys from source instead from the keyring
                        (all other options are ignored in this case)
+        batch_size -- number of keys fetched from the engine at once
+                       (default: 64)
 
         Returns:
                 -- an iterator returning key objects
@@ -753,10 +756,8 @@ class Context(GpgmeWrapper):
                 source = Data(file=source)
             self.op_keylist_from_data_start(source, 0)
 
-        key = self.op_keylist_next()
-        while key:
+        for key in self._op_keylist_batches(batch_size):
             yield key
-            key = self.op_keylist_next()
         self.op_keylist_end()
 
     def create_key(self,
@@ -1178,14 +1179,33 @@ class Context(GpgmeWrapper):
     def __exit__(self, type, value, tb):
         self.__del__()
 
+    _keylist_batch_size = 64
+
     def op_keylist_all(self, *args, **kwargs):
         self.op_keylist_start(*args, **kwargs)
-        key = self.op_keylist_next()
-        while key:
+        for key in self._op_keylist_batches():
             yield key
-            key = self.op_keylist_next()
         self.op_keylist_end()
 
+    def _op_keylist_batches(self, batch_size=None):
+        """Yields the keys of the key listing started by
+        op_keylist_start().  The keys are retrieved in batches of
+        BATCH_SIZE keys, releasing the GIL while the engine is
+        consulted."""
+        if batch_size is None:
+            batch_size = self._keylist_batch_size
+        # An error of a previous listing which was not raised.
+        self._keylist_error = None
+        while True:
+            keys = gpgme.gpg_keylist_next_batch(self, batch_size)
+            if self._callback_excinfo:
+                gpgme.gpg_raise_callback_exception(self)
+            if not keys:
+                break
+            for key in keys:
+                key.__del__ = lambda self: gpgme.gpgme_key_unref(self)
+                yield key
+
     def op_keylist_next(self):
         """Returns the next key in the list created
         by a call to op_keylist_start().  The object returned
@@ -1439,7 +1459,8 @@ class Data(GpgmeWrapper):
                  offset=None,
                  length=None,
                  cbs=None,
-                 copy=True):
+                 copy=True,
+                 readinto=False):
         """Initialize a new gpgme_data_t object.
 
         If no args are specified, make it an empty object.
@@ -1475,6 +1496,25 @@ class Data(GpgmeWrapper):
         The functions may be bound methods.  In that case, you can
         simply use the 'self' reference instead of using a hook.
 
+        If readinto is True, the read and write callbacks operate
+        directly on GPGME's buffers, which avoids creating and copying
+        a bytes object for every chunk:
+
+            def read(buffer, hook=None):
+                <store up to len(buffer) bytes in the writable memoryview
+                 buffer and return the number of bytes stored>
+
+            def write(buffer, hook=None):
+                <consume the read-only memoryview buffer and
+                 return the number of bytes written>
+
+        This matches the readinto and write methods of raw file
+        objects.  The memoryviews are only valid during the call.
+        Slices of them and objects referring to their memory, like
+        ctypes arrays created by from_buffer, must not be kept after
+        the call.  If an export of a memoryview is kept, for example
+        in a pickle.PickleBuffer, the call fails with a BufferError.
+
         If file is specified without any other arguments, then
         it must be a filename, and the object will be initialized from
         that file.
@@ -1484,7 +1524,7 @@ class Data(GpgmeWrapper):
         self.data_cbs = None
 
         if cbs is not None:
-            self.new_from_cbs(*cbs)
+            self.new_from_cbs(*cbs, readinto=readinto)
         elif string is not None:
             self.new_from_mem(string, copy)
         elif file is not None and offset is not None and length is not None:
@@ -1544,7 +1584,8 @@ class Data(GpgmeWrapper):
         self.wrapped = gpgme.gpgme_data_t_p_value(tmp)
         gpgme.delete_gpgme_data_t_p(tmp)
 
-    def new_from_cbs(self, read_cb, write_cb, seek_cb, release_cb, hook=None):
+    def new_from_cbs(self, read_cb, write_cb, seek_cb, release_cb, hook=None,
+                     readinto=False):
         tmp = gpgme.new_gpgme_data_t_p()
         if hook is not None:
             hookdata = (weakref.ref(self), read_cb, write_cb, seek_cb,
@@ -1552,7 +1593,10 @@ class Data(GpgmeWrapper):
         else:
             hookdata = (weakref.ref(self), read_cb, write_cb, seek_cb,
                         release_cb)
-        gpgme.gpg_data_new_from_cbs(self, hookdata, tmp)
+        if readinto:
+            gpgme.gpg_data_new_from_buffer_cbs(self, hookdata, tmp)
+        else:
+            gpgme.gpg_data_new_from_cbs(self, hookdata, tmp)
         self.wrapped = gpgme.gpgme_data_t_p_value(tmp)
         gpgme.delete_gpgme_data_t_p(tmp)
 
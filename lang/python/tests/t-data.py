@@ -21,6 +21,7 @@ from __future__ import absolute_import, print_function, unicode_literals
 
 import io
 import os
+import pickle
 import tempfile
 import gpg
 import support
@@ -138,3 +139,58 @@ data.seek(0, os.SEEK_SET)
 assert data.read() == b'Hello world!'
 del data
 assert do.released
+
+
+# Test callbacks operating on memoryviews.
+class BufferDataObject(DataObject):
+    def read(self, buffer, hook=None):
+        assert not self.released
+        assert isinstance(buffer, memoryview) and not buffer.readonly
+        return self.buffer.readinto(buffer)
+
+    def write(self, buffer, hook=None):
+        assert not self.released
+        assert isinstance(buffer, memoryview) and buffer.readonly
+        return self.buffer.write(buffer)
+
+
+do = BufferDataObject()
+data = gpg.Data(cbs=(do.read, do.write, do.seek, do.release, cookie),
+                readinto=True)
+data.write('Hello world!')
+data.seek(0, os.SEEK_SET)
+assert data.read() == b'Hello world!'
+del data
+assert do.released
+
+
+# Keeping an export of a memoryview is an error of the callback.
+class LeakingDataObject(BufferDataObject):
+    def read(self, buffer, hook=None):
+        self.leaked = pickle.PickleBuffer(buffer)
+        return super(LeakingDataObject, self).read(buffer, hook)
+
+
+if hasattr(pickle, 'PickleBuffer'):
+    do = LeakingDataObject()
+    data = gpg.Data(cbs=(do.read, do.write, do.seek, do.release, cookie),
+                    readinto=True)
+    data.write('Hello world!')
+    data.seek(0, os.SEEK_SET)
+    try:
+        data.read()
+    except BufferError:
+        pass
+    else:
+        assert False, "Expected a BufferError, got none"
+    del data
+    assert do.released
+
+# A raw file object can be used directly.
+with tempfile.TemporaryFile(buffering=0) as tmp:
+    data = gpg.Data(cbs=(tmp.readinto, tmp.write, tmp.seek, lambda: None),
+                    readinto=True)
+    data.write(b'Hello world!')
+    data.seek(0, os.SEEK_SET)
+    assert data.read() == b'Hello world!'
+    del data
@@ -289,6 +289,10 @@ assert len(alpha_keys) == 1, "Expected only one key for 'Alpha', got %r" % len(
 # Check negative result.
 assert len(list(c.keylist("no such key in sight"))) == 0
 
+# The batch size must not affect the result.
+assert [k.fpr for k in c.keylist(batch_size=1)] == \
+    [k.fpr for k in c.keylist(batch_size=1000)]
+
 for i, key in enumerate(c.keylist()):
     try:
         if len(keys[i]) == 4:
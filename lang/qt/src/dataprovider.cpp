@@ -30,6 +30,7 @@
 
 #include <error.h>
 
+#include <QFile>
 #include <QIODevice>
 #include <QProcess>
 
@@ -37,6 +38,11 @@
 #include <cstring>
 #include <cassert>
 
+#ifndef Q_OS_WIN
+# include <unistd.h>
+# include <fcntl.h>
+#endif
+
 using namespace QGpgME;
 using namespace GpgME;
 
@@ -289,3 +295,45 @@ void QIODeviceDataProvider::release()
 #endif
     mIO->close();
 }
+
+//
+//
+// createPipe
+//
+//
+
+Error QGpgME::createPipe(std::shared_ptr<QIODevice> &writer,
+                         std::shared_ptr<QIODevice> &reader)
+{
+#ifdef Q_OS_WIN
+    Q_UNUSED(writer);
+    Q_UNUSED(reader);
+    return Error::fromCode(GPG_ERR_NOT_IMPLEMENTED);
+#else
+    int fds[2];
+    if (::pipe(fds)) {
+        return Error::fromSystemError();
+    }
+    ::fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    ::fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+    // The devices own the file descriptors.  They are unbuffered so
+    // that the data is passed on as soon as it has been written.
+    const auto w = std::make_shared<QFile>();
+    const auto r = std::make_shared<QFile>();
+    if (!w->open(fds[1], QIODevice::WriteOnly | QIODevice::Unbuffered,
+                 QFileDevice::AutoCloseHandle)) {
+        ::close(fds[0]);
+        ::close(fds[1]);
+        return Error::fromCode(GPG_ERR_EIO);
+    }
+    if (!r->open(fds[0], QIODevice::ReadOnly | QIODevice::Unbuffered,
+                 QFileDevice::AutoCloseHandle)) {
+        ::close(fds[0]);
+        return Error::fromCode(GPG_ERR_EIO);
+    }
+    writer = w;
+    reader = r;
+    return Error();
+#endif
+}
@@ -33,6 +33,11 @@
 
 class QIODevice;
 
+namespace GpgME
+{
+class Error;
+}
+
 namespace QGpgME
 {
 
@@ -91,6 +96,16 @@ private:
     bool mHaveQProcess  : 1;
 };
 
+/**
+ * Create a pipe for chaining two jobs.  The first job writes its
+ * output to @p writer and the second job, which must be running
+ * concurrently, reads its input from @p reader.  The reader sees the
+ * end of the data when the first job has finished and released
+ * @p writer.  Returns an error on Windows where this is not supported.
+ */
+QGPGME_EXPORT GpgME::Error createPipe(std::shared_ptr<QIODevice> &writer,
+                                      std::shared_ptr<QIODevice> &reader);
+
 } // namespace QGpgME
 
 #endif
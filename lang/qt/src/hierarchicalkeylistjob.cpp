@@ -0,0 +1,332 @@
+/*
+    hierarchicalkeylistjob.cpp
+
+    This file is part of qgpgme, the Qt API binding for gpgme
+    Copyright (c) 2004 Klarälvdalens Datakonsult AB
+    Copyright (c) 2021 g10 Code GmbH
+
+    QGpgME is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.
+
+    QGpgME is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of this program with any edition of
+    the Qt library by Trolltech AS, Norway (or with modified versions
+    of Qt that use the same license as Qt), and distribute linked
+    combinations including the two.  You must obey the GNU General
+    Public License in all respects for all of the code used other than
+    Qt.  If you modify this file, you may extend this exception to
+    your version of the file, but you are not obligated to do so.  If
+    you do not wish to do so, delete this exception statement from
+    your version.
+*/
+
+#ifdef HAVE_CONFIG_H
+ #include "config.h"
+#endif
+
+#include "hierarchicalkeylistjob.h"
+#include "protocol.h"
+
+#include <key.h>
+#include <context.h>
+#include <keylistresult.h>
+
+#include <gpg-error.h>
+
+#include <algorithm>
+#include <memory>
+
+#include <assert.h>
+
+using namespace GpgME;
+
+namespace
+{
+
+// The number of key listings which may run at the same time.
+static const unsigned int maxConcurrentJobs = 4;
+
+// gpgsm gets the patterns of a key listing on one Assuan line of at
+// most 1000 bytes including the command.  Longer lines are truncated
+// by libassuan, i.e. the last patterns would silently be dropped.
+static const int maxBatchLength = 900;
+
+// Returns the length of @p pattern on the Assuan line including the
+// separating space.
+static int patternLength(const QString &pattern)
+{
+    const QByteArray utf8 = pattern.toUtf8();
+    int length = utf8.size() + 1;
+    for (const char c : utf8) {
+        if (c == '%' || c == ' ' || c == '+') {
+            length += 2;
+        }
+    }
+    return length;
+}
+
+static int patternLength(const Fingerprint &fpr)
+{
+    return 2 * fpr.size() + 1;
+}
+
+// Returns the length of the patterns for @p fprs on the Assuan line, but
+// stops counting after @p max.
+static int pendingLength(const std::unordered_set<Fingerprint> &fprs, int max)
+{
+    int length = 0;
+    for (auto it = fprs.begin(); it != fprs.end() && length <= max; ++it) {
+        length += patternLength(*it);
+    }
+    return length;
+}
+
+}
+
+QGpgME::HierarchicalKeyListJob::HierarchicalKeyListJob(const Protocol *protocol,
+        bool remote, bool includeSigs, bool validating)
+    : KeyListJob(nullptr),
+      mProtocol(protocol),
+      mRemote(remote),
+      mIncludeSigs(includeSigs),
+      mValidating(validating),
+      mTruncated(false),
+      mModes(0),
+      mBatchKeys(1000),
+      mBatchDelay(100),
+      mFinishedJobs(0),
+      mIntermediateResult()
+{
+    assert(protocol);
+}
+
+QGpgME::HierarchicalKeyListJob::~HierarchicalKeyListJob()
+{
+
+}
+
+GpgME::Error QGpgME::HierarchicalKeyListJob::start(const QStringList &patterns, bool secretOnly)
+{
+    for (const QString &pattern : patterns) {
+        if (!pattern.isEmpty()) {
+            mPatterns.push_back(pattern);
+        }
+    }
+    if (secretOnly || mPatterns.empty()) {
+        deleteLater();
+        return Error::fromCode(GPG_ERR_UNSUPPORTED_OPERATION);
+    }
+
+    const Error err = startJobs();
+    if (err) {
+        slotCancel();
+        deleteLater();
+    }
+    return err;
+}
+
+GpgME::KeyListResult QGpgME::HierarchicalKeyListJob::exec(const QStringList &patterns, bool secretOnly,
+        std::vector<Key> &keys)
+{
+    keys.clear();
+    for (const QString &pattern : patterns) {
+        if (!pattern.isEmpty()) {
+            mPatterns.push_back(pattern);
+        }
+    }
+    if (secretOnly || mPatterns.empty()) {
+        return KeyListResult(Error::fromCode(GPG_ERR_UNSUPPORTED_OPERATION));
+    }
+
+    // Without an event loop the listings can only run one after the
+    // other, but they are still batched.
+    for (QStringList batch = takeBatch(); !batch.empty(); batch = takeBatch()) {
+        const std::unique_ptr<KeyListJob> job(createJob());
+        std::vector<Key> batchKeys;
+        mIntermediateResult.mergeWith(job->exec(batch, false, batchKeys));
+        ++mFinishedJobs;
+        for (const Key &key : batchKeys) {
+            if (addKey(key)) {
+                keys.push_back(key);
+            }
+        }
+        if (mIntermediateResult.error()) {
+            break;
+        }
+    }
+    return mIntermediateResult;
+}
+
+void QGpgME::HierarchicalKeyListJob::addMode(KeyListMode mode)
+{
+    mModes |= mode;
+}
+
+void QGpgME::HierarchicalKeyListJob::setKeyBatching(unsigned int maxKeys, int maxDelay)
+{
+    mBatchKeys = maxKeys;
+    mBatchDelay = maxDelay;
+}
+
+void QGpgME::HierarchicalKeyListJob::slotNextKeys(const std::vector<Key> &keys)
+{
+    std::vector<Key> newKeys;
+    newKeys.reserve(keys.size());
+    for (const Key &key : keys) {
+        if (addKey(key)) {
+            newKeys.push_back(key);
+        }
+    }
+    if (newKeys.empty()) {
+        return;
+    }
+    Q_EMIT nextKeys(newKeys);
+    for (const Key &key : newKeys) {
+        Q_EMIT nextKey(key);
+    }
+}
+
+void QGpgME::HierarchicalKeyListJob::slotCancel()
+{
+    mPatterns.clear();
+    mNextSet.clear();
+    for (const QPointer<KeyListJob> &job : mJobs) {
+        if (job) {
+            job->slotCancel();
+        }
+    }
+}
+
+void QGpgME::HierarchicalKeyListJob::slotResult(const KeyListResult &res)
+{
+    KeyListJob *const job = qobject_cast<KeyListJob *>(sender());
+    mJobs.erase(std::remove_if(mJobs.begin(), mJobs.end(),
+                               [job](const QPointer<KeyListJob> &j) { return !j || j == job; }),
+                mJobs.end());
+    ++mFinishedJobs;
+    mIntermediateResult.mergeWith(res);
+
+    const int current = mFinishedJobs;
+    const int total = current + static_cast<int>(mJobs.size()) + (mPatterns.empty() && mNextSet.empty() ? 0 : 1);
+    Q_EMIT progress(QStringLiteral("%1/%2").arg(current).arg(total), current, total);
+
+    if (mIntermediateResult.error()) {
+        finish(mIntermediateResult);
+        return;
+    }
+    if (const Error err = startJobs()) { // error starting a job for the next keys
+        mIntermediateResult.mergeWith(KeyListResult(err));
+        finish(mIntermediateResult);
+        return;
+    }
+    if (mJobs.empty()) {
+        finish(mIntermediateResult);
+    }
+}
+
+QGpgME::KeyListJob *QGpgME::HierarchicalKeyListJob::createJob() const
+{
+    KeyListJob *const job = mProtocol->keyListJob(mRemote, mIncludeSigs, mValidating);
+    assert(job);   // FIXME: we need a way to generate errors ourselves,
+    // but I don't like the dependency on gpg-error :/
+    if (mModes) {
+        job->addMode(static_cast<KeyListMode>(mModes));
+    }
+    job->setKeyBatching(mBatchKeys, mBatchDelay);
+    return job;
+}
+
+bool QGpgME::HierarchicalKeyListJob::addKey(const Key &key)
+{
+    const Fingerprint fpr = key.fingerprint();
+    if (fpr.isNull() || !mSentSet.insert(key)) {
+        return false;
+    }
+    // the key may be an issuer we have not yet looked up
+    mNextSet.erase(fpr);
+
+    const Fingerprint issuer(key.chainID());
+    if (!issuer.isNull() && !mSentSet.contains(issuer) && !mScheduledSet.count(issuer)) {
+        mNextSet.insert(issuer);
+    }
+    return true;
+}
+
+QStringList QGpgME::HierarchicalKeyListJob::takeBatch()
+{
+    QStringList batch;
+    int length = 0;
+    while (!mPatterns.empty()) {
+        const int len = patternLength(mPatterns.front());
+        if (!batch.empty() && length + len > maxBatchLength) {
+            return batch;
+        }
+        batch.push_back(mPatterns.takeFirst());
+        length += len;
+    }
+    for (auto it = mNextSet.begin(); it != mNextSet.end();) {
+        const int len = patternLength(*it);
+        if (!batch.empty() && length + len > maxBatchLength) {
+            break;
+        }
+        batch.push_back(QString::fromStdString(it->toString()));
+        length += len;
+        mScheduledSet.insert(*it);
+        it = mNextSet.erase(it);
+    }
+    return batch;
+}
+
+GpgME::Error QGpgME::HierarchicalKeyListJob::startJobs()
+{
+    while (mJobs.size() < maxConcurrentJobs && !(mPatterns.empty() && mNextSet.empty())) {
+        // The running listings may still find issuers; only start a
+        // listing which would not fill the command line if nothing else
+        // is running.
+        if (!mJobs.empty() && mPatterns.empty()
+                && pendingLength(mNextSet, maxBatchLength) <= maxBatchLength) {
+            break;
+        }
+
+        KeyListJob *const job = createJob();
+        connect(job, &KeyListJob::nextKeys, this, &HierarchicalKeyListJob::slotNextKeys);
+        connect(job, &KeyListJob::result, this, &HierarchicalKeyListJob::slotResult);
+        mJobs.push_back(job);
+
+        if (const Error err = job->start(takeBatch(), false)) {
+            return err;
+        }
+    }
+    return Error();
+}
+
+void QGpgME::HierarchicalKeyListJob::finish(const KeyListResult &res)
+{
+    // the results of the listings still running are not needed anymore
+    for (const QPointer<KeyListJob> &job : mJobs) {
+        if (job) {
+            disconnect(job.data(), nullptr, this, nullptr);
+            job->slotCancel();
+        }
+    }
+    mJobs.clear();
+    mPatterns.clear();
+    mNextSet.clear();
+
+    Q_EMIT done();
+    Q_EMIT result(res, mSentSet.keys());
+    deleteLater();
+}
+
+#include "hierarchicalkeylistjob.moc"
@@ -37,17 +37,21 @@
 
 #include "qgpgme_export.h"
 #include "keylistjob.h"
-#include "cryptobackend.h"
+#include "protocol.h"
 
 #ifdef BUILDING_QGPGME
 # include "keylistresult.h"
+# include "keyindex.h"
 #else
 #include <gpgme++/keylistresult.h>
+#include <gpgme++/keyindex.h>
 #endif
 
 #include <QPointer>
+#include <QStringList>
 
-#include <set>
+#include <unordered_set>
+#include <vector>
 
 namespace GpgME
 {
@@ -73,6 +77,12 @@ namespace QGpgME
    HierarchicalKeyListJob instance will have scheduled it's own
    destruction with a call to QObject::deleteLater().
 
+   The patterns and the issuers found are looked up in batches which
+   fit on one command line of the backend and up to four of these
+   lookups run concurrently.  Issuers which were already received are
+   not looked up again.  The progress() signal is emitted after each
+   lookup; current is the number of finished lookups.
+
    After result() is emitted, the HierarchicalKeyListJob will
    schedule its own destruction by calling QObject::deleteLater().
 */
@@ -99,14 +109,22 @@ public:
     GpgME::KeyListResult exec(const QStringList &patterns, bool secretOnly,
                               std::vector<GpgME::Key> &keys) Q_DECL_OVERRIDE;
 
+    void addMode(GpgME::KeyListMode mode) Q_DECL_OVERRIDE;
+
+    void setKeyBatching(unsigned int maxKeys, int maxDelay) Q_DECL_OVERRIDE;
+
 private Q_SLOTS:
     void slotResult(const GpgME::KeyListResult &);
-    void slotNextKey(const GpgME::Key &key);
+    void slotNextKeys(const std::vector<GpgME::Key> &keys);
     /* from Job */
     void slotCancel() Q_DECL_OVERRIDE;
 
 private:
-    GpgME::Error startAJob();
+    KeyListJob *createJob() const;
+    bool addKey(const GpgME::Key &key);
+    QStringList takeBatch();
+    GpgME::Error startJobs();
+    void finish(const GpgME::KeyListResult &result);
 
 private:
     const Protocol *const mProtocol;
@@ -114,11 +132,16 @@ private:
     const bool mIncludeSigs;
     const bool mValidating;
     bool mTruncated;
-    std::set<QString> mSentSet; // keys already sent (prevent duplicates even if the backend should return them)
-    std::set<QString> mScheduledSet; // keys already scheduled (by starting a job for them)
-    std::set<QString> mNextSet; // keys to schedule for the next iteraton
+    unsigned int mModes; // the modes to add to each job
+    unsigned int mBatchKeys; // the key batching of each job
+    int mBatchDelay;
+    unsigned int mFinishedJobs;
+    QStringList mPatterns; // patterns given to start() not yet scheduled
+    GpgME::KeyIndex mSentSet; // keys already sent (prevent duplicates even if the backend should return them)
+    std::unordered_set<GpgME::Fingerprint> mScheduledSet; // keys already scheduled (by starting a job for them)
+    std::unordered_set<GpgME::Fingerprint> mNextSet; // keys to schedule for the next iteraton
     GpgME::KeyListResult mIntermediateResult;
-    QPointer<KeyListJob> mJob;
+    std::vector<QPointer<KeyListJob>> mJobs; // the running jobs
 };
 
 }
@@ -68,7 +68,10 @@ namespace QGpgME
    destruction with a call to QObject::deleteLater().
 
    During keylisting, you will receive new key objects through the
-   nextKey() signal as they arrive. After result() is emitted, the
+   nextKey() signal as they arrive. They are also delivered in
+   batches through the nextKeys() signal, which is emitted before
+   the nextKey() signals for the keys of the batch; see
+   setKeyBatching(). After result() is emitted, the
    KeyListJob will schedule it's own destruction by calling
    QObject::deleteLater().
 */
@@ -100,8 +103,21 @@ public:
     /** Add a flag to the keylistmode used. */
     virtual void addMode(GpgME::KeyListMode mode) = 0;
 
+    /**
+       Sets how the keys are batched for the nextKeys() signal. A batch
+       is delivered when it has \a maxKeys keys or when a key arrives
+       \a maxDelay milliseconds or more after the previous batch; the
+       remaining keys are delivered at the end of the listing. The
+       default is 1000 keys or 100 milliseconds. If \a maxKeys is 0,
+       all keys are delivered right before the result() signal.
+
+       This must be called before the job is started.
+    */
+    virtual void setKeyBatching(unsigned int maxKeys, int maxDelay);
+
 Q_SIGNALS:
     void nextKey(const GpgME::Key &key);
+    void nextKeys(const std::vector<GpgME::Key> &keys);
     void result(const GpgME::KeyListResult &result, const std::vector<GpgME::Key> &keys = std::vector<GpgME::Key>(), const QString &auditLogAsHtml = QString(), const GpgME::Error &auditLogError = GpgME::Error());
 };
 
@@ -43,9 +43,13 @@
 #include "keylistresult.h"
 #include <gpg-error.h>
 
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QStringList>
 
 #include <algorithm>
+#include <iterator>
 
 #include <cstdlib>
 #include <cstring>
@@ -54,16 +58,94 @@
 using namespace QGpgME;
 using namespace GpgME;
 
+// Collects the keys listed in the worker thread into batches and hands
+// them over to the job.  At most one call of slotNextKeys is queued; the
+// keys arriving meanwhile are added to the pending batch.
+class QGpgME::_detail::KeyBatcher
+{
+public:
+    explicit KeyBatcher(QObject *job)
+        : mJob(job), mMaxKeys(1000), mMaxDelay(100), mQueued(false)
+    {
+    }
+
+    void setBatching(unsigned int maxKeys, int maxDelay)
+    {
+        mMaxKeys = maxKeys;
+        mMaxDelay = maxDelay;
+    }
+
+    /* Called in the worker thread.  */
+    void start()
+    {
+        mTimer.start();
+    }
+
+    void add(const Key &key)
+    {
+        mKeys.push_back(key);
+        if (mKeys.size() >= mMaxKeys || mTimer.hasExpired(mMaxDelay)) {
+            flush();
+        }
+    }
+
+    void flush()
+    {
+        mTimer.restart();
+        if (mKeys.empty()) {
+            return;
+        }
+        bool queue;
+        {
+            const QMutexLocker locker(&mMutex);
+            if (mPending.empty()) {
+                mPending.swap(mKeys);
+            } else {
+                mPending.insert(mPending.end(), std::make_move_iterator(mKeys.begin()),
+                                std::make_move_iterator(mKeys.end()));
+            }
+            queue = !mQueued;
+            mQueued = true;
+        }
+        mKeys.clear();
+        if (queue) {
+            QMetaObject::invokeMethod(mJob, "slotNextKeys", Qt::QueuedConnection);
+        }
+    }
+
+    /* Called in the thread of the job.  */
+    std::vector<Key> take()
+    {
+        std::vector<Key> keys;
+        const QMutexLocker locker(&mMutex);
+        keys.swap(mPending);
+        mQueued = false;
+        return keys;
+    }
+
+private:
+    QObject *const mJob;
+    unsigned int mMaxKeys;
+    int mMaxDelay;
+    QElapsedTimer mTimer;
+    std::vector<Key> mKeys; // the batch being collected by the worker thread
+    QMutex mMutex; // protects mPending and mQueued
+    std::vector<Key> mPending;
+    bool mQueued;
+};
+
 QGpgMEKeyListJob::QGpgMEKeyListJob(Context *context)
     : mixin_type(context),
-      mResult(), mSecretOnly(false)
+      mResult(), mSecretOnly(false),
+      mBatcher(new _detail::KeyBatcher(this))
 {
     lateInitialization();
 }
 
 QGpgMEKeyListJob::~QGpgMEKeyListJob() {}
 
-static KeyListResult do_list_keys(Context *ctx, const QStringList &pats, std::vector<Key> &keys, bool secretOnly)
+static KeyListResult do_list_keys(Context *ctx, const QStringList &pats, std::vector<Key> &keys, bool secretOnly,
+                                  const std::shared_ptr<_detail::KeyBatcher> &batcher)
 {
 
     const _detail::PatternConverter pc(pats);
@@ -73,23 +155,36 @@ static KeyListResult do_list_keys(Context *ctx, const QStringList &pats, std::ve
     }
 
     Error err;
-    do {
-        keys.push_back(ctx->nextKey(err));
-    } while (!err);
-
-    keys.pop_back();
+    for (;;) {
+        Key key = ctx->nextKey(err);
+        if (err) {
+            break;
+        }
+        if (batcher) {
+            batcher->add(key);
+        }
+        keys.push_back(std::move(key));
+    }
 
     const KeyListResult result = ctx->endKeyListing();
     ctx->cancelPendingOperation();
     return result;
 }
 
-static QGpgMEKeyListJob::result_type list_keys(Context *ctx, QStringList pats, bool secretOnly)
+static QGpgMEKeyListJob::result_type list_keys(Context *ctx, QStringList pats, bool secretOnly,
+                                               const std::shared_ptr<_detail::KeyBatcher> &batcher)
 {
+    if (batcher) {
+        batcher->start();
+    }
+
     if (pats.size() < 2) {
         std::vector<Key> keys;
-        const KeyListResult r = do_list_keys(ctx, pats, keys, secretOnly);
-        return std::make_tuple(r, keys, QString(), Error());
+        const KeyListResult r = do_list_keys(ctx, pats, keys, secretOnly, batcher);
+        if (batcher) {
+            batcher->flush();
+        }
+        return std::make_tuple(r, std::move(keys), QString(), Error());
     }
 
     // The communication channel between gpgme and gpgsm is limited in
@@ -102,21 +197,25 @@ static QGpgMEKeyListJob::result_type list_keys(Context *ctx, QStringList pats, b
     // be noticeable.
 
     unsigned int chunkSize = pats.size();
-retry:
     std::vector<Key> keys;
     keys.reserve(pats.size());
     KeyListResult result;
     do {
-        const KeyListResult this_result = do_list_keys(ctx, pats.mid(0, chunkSize), keys, secretOnly);
+        const KeyListResult this_result = do_list_keys(ctx, pats.mid(0, chunkSize), keys, secretOnly, batcher);
         if (this_result.error().code() == GPG_ERR_LINE_TOO_LONG) {
-            // got LINE_TOO_LONG, try a smaller chunksize:
+            // got LINE_TOO_LONG, try a smaller chunksize (the keys of
+            // the previous chunks may already have been delivered, so
+            // keep them and retry only this chunk):
             chunkSize /= 2;
             if (chunkSize < 1)
                 // chunks smaller than one can't be -> return the error.
             {
-                return std::make_tuple(this_result, keys, QString(), Error());
+                if (batcher) {
+                    batcher->flush();
+                }
+                return std::make_tuple(this_result, std::move(keys), QString(), Error());
             } else {
-                goto retry;
+                continue;
             }
         } else if (this_result.error().code() == GPG_ERR_EOF) {
             // early end of keylisting (can happen when ~/.gnupg doesn't
@@ -130,29 +229,55 @@ retry:
         }
         pats = pats.mid(chunkSize);
     } while (!pats.empty());
-    return std::make_tuple(result, keys, QString(), Error());
+    if (batcher) {
+        batcher->flush();
+    }
+    return std::make_tuple(result, std::move(keys), QString(), Error());
 }
 
 Error QGpgMEKeyListJob::start(const QStringList &patterns, bool secretOnly)
 {
     mSecretOnly = secretOnly;
-    run(std::bind(&list_keys, std::placeholders::_1, patterns, secretOnly));
+    run(std::bind(&list_keys, std::placeholders::_1, patterns, secretOnly, mBatcher));
     return Error();
 }
 
 KeyListResult QGpgMEKeyListJob::exec(const QStringList &patterns, bool secretOnly, std::vector<Key> &keys)
 {
     mSecretOnly = secretOnly;
-    const result_type r = list_keys(context(), patterns, secretOnly);
+    // without an event loop all keys are delivered at the end
+    mBatcher.reset();
+    result_type r = list_keys(context(), patterns, secretOnly, mBatcher);
     resultHook(r);
-    keys = std::get<1>(r);
+    keys = std::move(std::get<1>(r));
     return std::get<0>(r);
 }
 
 void QGpgMEKeyListJob::resultHook(const result_type &tuple)
 {
     mResult = std::get<0>(tuple);
-    Q_FOREACH (const Key &key, std::get<1>(tuple)) {
+    if (mBatcher) {
+        // deliver the keys of the last batch if slotNextKeys is still queued
+        slotNextKeys();
+        return;
+    }
+    const std::vector<Key> &keys = std::get<1>(tuple);
+    if (!keys.empty()) {
+        Q_EMIT nextKeys(keys);
+    }
+    for (const Key &key : keys) {
+        Q_EMIT nextKey(key);
+    }
+}
+
+void QGpgMEKeyListJob::slotNextKeys()
+{
+    const std::vector<Key> keys = mBatcher->take();
+    if (keys.empty()) {
+        return;
+    }
+    Q_EMIT nextKeys(keys);
+    for (const Key &key : keys) {
         Q_EMIT nextKey(key);
     }
 }
@@ -161,6 +286,23 @@ void QGpgMEKeyListJob::addMode(KeyListMode mode)
 {
     context()->addKeyListMode(mode);
 }
+
+void QGpgMEKeyListJob::setKeyBatching(unsigned int maxKeys, int maxDelay)
+{
+    if (!maxKeys) {
+        mBatcher.reset();
+    } else {
+        if (!mBatcher) {
+            mBatcher.reset(new _detail::KeyBatcher(this));
+        }
+        mBatcher->setBatching(maxKeys, maxDelay);
+    }
+}
+
+/* For ABI compat not pure virtual. */
+void KeyListJob::setKeyBatching(unsigned int, int)
+{
+}
 #if 0
 void QGpgMEKeyListJob::showErrorDialog(QWidget *parent, const QString &caption) const
 {
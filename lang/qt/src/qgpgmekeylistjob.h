@@ -50,8 +50,14 @@
 #include <gpgme++/key.h>
 #endif
 
+#include <memory>
+
 namespace QGpgME
 {
+namespace _detail
+{
+class KeyBatcher;
+}
 
 class QGpgMEKeyListJob
 #ifdef Q_MOC_RUN
@@ -77,11 +83,19 @@ public:
 
     void addMode(GpgME::KeyListMode mode) Q_DECL_OVERRIDE;
 
+    /* from KeyListJob */
+    void setKeyBatching(unsigned int maxKeys, int maxDelay) Q_DECL_OVERRIDE;
+
     /* from ThreadedJobMixin */
     void resultHook(const result_type &result) Q_DECL_OVERRIDE;
+
+private Q_SLOTS:
+    void slotNextKeys();
+
 private:
     GpgME::KeyListResult mResult;
     bool mSecretOnly;
+    std::shared_ptr<_detail::KeyBatcher> mBatcher; // null if the keys are not batched
 };
 
 }
@@ -39,6 +39,7 @@
 #include "qgpgmelistallkeysjob.h"
 
 #include "key.h"
+#include "keyindex.h"
 #include "context.h"
 #include "engineinfo.h"
 #include "global.h"
@@ -86,36 +87,34 @@ static KeyListResult do_list_keys_legacy(Context *ctx, std::vector<Key> &keys, b
     return result;
 }
 
-template <typename ForwardIterator, typename BinaryPredicate>
-ForwardIterator unique_by_merge(ForwardIterator first, ForwardIterator last, BinaryPredicate pred)
+// sorts by the binary fingerprints which are computed only once per key
+static void sort_by_fingerprint(std::vector<Key> &keys)
 {
-    first = std::adjacent_find(first, last, pred);
-    if (first == last) {
-        return last;
+    std::vector<std::pair<Fingerprint, std::size_t>> order;
+    order.reserve(keys.size());
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        order.emplace_back(keys[i].fingerprint(), i);
     }
+    std::sort(order.begin(), order.end());
 
-    ForwardIterator dest = first;
-    dest->mergeWith(*++first);
-    while (++first != last)
-        if (pred(*dest, *first)) {
-            dest->mergeWith(*first);
-        } else {
-            *++dest = *first;
-        }
-    return ++dest;
+    std::vector<Key> sorted;
+    sorted.reserve(keys.size());
+    for (const auto &o : order) {
+        sorted.push_back(std::move(keys[o.second]));
+    }
+    keys.swap(sorted);
 }
 
 static void merge_keys(std::vector<Key> &merged, std::vector<Key> &pub, std::vector<Key> &sec)
 {
-    merged.reserve(pub.size() + sec.size());
-
-    std::merge(pub.begin(), pub.end(),
-               sec.begin(), sec.end(),
-               std::back_inserter(merged),
-               ByFingerprint<std::less>());
-
-    merged.erase(unique_by_merge(merged.begin(), merged.end(), ByFingerprint<std::equal_to>()),
-                 merged.end());
+    KeyIndex index(pub.size() + sec.size());
+    for (const Key &key : pub) {
+        index.merge(key);
+    }
+    for (const Key &key : sec) {
+        index.merge(key);
+    }
+    merged = index.sortedKeys();
 }
 
 static QGpgMEListAllKeysJob::result_type list_keys_legacy(Context *ctx, bool mergeKeys)
@@ -124,17 +123,16 @@ static QGpgMEListAllKeysJob::result_type list_keys_legacy(Context *ctx, bool mer
     KeyListResult r;
 
     r.mergeWith(do_list_keys_legacy(ctx, pub, false));
-    std::sort(pub.begin(), pub.end(), ByFingerprint<std::less>());
-
     r.mergeWith(do_list_keys_legacy(ctx, sec, true));
-    std::sort(sec.begin(), sec.end(), ByFingerprint<std::less>());
+    sort_by_fingerprint(sec);
 
     if (mergeKeys) {
         merge_keys(merged, pub, sec);
     } else {
+        sort_by_fingerprint(pub);
         merged.swap(pub);
     }
-    return std::make_tuple(r, merged, sec, QString(), Error());
+    return std::make_tuple(r, std::move(merged), std::move(sec), QString(), Error());
 }
 
 static KeyListResult do_list_keys(Context *ctx, std::vector<Key> &keys)
@@ -170,12 +168,12 @@ static QGpgMEListAllKeysJob::result_type list_keys(Context *ctx, bool mergeKeys)
 
     std::vector<Key> keys;
     KeyListResult r = do_list_keys(ctx, keys);
-    std::sort(keys.begin(), keys.end(), ByFingerprint<std::less>());
+    sort_by_fingerprint(keys);
 
     std::vector<Key> sec;
     std::copy_if(keys.begin(), keys.end(), std::back_inserter(sec), [](const Key &key) { return key.hasSecret(); });
 
-    return std::make_tuple(r, keys, sec, QString(), Error());
+    return std::make_tuple(r, std::move(keys), std::move(sec), QString(), Error());
 }
 
 }
@@ -188,10 +186,10 @@ Error QGpgMEListAllKeysJob::start(bool mergeKeys)
 
 KeyListResult QGpgMEListAllKeysJob::exec(std::vector<Key> &pub, std::vector<Key> &sec, bool mergeKeys)
 {
-    const result_type r = list_keys(context(), mergeKeys);
+    result_type r = list_keys(context(), mergeKeys);
     resultHook(r);
-    pub = std::get<1>(r);
-    sec = std::get<2>(r);
+    pub = std::move(std::get<1>(r));
+    sec = std::move(std::get<2>(r));
     return std::get<0>(r);
 }
 
@@ -113,6 +113,12 @@ static QString markupDiagnostics(const QString &data)
     return ret;
 }
 
+QEvent::Type _detail::progress_event_type()
+{
+    static const QEvent::Type type = static_cast<QEvent::Type>(QEvent::registerEventType());
+    return type;
+}
+
 static const unsigned int CMSAuditLogFlags = Context::AuditLogWithHelp | Context::HtmlAuditLog;
 static const unsigned int OpenPGPAuditLogFlags = Context::DiagnosticAuditLog;
 
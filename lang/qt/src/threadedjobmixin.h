@@ -35,6 +35,8 @@
 #ifndef __QGPGME_THREADEDJOBMIXING_H__
 #define __QGPGME_THREADEDJOBMIXING_H__
 
+#include <QCoreApplication>
+#include <QEvent>
 #include <QMutex>
 #include <QMutexLocker>
 #include <QThread>
@@ -53,6 +55,7 @@
 
 #include <cassert>
 #include <functional>
+#include <utility>
 
 namespace QGpgME
 {
@@ -61,6 +64,10 @@ namespace _detail
 
 QString audit_log_as_html(GpgME::Context *ctx, GpgME::Error &err);
 
+/* Returns the type of the events which deliver the progress of a job
+   to the thread owning the job.  */
+QEvent::Type progress_event_type();
+
 class PatternConverter
 {
     const QList<QByteArray> m_list;
@@ -109,6 +116,13 @@ public:
         return m_result;
     }
 
+    /* Moves the result out of the finished thread.  */
+    T_result takeResult()
+    {
+        const QMutexLocker locker(&m_mutex);
+        return std::move(m_result);
+    }
+
 private:
     void run() Q_DECL_OVERRIDE {
         const QMutexLocker locker(&m_mutex);
@@ -148,7 +162,8 @@ protected:
                   "Last result type not a GpgME::Error");
 
     explicit ThreadedJobMixin(GpgME::Context *ctx)
-        : T_base(nullptr), m_ctx(ctx), m_thread(), m_auditLog(), m_auditLogError()
+        : T_base(nullptr), m_ctx(ctx), m_thread(), m_auditLog(), m_auditLogError(),
+          m_progressMutex(), m_progressCurrent(0), m_progressTotal(0), m_progressPending(false)
     {
     }
 
@@ -210,7 +225,9 @@ protected:
 
     void slotFinished()
     {
-        const T_result r = m_thread.result();
+        // the result is not needed by the thread anymore and holds
+        // e.g. all keys of a key listing, so don't copy it
+        const T_result r = m_thread.takeResult();
         m_auditLog = std::get < std::tuple_size<T_result>::value - 2 > (r);
         m_auditLogError = std::get < std::tuple_size<T_result>::value - 1 > (r);
         resultHook(r);
@@ -235,14 +252,33 @@ protected:
     void showProgress(const char * /*what*/,
                       int /*type*/, int current, int total) Q_DECL_OVERRIDE {
         // will be called from the thread exec'ing the operation, so
-        // just bounce everything to the owning thread:
-        // ### hope this is thread-safe (meta obj is const, and
-        // ### portEvent is thread-safe, so should be ok)
-        QMetaObject::invokeMethod(this, "progress", Qt::QueuedConnection,
+        // bounce everything to the owning thread.  At most one event is
+        // queued; it delivers the latest values when it is processed,
+        // i.e. a busy event loop is not flooded with progress events.
+        const QMutexLocker locker(&m_progressMutex);
+        m_progressCurrent = current;
+        m_progressTotal = total;
+        if (!m_progressPending) {
+            m_progressPending = true;
+            QCoreApplication::postEvent(this, new QEvent(_detail::progress_event_type()));
+        }
+    }
+
+    bool event(QEvent *e) Q_DECL_OVERRIDE
+    {
+        if (e->type() != _detail::progress_event_type()) {
+            return T_base::event(e);
+        }
+        int current, total;
+        {
+            const QMutexLocker locker(&m_progressMutex);
+            m_progressPending = false;
+            current = m_progressCurrent;
+            total = m_progressTotal;
+        }
         // TODO port
-        Q_ARG(QString, QString()),
-        Q_ARG(int, current),
-        Q_ARG(int, total));
+        Q_EMIT this->progress(QString(), current, total);
+        return true;
     }
 private:
     template <typename T1, typename T2>
@@ -274,6 +310,10 @@ private:
     Thread<T_result> m_thread;
     QString m_auditLog;
     GpgME::Error m_auditLogError;
+    QMutex m_progressMutex;
+    int m_progressCurrent;
+    int m_progressTotal;
+    bool m_progressPending;
 };
 
 }
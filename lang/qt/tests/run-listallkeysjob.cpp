@@ -0,0 +1,88 @@
+/*
+    run-listallkeysjob.cpp
+
+    This file is part of QGpgME's test suite.
+    Copyright (c) 2021 g10 Code GmbH
+
+    QGpgME is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License,
+    version 2, as published by the Free Software Foundation.
+
+    QGpgME is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of this program with any edition of
+    the Qt library by Trolltech AS, Norway (or with modified versions
+    of Qt that use the same license as Qt), and distribute linked
+    combinations including the two.  You must obey the GNU General
+    Public License in all respects for all of the code used other than
+    Qt.  If you modify this file, you may extend this exception to
+    your version of the file, but you are not obligated to do so.  If
+    you do not wish to do so, delete this exception statement from
+    your version.
+*/
+
+/* Lists all keys of the keyring with a ListAllKeysJob and prints the
+   time and the peak memory used.  With --exec the job is run
+   synchronously.  Run it with GNUPGHOME pointing to a large keyring.  */
+
+#ifdef HAVE_CONFIG_H
+ #include "config.h"
+#endif
+
+#include "listallkeysjob.h"
+#include "protocol.h"
+
+#include "key.h"
+#include "keylistresult.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+
+#include <sys/resource.h>
+
+static long maxRss()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    const bool sync = app.arguments().contains(QStringLiteral("--exec"));
+
+    auto job = QGpgME::openpgp()->listAllKeysJob(false, false);
+    QElapsedTimer timer;
+    timer.start();
+    if (sync) {
+        std::vector<GpgME::Key> pub, sec;
+        const GpgME::KeyListResult result = job->exec(pub, sec, false);
+        qDebug() << "exec:" << pub.size() << "public and" << sec.size() << "secret keys in"
+                 << timer.elapsed() << "ms, max RSS" << maxRss() << "KiB"
+                 << (result.error() ? result.error().asString() : "");
+        delete job;
+        return 0;
+    }
+
+    QObject::connect(job, &QGpgME::ListAllKeysJob::result, &app,
+                     [&timer](const GpgME::KeyListResult &result,
+                              const std::vector<GpgME::Key> &pub,
+                              const std::vector<GpgME::Key> &sec) {
+        qDebug() << "start:" << pub.size() << "public and" << sec.size() << "secret keys in"
+                 << timer.elapsed() << "ms, max RSS" << maxRss() << "KiB"
+                 << (result.error() ? result.error().asString() : "");
+        qApp->quit();
+    });
+    job->start(false);
+    return app.exec();
+}
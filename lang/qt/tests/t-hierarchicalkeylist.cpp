@@ -0,0 +1,207 @@
+/* t-hierarchicalkeylist.cpp
+
+    This file is part of qgpgme, the Qt API binding for gpgme
+    Copyright (c) 2021 g10 Code GmbH
+
+    QGpgME is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.
+
+    QGpgME is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of this program with any edition of
+    the Qt library by Trolltech AS, Norway (or with modified versions
+    of Qt that use the same license as Qt), and distribute linked
+    combinations including the two.  You must obey the GNU General
+    Public License in all respects for all of the code used other than
+    Qt.  If you modify this file, you may extend this exception to
+    your version of the file, but you are not obligated to do so.  If
+    you do not wish to do so, delete this exception statement from
+    your version.
+*/
+#ifdef HAVE_CONFIG_H
+ #include "config.h"
+#endif
+
+#include <QDebug>
+#include <QTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QSignalSpy>
+#include <QElapsedTimer>
+#include "hierarchicalkeylistjob.h"
+#include "qgpgmebackend.h"
+#include "keylistresult.h"
+#include "importresult.h"
+
+#include "context.h"
+#include "data.h"
+
+#include <algorithm>
+#include <memory>
+#include <set>
+
+#include "t-support.h"
+
+using namespace QGpgME;
+using namespace GpgME;
+
+/* The test certificates of tests/gpgsm: a self-signed certificate and
+   a CA certificate issued by a root certificate.  */
+static const char testCertFpr[] = "3CF405464F66ED4A7DF45BBDD1E4282E33BDB76E";
+static const char caCertFpr[] = "2C8F3C356AB761CB3674835B792CDA52937F9285";
+static const char rootCertFpr[] = "DFA56FB5FC41E3A8921F77AD1622EEFD9152A5AD";
+
+class HierarchicalKeyListTest : public QGpgMETest
+{
+    Q_OBJECT
+
+Q_SIGNALS:
+    void asyncDone();
+
+private:
+    /* Lists the hierarchy of the certificates matching PATTERNS and
+       returns the fingerprints of the listed certificates at FPRS and
+       the number of gpgsm listings at LISTINGS.  The largest number of
+       listings which were still running or pending when a listing
+       finished is stored in mMaxOutstanding.  */
+    void listHierarchy(const QStringList &patterns, std::multiset<std::string> &fprs, int &listings)
+    {
+        auto job = new HierarchicalKeyListJob(smime());
+        listings = 0;
+        mMaxOutstanding = 0;
+        connect(job, &Job::progress, this, [this, &listings](const QString &, int current, int total) {
+            listings = current;
+            mMaxOutstanding = std::max(mMaxOutstanding, total - current);
+        });
+        connect(job, &KeyListJob::result, this, [this, &fprs](KeyListResult result, std::vector<Key> keys, QString, Error)
+        {
+            QVERIFY(!result.error());
+            for (const Key &key : keys) {
+                fprs.insert(key.primaryFingerprint());
+            }
+            Q_EMIT asyncDone();
+        });
+
+        QElapsedTimer timer;
+        timer.start();
+        QVERIFY(!job->start(patterns));
+        QSignalSpy spy (this, SIGNAL(asyncDone()));
+        QVERIFY(spy.wait(QSIGNALSPY_TIMEOUT));
+        qDebug() << patterns.size() << "patterns:" << listings << "gpgsm listings in"
+                 << timer.elapsed() << "ms";
+    }
+
+private Q_SLOTS:
+    void testIssuerIsListed()
+    {
+        std::multiset<std::string> fprs;
+        int listings;
+        listHierarchy(QStringList() << QLatin1String(caCertFpr), fprs, listings);
+        QCOMPARE(fprs, std::multiset<std::string>({ caCertFpr, rootCertFpr }));
+        QCOMPARE(listings, 2);
+    }
+
+    void testListedIssuerIsNotLookedUp()
+    {
+        std::multiset<std::string> fprs;
+        int listings;
+        listHierarchy(QStringList() << QLatin1String(caCertFpr) << QLatin1String(rootCertFpr),
+                      fprs, listings);
+        QCOMPARE(fprs, std::multiset<std::string>({ caCertFpr, rootCertFpr }));
+        QCOMPARE(listings, 1);
+    }
+
+    void testManyPatterns()
+    {
+        // The patterns don't fit on one command line; the last one
+        // must not be lost and its issuer is looked up afterwards.
+        QStringList patterns;
+        for (int i = 0; i < 59; i++) {
+            patterns << QLatin1String(testCertFpr);
+        }
+        patterns << QLatin1String(caCertFpr);
+
+        std::multiset<std::string> fprs;
+        int listings;
+        listHierarchy(patterns, fprs, listings);
+        QCOMPARE(fprs, std::multiset<std::string>({ testCertFpr, caCertFpr, rootCertFpr }));
+        QCOMPARE(listings, 4);
+    }
+
+    void testConcurrencyLimit()
+    {
+        // 21 fingerprints fit into one listing, i.e. the patterns need
+        // 10 listings of which at most 4 may run at the same time.
+        QStringList patterns;
+        for (int i = 0; i < 200; i++) {
+            patterns << QLatin1String(testCertFpr);
+        }
+
+        std::multiset<std::string> fprs;
+        int listings;
+        listHierarchy(patterns, fprs, listings);
+        QCOMPARE(fprs, std::multiset<std::string>({ testCertFpr }));
+        QCOMPARE(listings, 10);
+        // the 3 other running listings plus the pending patterns
+        QCOMPARE(mMaxOutstanding, 4);
+    }
+
+    void testExec()
+    {
+        std::unique_ptr<HierarchicalKeyListJob> job(new HierarchicalKeyListJob(smime()));
+        std::vector<Key> keys;
+        const KeyListResult result = job->exec(QStringList() << QLatin1String(caCertFpr),
+                                               false, keys);
+        QVERIFY(!result.error());
+        QCOMPARE(keys.size(), 2u);
+        QVERIFY(!strcmp(keys[0].primaryFingerprint(), caCertFpr));
+        QVERIFY(!strcmp(keys[1].primaryFingerprint(), rootCertFpr));
+    }
+
+    void initTestCase()
+    {
+        QGpgMETest::initTestCase();
+        QVERIFY(mDir.isValid());
+        qputenv("GNUPGHOME", mDir.path().toUtf8());
+        QFile conf(mDir.path() + QStringLiteral("/gpgsm.conf"));
+        QVERIFY(conf.open(QIODevice::WriteOnly));
+        conf.write("disable-crl-checks\n");
+        conf.close();
+
+        auto ctx = std::unique_ptr<Context>(Context::createForProtocol(CMS));
+        QVERIFY(ctx);
+        for (const char *name : { "cert_g10code_test1.der", "cert_dfn_pca01.der",
+                                  "cert_dfn_pca15.der" }) {
+            QFile file(QStringLiteral(GPGSM_CERT_DIR "/") + QLatin1String(name));
+            QVERIFY(file.open(QIODevice::ReadOnly));
+            const QByteArray der = file.readAll();
+            const ImportResult result = ctx->importKeys(Data(der.constData(), der.size()));
+            QVERIFY(!result.error());
+            QCOMPARE(result.numImported(), 1);
+        }
+    }
+
+    void cleanupTestCase()
+    {
+        QGpgMETest::cleanupTestCase();
+        killAgent(mDir.path());
+    }
+
+private:
+    QTemporaryDir mDir;
+    int mMaxOutstanding;
+};
+
+QTEST_MAIN(HierarchicalKeyListTest)
+
+#include "t-hierarchicalkeylist.moc"
@@ -45,8 +45,11 @@
 
 #include "context.h"
 #include "engineinfo.h"
+#include "interfaces/progressprovider.h"
 
 #include <memory>
+#include <set>
+#include <thread>
 
 #include "t-support.h"
 
@@ -141,6 +144,100 @@ private Q_SLOTS:
         QVERIFY(spy.wait(QSIGNALSPY_TIMEOUT));
     }
 
+    void testKeyListAsyncBatches()
+    {
+        std::vector<Key> syncKeys;
+        {
+            std::unique_ptr<KeyListJob> job(openpgp()->keyListJob());
+            QVERIFY(!job->exec(QStringList(), false, syncKeys).error());
+        }
+        std::multiset<std::string> syncFprs;
+        for (const Key &key : syncKeys) {
+            syncFprs.insert(key.primaryFingerprint());
+        }
+
+        KeyListJob *job = openpgp()->keyListJob();
+        job->setKeyBatching(5, 1000000);
+        std::vector<size_t> batches;
+        std::multiset<std::string> batchFprs;
+        int nSingleKeys = 0;
+        bool done = false;
+        connect(job, &KeyListJob::nextKeys, job, [&batches, &batchFprs, &done](const std::vector<Key> &keys)
+        {
+            QVERIFY(!done);
+            QVERIFY(!keys.empty());
+            batches.push_back(keys.size());
+            for (const Key &key : keys) {
+                batchFprs.insert(key.primaryFingerprint());
+            }
+        });
+        connect(job, &KeyListJob::nextKey, job, [&nSingleKeys](const Key &)
+        {
+            nSingleKeys++;
+        });
+        connect(job, &KeyListJob::result, job, [this, &done](KeyListResult result, std::vector<Key> keys, QString, Error)
+        {
+            QVERIFY(!result.error());
+            QCOMPARE(keys.size(), 26u);
+            done = true;
+            Q_EMIT asyncDone();
+        });
+        job->start(QStringList());
+        QSignalSpy spy (this, SIGNAL(asyncDone()));
+        QVERIFY(spy.wait(QSIGNALSPY_TIMEOUT));
+
+        // All keys arrive in batches before the result.  The batches of
+        // 5 keys may have been coalesced if they were delivered more
+        // slowly than the keys were listed; the last one has the rest.
+        QCOMPARE(syncKeys.size(), 26u);
+        QCOMPARE(batchFprs, syncFprs);
+        QCOMPARE(nSingleKeys, 26);
+        QVERIFY(!batches.empty());
+        for (size_t i = 0; i + 1 < batches.size(); i++) {
+            QCOMPARE(batches[i] % 5, 0u);
+        }
+        QCOMPARE(batches.back() % 5, 1u);
+    }
+
+    void testProgressCoalescing()
+    {
+        // The progress reported by the engine while the event loop is
+        // busy results in one progress() signal with the latest values.
+        std::unique_ptr<KeyListJob> job(openpgp()->keyListJob());
+        ProgressProvider *const provider = dynamic_cast<ProgressProvider *>(job.get());
+        QVERIFY(provider);
+        int nProgress = 0;
+        int lastCurrent = -1;
+        int lastTotal = -1;
+        connect(job.get(), &Job::progress, this, [&nProgress, &lastCurrent, &lastTotal](const QString &, int current, int total)
+        {
+            nProgress++;
+            lastCurrent = current;
+            lastTotal = total;
+        });
+
+        // like gpgme, report the progress from another thread
+        std::thread thread([provider]() {
+            for (int i = 1; i <= 1000; i++) {
+                provider->showProgress("test", 0, i, 1000);
+            }
+        });
+        thread.join();
+        QCOMPARE(nProgress, 0);
+        QCoreApplication::processEvents();
+        QCOMPARE(nProgress, 1);
+        QCOMPARE(lastCurrent, 1000);
+        QCOMPARE(lastTotal, 1000);
+
+        // the next progress is reported again
+        provider->showProgress("test", 0, 1, 2);
+        provider->showProgress("test", 0, 2, 2);
+        QCoreApplication::processEvents();
+        QCOMPARE(nProgress, 2);
+        QCOMPARE(lastCurrent, 2);
+        QCOMPARE(lastTotal, 2);
+    }
+
     void testListAllKeysSync()
     {
         const auto accumulateFingerprints = [](std::vector<std::string> &v, const Key &key) { v.push_back(std::string(key.primaryFingerprint())); return v; };
@@ -46,9 +46,16 @@
 #include "dn.h"
 #include "data.h"
 #include "dataprovider.h"
+#include "fingerprint.h"
+#include "keyindex.h"
 
 #include "t-support.h"
 
+#include <gpgme.h>
+
+#include <cstdlib>
+#include <cstring>
+
 using namespace QGpgME;
 using namespace GpgME;
 
@@ -66,6 +73,26 @@ static const char aKey[] = "-----BEGIN PGP PUBLIC KEY BLOCK-----\n"
 "=p2Oj\n"
 "-----END PGP PUBLIC KEY BLOCK-----\n";
 
+/* Returns a key with the primary fingerprint FPR.  gpg 2.1 and later
+ * do not list v3 keys anymore, thus the key is built by hand.  */
+static Key makeKey(const char *fpr, bool secret)
+{
+    const gpgme_key_t key = static_cast<gpgme_key_t>(calloc(1, sizeof *key));
+    const gpgme_subkey_t subkey = static_cast<gpgme_subkey_t>(calloc(1, sizeof *subkey));
+    subkey->fpr = strdup(fpr);
+    subkey->keyid = subkey->_keyid;
+    const size_t len = strlen(fpr);
+    strncpy(subkey->_keyid, len > 16 ? fpr + len - 16 : fpr, 16);
+    subkey->secret = secret;
+    key->_refs = 1;
+    key->protocol = GPGME_PROTOCOL_OpenPGP;
+    key->secret = secret;
+    key->subkeys = subkey;
+    key->_last_subkey = subkey;
+    key->fpr = subkey->fpr;
+    return Key(key, false);
+}
+
 class TestVarious: public QGpgMETest
 {
     Q_OBJECT
@@ -98,6 +125,44 @@ private Q_SLOTS:
         QVERIFY(key.primaryFingerprint() == QStringLiteral("7A0904B6950DA998020A1AD4BE41C0C3A5FF1F3C"));
     }
 
+    void testKeyIndex()
+    {
+        static const char v3Fpr[] = "5A3F1D0B8CCA3F5E2D18B22A57D8D0E1";
+        static const char v4Fpr[] = "A0FF4590BB6122EDEF6E3C542D727CC768697734";
+        static const char v5Fpr[] = "19347BC9872464025F99DF3EC2E0000ED9884892E1F7B3EA4C94009159569B54";
+
+        QCOMPARE(Fingerprint(v3Fpr).size(), 16u);
+        QCOMPARE(Fingerprint(v4Fpr).size(), 20u);
+        QCOMPARE(Fingerprint(v5Fpr).size(), 32u);
+        QCOMPARE(Fingerprint(v3Fpr).toString(), std::string(v3Fpr));
+        QVERIFY(Fingerprint("5A3F1D0B8CCA3F5E2D18B22A57D8D0E").isNull());
+        QVERIFY(Fingerprint("5A3F1D0B8CCA3F5E2D18B22A57D8D0EX").isNull());
+
+        // the public and the secret keys as merged by ListAllKeysJob
+        KeyIndex index;
+        index.merge(makeKey(v4Fpr, false));
+        index.merge(makeKey(v3Fpr, false));
+        index.merge(makeKey("bogus", false));
+        index.merge(makeKey(v3Fpr, true));
+        index.merge(makeKey(v5Fpr, true));
+        QCOMPARE(index.size(), std::size_t(4));
+        QVERIFY(index.contains(Fingerprint(v3Fpr)));
+        QVERIFY(index.find(Fingerprint(v3Fpr)).hasSecret());
+        QVERIFY(!index.find(Fingerprint(v4Fpr)).hasSecret());
+        QVERIFY(!index.insert(makeKey(v3Fpr, false)));
+        QVERIFY(index.insert(makeKey("bogus", false)));
+        QVERIFY(!index.insert(Key()));
+        QCOMPARE(index.size(), std::size_t(5));
+
+        const std::vector<Key> keys = index.sortedKeys();
+        QCOMPARE(keys.size(), std::size_t(5));
+        QVERIFY(!strcmp(keys[0].primaryFingerprint(), "bogus"));
+        QVERIFY(!strcmp(keys[1].primaryFingerprint(), "bogus"));
+        QVERIFY(!strcmp(keys[2].primaryFingerprint(), v5Fpr));
+        QVERIFY(!strcmp(keys[3].primaryFingerprint(), v3Fpr));
+        QVERIFY(!strcmp(keys[4].primaryFingerprint(), v4Fpr));
+    }
+
     void testDataRewind()
     {
         if (GpgME::engineInfo(GpgME::GpgEngine).engineVersion() < "2.1.14") {
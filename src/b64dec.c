@@ -106,6 +106,32 @@ _gpgme_b64dec_proc (struct b64state *state, void *buffer, size_t length,
 
   for (s=d=buffer; length && !state->stop_seen; length--, s++)
     {
+      if (ds == s_b64_0 && length > 4)
+        {
+          /* Fast path: As long as we are at the start of a quad and
+             the next four characters are all valid base64 characters
+             we can decode them in one go without running them
+             through the state machine.  We always leave at least one
+             character for the regular processing below.  */
+          const unsigned char *u = (const unsigned char *)s;
+          unsigned int c0, c1, c2, c3;
+
+          while (length > 4
+                 && !((u[0] | u[1] | u[2] | u[3]) & 0x80)
+                 && (c0 = asctobin[u[0]]) != 0xff
+                 && (c1 = asctobin[u[1]]) != 0xff
+                 && (c2 = asctobin[u[2]]) != 0xff
+                 && (c3 = asctobin[u[3]]) != 0xff)
+            {
+              *d++ = (c0 << 2) | (c1 >> 4);
+              *d++ = ((c1 << 4) & 0xf0) | (c2 >> 2);
+              *d++ = ((c2 << 6) & 0xc0) | c3;
+              u += 4;
+              length -= 4;
+            }
+          s = (char *)u;
+        }
+
     again:
       switch (ds)
         {
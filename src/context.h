@@ -21,6 +21,8 @@
 #ifndef CONTEXT_H
 #define CONTEXT_H
 
+#include <stdint.h>
+
 #include "gpgme.h"
 #include "engine.h"
 #include "wait.h"
@@ -39,7 +41,8 @@ typedef enum
     OPDATA_IMPORT, OPDATA_GENKEY, OPDATA_KEYLIST, OPDATA_EDIT,
     OPDATA_VERIFY, OPDATA_TRUSTLIST, OPDATA_ASSUAN, OPDATA_VFS_MOUNT,
     OPDATA_PASSWD, OPDATA_EXPORT, OPDATA_KEYSIGN, OPDATA_TOFU_POLICY,
-    OPDATA_QUERY_SWDB, OPDATA_SETEXPIRE, OPDATA_REVSIG
+    OPDATA_QUERY_SWDB, OPDATA_SETEXPIRE, OPDATA_REVSIG,
+    OPDATA_KEYLIST_RECORDS
   } ctx_op_data_id_t;
 
 
@@ -72,6 +75,8 @@ struct ctx_op_data
 typedef struct ctx_op_data *ctx_op_data_t;
 
 
+struct keylist_filter_s;
+
 /* The context defines an environment in which crypto operations can
    be performed (sequentially).  */
 struct gpgme_context
@@ -81,6 +86,53 @@ struct gpgme_context
   /* True if the context was canceled asynchronously.  */
   int canceled;
 
+  /* A pipe used by gpgme_cancel_async to wake up the private event
+   * loop.  Created on first use; -1 if not yet created.  */
+  int wakeup_fd[2];
+
+  /* The timeout for an operation in milliseconds or 0 for none, and
+   * the resulting deadline of the current operation in terms of
+   * _gpgme_get_monotonic_ms.  */
+  unsigned int timeout;
+  uint64_t deadline;
+
+  /* The buffer for the value of a numeric flag returned by
+   * gpgme_get_ctx_flag.  */
+  char flag_value[11];
+
+  /* The time to live in seconds for entries of the verify cache or 0
+   * if the cache is not used.  */
+  unsigned int verify_cache_ttl;
+
+  /* The maximum number of keys returned by a key listing or 0 for no
+   * limit.  */
+  unsigned int keylist_limit;
+
+  /* The minimum time in milliseconds and the minimum advance of the
+   * current value between two calls of the progress callback for the
+   * same item, or 0 to call it for every progress status line.  */
+  unsigned int progress_interval;
+  unsigned int progress_delta;
+
+  /* The item of the last progress event of the current operation,
+   * the allocated size of that buffer, the current value and the time
+   * of the last event passed to the progress callback in terms of
+   * _gpgme_get_monotonic_ms.  If PROGRESS_PENDING is set a later event
+   * for the item has been dropped; it is kept in the PROGRESS_PENDING_
+   * fields and passed before the next item or at the end of the
+   * operation.  */
+  char *progress_what;
+  size_t progress_what_size;
+  int progress_current;
+  uint64_t progress_time;
+  unsigned int progress_pending : 1;
+  int progress_pending_type;
+  int progress_pending_current;
+  int progress_pending_total;
+
+  /* The filter for key listings or NULL.  */
+  struct keylist_filter_s *keylist_filter;
+
   /* The engine info for this context.  */
   gpgme_engine_info_t engine_info;
 
@@ -137,6 +189,9 @@ struct gpgme_context
   /* Pass --expert to gpg edit key. */
   unsigned int extended_edit : 1;
 
+  /* True if the signatures of keys shall be parsed on demand.  */
+  unsigned int lazy_key_sigs : 1;
+
   /* Flags for keylist mode.  */
   gpgme_keylist_mode_t keylist_mode;
 
@@ -189,6 +244,10 @@ struct gpgme_context
   gpgme_status_cb_t status_cb;
   void *status_cb_value;
 
+  /* The user provided import callback and its hook value.  */
+  gpgme_import_cb_t import_cb;
+  void *import_cb_value;
+
   /* A list of file descriptors in active use by the current
      operation.  */
   struct fd_table fdt;
@@ -0,0 +1,370 @@
+/* ctx-pool.c - A pool of contexts for reuse.
+ * Copyright (C) 2021 g10 Code GmbH
+ *
+ * This file is part of GPGME.
+ *
+ * GPGME is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * GPGME is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <https://gnu.org/licenses/>.
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+
+#include "util.h"
+#include "context.h"
+#include "ops.h"
+#include "engine.h"
+#include "priv-io.h"
+#include "debug.h"
+
+
+/* The default for the maximum number of idle contexts.  */
+#define DEFAULT_MAX_IDLE 16
+
+
+/* A pool of contexts.  All contexts handed out by the pool are
+ * configured like the template context TEMPL.  */
+struct gpgme_ctx_pool
+{
+  DECLARE_LOCK (lock);
+
+  /* A private context holding the settings for the handed out
+   * contexts.  It is never used for an operation.  */
+  gpgme_ctx_t templ;
+
+  /* The idle contexts.  */
+  unsigned int max_idle;
+  unsigned int nidle;
+  gpgme_ctx_t *idle;
+
+  struct _gpgme_ctx_pool_stats stats;
+};
+
+
+
+/* Replace the string at DST by a copy of SRC unless they are equal.  */
+static gpgme_error_t
+copy_string (char **dst, const char *src)
+{
+  char *p;
+
+  if ((!*dst && !src) || (*dst && src && !strcmp (*dst, src)))
+    return 0;
+
+  if (src)
+    {
+      p = strdup (src);
+      if (!p)
+        return gpg_error_from_syserror ();
+    }
+  else
+    p = NULL;
+  free (*dst);
+  *dst = p;
+  return 0;
+}
+
+
+/* Return true if the engine info lists A and B are the same.  */
+static int
+engine_info_equal (gpgme_engine_info_t a, gpgme_engine_info_t b)
+{
+  for (; a && b; a = a->next, b = b->next)
+    {
+      if (a->protocol != b->protocol
+          || !a->file_name != !b->file_name
+          || (a->file_name && strcmp (a->file_name, b->file_name))
+          || !a->home_dir != !b->home_dir
+          || (a->home_dir && strcmp (a->home_dir, b->home_dir)))
+        return 0;
+    }
+  return !a && !b;
+}
+
+
+/* Configure CTX like TEMPL and remove all state left over from
+ * previous operations.  A running engine is kept if the protocol and
+ * the engine info did not change so that it can be reset and reused
+ * by the next operation.  */
+static gpgme_error_t
+apply_template (gpgme_ctx_t ctx, gpgme_ctx_t templ)
+{
+  gpgme_error_t err = 0;
+  gpgme_engine_info_t info;
+
+  _gpgme_release_result (ctx);
+  _gpgme_signers_clear (ctx);
+  _gpgme_sig_notation_clear (ctx);
+
+  LOCK (ctx->lock);
+  ctx->canceled = 0;
+  ctx->redraw_suggested = 0;
+  UNLOCK (ctx->lock);
+  _gpgme_progress_reset (ctx);
+
+  if (ctx->protocol != templ->protocol
+      || !engine_info_equal (ctx->engine_info, templ->engine_info))
+    {
+      _gpgme_engine_release (ctx->engine);
+      ctx->engine = NULL;
+      ctx->protocol = templ->protocol;
+      for (info = templ->engine_info; info && !err; info = info->next)
+        err = _gpgme_set_engine_info (ctx->engine_info, info->protocol,
+                                      info->file_name, info->home_dir);
+      if (err)
+        return err;
+    }
+  ctx->sub_protocol = templ->sub_protocol;
+
+  ctx->use_armor           = templ->use_armor;
+  ctx->use_textmode        = templ->use_textmode;
+  ctx->offline             = templ->offline;
+  ctx->full_status         = templ->full_status;
+  ctx->raw_description     = templ->raw_description;
+  ctx->export_session_keys = templ->export_session_keys;
+  ctx->include_key_block   = templ->include_key_block;
+  ctx->auto_key_import     = templ->auto_key_import;
+  ctx->auto_key_retrieve   = templ->auto_key_retrieve;
+  ctx->no_symkey_cache     = templ->no_symkey_cache;
+  ctx->ignore_mdc_error    = templ->ignore_mdc_error;
+  ctx->extended_edit       = templ->extended_edit;
+  ctx->lazy_key_sigs       = templ->lazy_key_sigs;
+  ctx->keylist_mode        = templ->keylist_mode;
+  ctx->pinentry_mode       = templ->pinentry_mode;
+  ctx->include_certs       = templ->include_certs;
+  ctx->timeout             = templ->timeout;
+  ctx->verify_cache_ttl    = templ->verify_cache_ttl;
+  ctx->keylist_limit       = templ->keylist_limit;
+  ctx->progress_interval   = templ->progress_interval;
+  ctx->progress_delta      = templ->progress_delta;
+
+  if (!err && (ctx->keylist_filter || templ->keylist_filter))
+    err = _gpgme_keylist_filter_copy (ctx, templ);
+  if (!err)
+    err = copy_string (&ctx->sender, templ->sender);
+  if (!err)
+    err = copy_string (&ctx->override_session_key,
+                       templ->override_session_key);
+  if (!err)
+    err = copy_string (&ctx->request_origin, templ->request_origin);
+  if (!err)
+    err = copy_string (&ctx->auto_key_locate, templ->auto_key_locate);
+  if (!err)
+    err = copy_string (&ctx->trust_model, templ->trust_model);
+  if (!err)
+    err = copy_string (&ctx->lc_ctype, templ->lc_ctype);
+  if (!err)
+    err = copy_string (&ctx->lc_messages, templ->lc_messages);
+  if (err)
+    return err;
+
+  ctx->passphrase_cb       = templ->passphrase_cb;
+  ctx->passphrase_cb_value = templ->passphrase_cb_value;
+  ctx->progress_cb         = templ->progress_cb;
+  ctx->progress_cb_value   = templ->progress_cb_value;
+  ctx->status_cb           = templ->status_cb;
+  ctx->status_cb_value     = templ->status_cb_value;
+  ctx->import_cb           = templ->import_cb;
+  ctx->import_cb_value     = templ->import_cb_value;
+  ctx->io_cbs              = templ->io_cbs;
+
+  return 0;
+}
+
+
+
+/* Create a new context pool and return it at R_POOL.  The settings
+ * of TEMPL (protocol, engine info, flags, callbacks, etc.) are copied
+ * and used for all contexts handed out by the pool.  If TEMPL is NULL
+ * the defaults of gpgme_new are used.  At most MAX_IDLE unused
+ * contexts are kept; 0 selects a default.  */
+gpgme_error_t
+gpgme_ctx_pool_new (gpgme_ctx_pool_t *r_pool, gpgme_ctx_t templ,
+                    unsigned int max_idle)
+{
+  gpgme_error_t err;
+  gpgme_ctx_pool_t pool;
+
+  TRACE_BEG (DEBUG_CTX, "gpgme_ctx_pool_new", r_pool,
+             "templ=%p, max_idle=%u", templ, max_idle);
+
+  if (!r_pool)
+    return TRACE_ERR (gpg_error (GPG_ERR_INV_VALUE));
+  *r_pool = NULL;
+
+  pool = calloc (1, sizeof *pool);
+  if (!pool)
+    return TRACE_ERR (gpg_error_from_syserror ());
+  INIT_LOCK (pool->lock);
+  pool->max_idle = max_idle? max_idle : DEFAULT_MAX_IDLE;
+  pool->idle = calloc (pool->max_idle, sizeof *pool->idle);
+  if (!pool->idle)
+    {
+      err = gpg_error_from_syserror ();
+      goto leave;
+    }
+
+  err = gpgme_new (&pool->templ);
+  if (!err && templ)
+    err = apply_template (pool->templ, templ);
+  if (err)
+    goto leave;
+
+  *r_pool = pool;
+  pool = NULL;
+
+ leave:
+  if (pool)
+    {
+      gpgme_release (pool->templ);
+      free (pool->idle);
+      DESTROY_LOCK (pool->lock);
+      free (pool);
+    }
+  if (err)
+    return TRACE_ERR (err);
+  TRACE_SUC ("pool=%p", *r_pool);
+  return 0;
+}
+
+
+/* Release the context pool POOL and all its idle contexts.  Contexts
+ * which are still acquired are not affected and need to be released
+ * with gpgme_release.  */
+void
+gpgme_ctx_pool_release (gpgme_ctx_pool_t pool)
+{
+  TRACE (DEBUG_CTX, "gpgme_ctx_pool_release", pool, "");
+
+  if (!pool)
+    return;
+
+  while (pool->nidle)
+    gpgme_release (pool->idle[--pool->nidle]);
+  free (pool->idle);
+  gpgme_release (pool->templ);
+  DESTROY_LOCK (pool->lock);
+  free (pool);
+}
+
+
+/* Take a context from POOL and store it at R_CTX.  If no idle context
+ * is available a new one is created.  The context is configured like
+ * the template of the pool and must be given back to the pool with
+ * gpgme_ctx_pool_recycle.  This function is thread-safe.  */
+gpgme_error_t
+gpgme_ctx_pool_acquire (gpgme_ctx_pool_t pool, gpgme_ctx_t *r_ctx)
+{
+  gpgme_error_t err;
+  gpgme_ctx_t ctx = NULL;
+
+  TRACE_BEG (DEBUG_CTX, "gpgme_ctx_pool_acquire", pool, "");
+
+  if (!pool || !r_ctx)
+    return TRACE_ERR (gpg_error (GPG_ERR_INV_VALUE));
+  *r_ctx = NULL;
+
+  LOCK (pool->lock);
+  if (pool->nidle)
+    {
+      ctx = pool->idle[--pool->nidle];
+      pool->stats.reused++;
+    }
+  UNLOCK (pool->lock);
+
+  if (!ctx)
+    {
+      /* Note that the template is not modified after the creation of
+       * the pool and thus we do not need to hold the lock.  */
+      err = gpgme_new (&ctx);
+      if (!err)
+        err = apply_template (ctx, pool->templ);
+      if (err)
+        {
+          gpgme_release (ctx);
+          return TRACE_ERR (err);
+        }
+      LOCK (pool->lock);
+      pool->stats.created++;
+      UNLOCK (pool->lock);
+    }
+
+  LOCK (pool->lock);
+  pool->stats.in_use++;
+  UNLOCK (pool->lock);
+
+  *r_ctx = ctx;
+  TRACE_SUC ("ctx=%p", ctx);
+  return 0;
+}
+
+
+/* Give the context CTX, which has been acquired from POOL, back to
+ * the pool.  All state of the previous operations is removed and the
+ * settings are reset to those of the pool's template.  If the pool is
+ * full or CTX has a pending operation it is released instead.  This
+ * function is thread-safe.  */
+void
+gpgme_ctx_pool_recycle (gpgme_ctx_pool_t pool, gpgme_ctx_t ctx)
+{
+  gpgme_error_t err;
+
+  TRACE_BEG (DEBUG_CTX, "gpgme_ctx_pool_recycle", pool, "ctx=%p", ctx);
+
+  if (!pool || !ctx)
+    {
+      TRACE_SUC ("");
+      return;
+    }
+
+  if (_gpgme_op_is_pending (ctx))
+    err = gpg_error (GPG_ERR_EBUSY);
+  else
+    err = apply_template (ctx, pool->templ);
+
+  LOCK (pool->lock);
+  if (pool->stats.in_use)
+    pool->stats.in_use--;
+  if (!err && pool->nidle < pool->max_idle)
+    {
+      pool->idle[pool->nidle++] = ctx;
+      pool->stats.recycled++;
+      ctx = NULL;
+    }
+  else
+    pool->stats.discarded++;
+  UNLOCK (pool->lock);
+
+  gpgme_release (ctx);
+  TRACE_SUC ("");
+}
+
+
+/* Store the counters of POOL at R_STATS.  */
+gpgme_error_t
+gpgme_ctx_pool_get_stats (gpgme_ctx_pool_t pool,
+                          gpgme_ctx_pool_stats_t r_stats)
+{
+  if (!pool || !r_stats)
+    return gpg_error (GPG_ERR_INV_VALUE);
+
+  LOCK (pool->lock);
+  *r_stats = pool->stats;
+  r_stats->idle = pool->nidle;
+  UNLOCK (pool->lock);
+  return 0;
+}
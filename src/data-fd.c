@@ -25,9 +25,11 @@
 #ifdef HAVE_UNISTD_H
 # include <unistd.h>
 #endif
+#include <fcntl.h>
 #ifdef HAVE_SYS_TYPES_H
 # include <sys/types.h>
 #endif
+#include <sys/stat.h>
 
 #include "debug.h"
 #include "data.h"
@@ -85,3 +87,114 @@ gpgme_data_new_from_fd (gpgme_data_t *r_dh, int fd)
   TRACE_SUC ("dh=%p", *r_dh);
   return 0;
 }
+
+
+static void
+pipe_release (gpgme_data_t dh)
+{
+  if (dh->data.fd != -1)
+    close (dh->data.fd);
+}
+
+
+/* The data objects of gpgme_data_new_pipe own their file descriptor
+   and are not seekable.  */
+static struct _gpgme_data_cbs pipe_cbs =
+  {
+    fd_read,
+    fd_write,
+    NULL,
+    pipe_release,
+    fd_get_fd
+  };
+
+
+gpgme_error_t
+gpgme_data_new_pipe (gpgme_data_t *r_writer, gpgme_data_t *r_reader)
+{
+#ifdef HAVE_W32_SYSTEM
+  (void)r_writer;
+  (void)r_reader;
+  return gpg_error (GPG_ERR_NOT_IMPLEMENTED);
+#else
+  gpgme_error_t err;
+  int fds[2];
+  TRACE_BEG  (DEBUG_DATA, "gpgme_data_new_pipe", r_writer,
+	      "r_reader=%p", r_reader);
+
+  if (!r_writer || !r_reader)
+    return TRACE_ERR (gpg_error (GPG_ERR_INV_VALUE));
+  *r_writer = *r_reader = NULL;
+
+  if (pipe (fds))
+    return TRACE_ERR (gpg_error_from_syserror ());
+  fcntl (fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl (fds[1], F_SETFD, FD_CLOEXEC);
+
+  err = _gpgme_data_new (r_writer, &pipe_cbs);
+  if (err)
+    {
+      close (fds[0]);
+      close (fds[1]);
+      return TRACE_ERR (err);
+    }
+  (*r_writer)->data.fd = fds[1];
+
+  err = _gpgme_data_new (r_reader, &pipe_cbs);
+  if (err)
+    {
+      close (fds[0]);
+      gpgme_data_release (*r_writer);
+      *r_writer = NULL;
+      return TRACE_ERR (err);
+    }
+  (*r_reader)->data.fd = fds[0];
+
+  TRACE_SUC ("writer=%p reader=%p", *r_writer, *r_reader);
+  return 0;
+#endif
+}
+
+
+/* Return the file descriptor of DH if DH has been created by
+   gpgme_data_new_from_fd for a regular file or by gpgme_data_new_pipe
+   and no data is buffered in DH.  Such a file descriptor can be handed
+   to an engine process which then reads or writes the file itself.
+   Note that the file offset is shared and thus the result is the same
+   as if the data had been copied through a pipe.  Otherwise return
+   -1.  */
+int
+_gpgme_data_get_direct_fd (gpgme_data_t dh)
+{
+#ifdef HAVE_W32_SYSTEM
+  (void)dh;
+  return -1;
+#else
+  struct stat st;
+
+  if (!dh || dh->pending_len)
+    return -1;
+  if (dh->cbs == &pipe_cbs)
+    return dh->data.fd;
+  if (dh->cbs != &fd_cbs)
+    return -1;
+  if (fstat (dh->data.fd, &st) || !S_ISREG (st.st_mode))
+    return -1;
+  return dh->data.fd;
+#endif
+}
+
+
+/* This is called after an engine process has been spawned with a copy
+   of the file descriptor returned by _gpgme_data_get_direct_fd.  Our
+   copy of a pipe end is closed so that the process at the other end
+   notices when the engine terminates.  */
+void
+_gpgme_data_direct_fd_passed (gpgme_data_t dh)
+{
+  if (dh && dh->cbs == &pipe_cbs && dh->data.fd != -1)
+    {
+      close (dh->data.fd);
+      dh->data.fd = -1;
+    }
+}
@@ -29,6 +29,10 @@
 #endif
 #include <assert.h>
 #include <string.h>
+#include <stddef.h>
+#ifdef HAVE_SYS_UIO_H
+# include <sys/uio.h>
+#endif
 
 #include "data.h"
 #include "util.h"
@@ -301,3 +305,219 @@ gpgme_free (void *buffer)
   if (buffer)
     free (buffer);
 }
+
+
+
+
+/* Chunked memory buffers.  */
+
+/* The chunk size used if 0 is passed to gpgme_data_new_chunked.  */
+#define DEFAULT_CHUNK_SIZE (256 * 1024)
+
+#ifdef HAVE_SYS_UIO_H
+/* Make sure that the segments can be passed to writev.  */
+typedef char segment_matches_iovec
+  [(sizeof (struct _gpgme_data_segment) == sizeof (struct iovec)
+    && offsetof (struct _gpgme_data_segment, base)
+       == offsetof (struct iovec, iov_base)
+    && offsetof (struct _gpgme_data_segment, len)
+       == offsetof (struct iovec, iov_len))? 1 : -1];
+#endif
+
+
+static gpgme_ssize_t
+chunked_read (gpgme_data_t dh, void *buffer, size_t size)
+{
+  size_t chunk_size = dh->data.chunked.chunk_size;
+  size_t offset = dh->data.chunked.offset;
+  size_t amt = dh->data.chunked.length - offset;
+  size_t pos, n, done;
+  char *p = buffer;
+
+  if (size < amt)
+    amt = size;
+
+  for (done = 0; done < amt; done += n, offset += n)
+    {
+      pos = offset % chunk_size;
+      n = chunk_size - pos;
+      if (n > amt - done)
+        n = amt - done;
+      memcpy (p + done, dh->data.chunked.chunks[offset / chunk_size] + pos, n);
+    }
+  dh->data.chunked.offset = offset;
+  return amt;
+}
+
+
+static gpgme_ssize_t
+chunked_write (gpgme_data_t dh, const void *buffer, size_t size)
+{
+  size_t chunk_size = dh->data.chunked.chunk_size;
+  size_t offset = dh->data.chunked.offset;
+  size_t end = offset + size;
+  size_t needed, pos, n, done;
+  const char *p = buffer;
+
+  if (end < offset)
+    {
+      gpg_err_set_errno (ENOMEM);
+      return -1;
+    }
+
+  /* Only new chunks are allocated; the existing data is never moved.  */
+  needed = end / chunk_size + !!(end % chunk_size);
+  if (needed > dh->data.chunked.chunks_alloc)
+    {
+      size_t new_size = dh->data.chunked.chunks_alloc
+        ? 2 * dh->data.chunked.chunks_alloc : 16;
+      char **new_chunks;
+
+      if (new_size < needed)
+        new_size = needed;
+      new_chunks = realloc (dh->data.chunked.chunks,
+                            new_size * sizeof *new_chunks);
+      if (!new_chunks)
+        return -1;
+      dh->data.chunked.chunks = new_chunks;
+      dh->data.chunked.chunks_alloc = new_size;
+    }
+  while (dh->data.chunked.nchunks < needed)
+    {
+      char *chunk = malloc (chunk_size);
+
+      if (!chunk)
+        return -1;
+      dh->data.chunked.chunks[dh->data.chunked.nchunks++] = chunk;
+    }
+
+  for (done = 0; done < size; done += n, offset += n)
+    {
+      pos = offset % chunk_size;
+      n = chunk_size - pos;
+      if (n > size - done)
+        n = size - done;
+      memcpy (dh->data.chunked.chunks[offset / chunk_size] + pos, p + done, n);
+    }
+  dh->data.chunked.offset = offset;
+  if (dh->data.chunked.length < offset)
+    dh->data.chunked.length = offset;
+  return size;
+}
+
+
+static gpgme_off_t
+chunked_seek (gpgme_data_t dh, gpgme_off_t offset, int whence)
+{
+  gpgme_off_t length = dh->data.chunked.length;
+
+  switch (whence)
+    {
+    case SEEK_SET:
+      break;
+    case SEEK_CUR:
+      offset += dh->data.chunked.offset;
+      break;
+    case SEEK_END:
+      offset += length;
+      break;
+    default:
+      gpg_err_set_errno (EINVAL);
+      return -1;
+    }
+  if (offset < 0 || offset > length)
+    {
+      gpg_err_set_errno (EINVAL);
+      return -1;
+    }
+  dh->data.chunked.offset = offset;
+  return offset;
+}
+
+
+static void
+chunked_release (gpgme_data_t dh)
+{
+  size_t i;
+
+  for (i = 0; i < dh->data.chunked.nchunks; i++)
+    free (dh->data.chunked.chunks[i]);
+  free (dh->data.chunked.chunks);
+  free (dh->data.chunked.segs);
+}
+
+
+static struct _gpgme_data_cbs chunked_cbs =
+  {
+    chunked_read,
+    chunked_write,
+    chunked_seek,
+    chunked_release,
+    NULL
+  };
+
+
+/* Create a new chunked data buffer and return it in R_DH.  */
+gpgme_error_t
+gpgme_data_new_chunked (gpgme_data_t *r_dh, size_t chunk_size)
+{
+  gpgme_error_t err;
+  TRACE_BEG  (DEBUG_DATA, "gpgme_data_new_chunked", r_dh,
+	      "chunk_size=%zu", chunk_size);
+
+  err = _gpgme_data_new (r_dh, &chunked_cbs);
+  if (err)
+    return TRACE_ERR (err);
+
+  (*r_dh)->data.chunked.chunk_size = chunk_size? chunk_size
+                                               : DEFAULT_CHUNK_SIZE;
+  TRACE_SUC ("dh=%p", *r_dh);
+  return 0;
+}
+
+
+/* Return the content of the chunked data buffer DH as an array of
+   segments at R_SEGS and the number of segments at R_NSEGS.  The
+   array is owned by DH and valid until DH is modified or released.  */
+gpgme_error_t
+gpgme_data_get_segments (gpgme_data_t dh, gpgme_data_segment_t *r_segs,
+                         size_t *r_nsegs)
+{
+  gpgme_error_t err;
+  struct _gpgme_data_segment *segs;
+  size_t chunk_size, length, nsegs, i;
+  int blankout;
+
+  TRACE_BEG  (DEBUG_DATA, "gpgme_data_get_segments", dh,
+	      "r_segs=%p, r_nsegs=%p", r_segs, r_nsegs);
+
+  if (!dh || dh->cbs != &chunked_cbs || !r_segs || !r_nsegs)
+    return TRACE_ERR (gpg_error (GPG_ERR_INV_VALUE));
+  *r_segs = NULL;
+  *r_nsegs = 0;
+
+  err = _gpgme_data_get_prop (dh, 0, DATA_PROP_BLANKOUT, &blankout);
+  if (err)
+    return TRACE_ERR (err);
+
+  chunk_size = dh->data.chunked.chunk_size;
+  length = blankout? 0 : dh->data.chunked.length;
+  nsegs = length / chunk_size + !!(length % chunk_size);
+
+  /* Allocate one extra item so that we never pass 0 to malloc.  */
+  segs = malloc ((nsegs + 1) * sizeof *segs);
+  if (!segs)
+    return TRACE_ERR (gpg_error_from_syserror ());
+  for (i = 0; i < nsegs; i++)
+    {
+      segs[i].base = dh->data.chunked.chunks[i];
+      segs[i].len = i + 1 < nsegs? chunk_size : length - i * chunk_size;
+    }
+  free (dh->data.chunked.segs);
+  dh->data.chunked.segs = segs;
+
+  *r_segs = segs;
+  *r_nsegs = nsegs;
+  TRACE_SUC ("nsegs=%zu", nsegs);
+  return 0;
+}
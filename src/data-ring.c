@@ -0,0 +1,325 @@
+/* data-ring.c - A ring buffer connecting two data objects.
+ * Copyright (C) 2021 g10 Code GmbH
+ *
+ * This file is part of GPGME.
+ *
+ * GPGME is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * GPGME is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <https://gnu.org/licenses/>.
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* A ring is a bounded buffer shared by a writer and a reader data
+ * object which are meant to be used by two different threads.  A
+ * thread blocked on an empty or full ring waits on a pipe of its own;
+ * the other end writes a byte to that pipe after it changed the state.
+ * A byte is only written if the thread is waiting and each wait
+ * consumes one byte.  */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "data.h"
+#include "sema.h"
+#include "priv-io.h"
+#include "debug.h"
+
+
+/* The capacity used if 0 is passed to gpgme_data_new_ring.  */
+#define DEFAULT_CAPACITY (64 * 1024)
+
+
+struct data_ring
+{
+  DECLARE_LOCK (lock);
+
+  char *buffer;
+  size_t size;
+
+  /* The offset of the first byte to read and the number of bytes
+   * which can be read.  */
+  size_t start;
+  size_t used;
+
+  /* Set when the writer resp. the reader has been released.  */
+  unsigned int writer_gone : 1;
+  unsigned int reader_gone : 1;
+
+  /* The pipes to wait on for the reader (index 0) and the writer
+   * (index 1).  */
+  struct
+  {
+    unsigned int waiting : 1;
+    int fd[2];
+  } wait[2];
+};
+
+
+
+/* Wait until the other end changed the state of RING.  WRITER tells
+ * whether the writer or the reader is waiting.  The caller must hold
+ * the lock which is temporarily released.  */
+static int
+ring_wait (struct data_ring *ring, int writer)
+{
+  char c;
+  int n;
+
+  ring->wait[writer].waiting = 1;
+  UNLOCK (ring->lock);
+  n = _gpgme_io_read (ring->wait[writer].fd[0], &c, 1);
+  LOCK (ring->lock);
+  if (n != 1)
+    {
+      ring->wait[writer].waiting = 0;
+      if (!n)
+        gpg_err_set_errno (EIO);
+      return -1;
+    }
+  return 0;
+}
+
+
+/* Wake up the writer resp. the reader if it is waiting.  The caller
+ * must hold the lock.  */
+static void
+ring_wakeup (struct data_ring *ring, int writer)
+{
+  if (ring->wait[writer].waiting)
+    {
+      ring->wait[writer].waiting = 0;
+      _gpgme_io_write (ring->wait[writer].fd[1], "", 1);
+    }
+}
+
+
+static gpgme_ssize_t
+ring_read (gpgme_data_t dh, void *buffer, size_t size)
+{
+  struct data_ring *ring = dh->data.ring.ring;
+  char *p = buffer;
+  size_t amt, n;
+
+  if (dh->data.ring.writer)
+    {
+      gpg_err_set_errno (EBADF);
+      return -1;
+    }
+  if (!size)
+    return 0;
+
+  LOCK (ring->lock);
+  while (!ring->used && !ring->writer_gone)
+    {
+      if (dh->data.ring.nonblock)
+        {
+          UNLOCK (ring->lock);
+          gpg_err_set_errno (EAGAIN);
+          return -1;
+        }
+      if (ring_wait (ring, 0))
+        {
+          UNLOCK (ring->lock);
+          return -1;
+        }
+    }
+
+  amt = size < ring->used? size : ring->used;
+  n = ring->size - ring->start;
+  if (n > amt)
+    n = amt;
+  memcpy (p, ring->buffer + ring->start, n);
+  memcpy (p + n, ring->buffer, amt - n);
+  ring->start = (ring->start + amt) % ring->size;
+  ring->used -= amt;
+  if (!ring->used)
+    ring->start = 0;
+  if (amt)
+    ring_wakeup (ring, 1);
+  UNLOCK (ring->lock);
+
+  return amt;
+}
+
+
+static gpgme_ssize_t
+ring_write (gpgme_data_t dh, const void *buffer, size_t size)
+{
+  struct data_ring *ring = dh->data.ring.ring;
+  const char *p = buffer;
+  size_t nwritten = 0;
+  size_t amt, pos, n;
+
+  if (!dh->data.ring.writer)
+    {
+      gpg_err_set_errno (EBADF);
+      return -1;
+    }
+
+  LOCK (ring->lock);
+  while (nwritten < size)
+    {
+      if (ring->reader_gone)
+        {
+          UNLOCK (ring->lock);
+          gpg_err_set_errno (EPIPE);
+          return -1;
+        }
+      if (ring->used == ring->size)
+        {
+          if (dh->data.ring.nonblock)
+            {
+              if (nwritten)
+                break;
+              UNLOCK (ring->lock);
+              gpg_err_set_errno (EAGAIN);
+              return -1;
+            }
+          if (ring_wait (ring, 1))
+            {
+              UNLOCK (ring->lock);
+              return -1;
+            }
+          continue;
+        }
+
+      amt = ring->size - ring->used;
+      if (amt > size - nwritten)
+        amt = size - nwritten;
+      pos = (ring->start + ring->used) % ring->size;
+      n = ring->size - pos;
+      if (n > amt)
+        n = amt;
+      memcpy (ring->buffer + pos, p + nwritten, n);
+      memcpy (ring->buffer, p + nwritten + n, amt - n);
+      ring->used += amt;
+      nwritten += amt;
+      ring_wakeup (ring, 0);
+    }
+  UNLOCK (ring->lock);
+
+  return nwritten;
+}
+
+
+static void
+ring_free (struct data_ring *ring)
+{
+  int i, j;
+
+  for (i = 0; i < 2; i++)
+    for (j = 0; j < 2; j++)
+      if (ring->wait[i].fd[j] != -1)
+        _gpgme_io_close (ring->wait[i].fd[j]);
+  DESTROY_LOCK (ring->lock);
+  free (ring->buffer);
+  free (ring);
+}
+
+
+static void
+ring_release (gpgme_data_t dh)
+{
+  struct data_ring *ring = dh->data.ring.ring;
+  int last;
+
+  LOCK (ring->lock);
+  if (dh->data.ring.writer)
+    ring->writer_gone = 1;
+  else
+    ring->reader_gone = 1;
+  last = ring->writer_gone && ring->reader_gone;
+  ring_wakeup (ring, 0);
+  ring_wakeup (ring, 1);
+  UNLOCK (ring->lock);
+
+  if (last)
+    ring_free (ring);
+}
+
+
+static struct _gpgme_data_cbs ring_cbs =
+  {
+    ring_read,
+    ring_write,
+    NULL,
+    ring_release,
+    NULL
+  };
+
+
+
+/* Create a ring buffer of CAPACITY bytes and return a data object to
+ * write to it at R_WRITER and one to read from it at R_READER.  */
+gpgme_error_t
+gpgme_data_new_ring (gpgme_data_t *r_writer, gpgme_data_t *r_reader,
+                     size_t capacity, unsigned int flags)
+{
+  gpgme_error_t err;
+  struct data_ring *ring;
+  TRACE_BEG  (DEBUG_DATA, "gpgme_data_new_ring", r_writer,
+	      "r_reader=%p, capacity=%zu, flags=0x%x",
+              r_reader, capacity, flags);
+
+  if (!r_writer || !r_reader)
+    return TRACE_ERR (gpg_error (GPG_ERR_INV_VALUE));
+  *r_writer = *r_reader = NULL;
+
+  ring = calloc (1, sizeof *ring);
+  if (!ring)
+    return TRACE_ERR (gpg_error_from_syserror ());
+  INIT_LOCK (ring->lock);
+  ring->wait[0].fd[0] = ring->wait[0].fd[1] = -1;
+  ring->wait[1].fd[0] = ring->wait[1].fd[1] = -1;
+  ring->size = capacity? capacity : DEFAULT_CAPACITY;
+  ring->buffer = malloc (ring->size);
+  if (!ring->buffer
+      || _gpgme_io_pipe (ring->wait[0].fd, 0)
+      || _gpgme_io_pipe (ring->wait[1].fd, 0))
+    {
+      err = gpg_error_from_syserror ();
+      ring_free (ring);
+      return TRACE_ERR (err);
+    }
+
+  err = _gpgme_data_new (r_writer, &ring_cbs);
+  if (err)
+    {
+      ring_free (ring);
+      return TRACE_ERR (err);
+    }
+  (*r_writer)->data.ring.ring = ring;
+  (*r_writer)->data.ring.writer = 1;
+  (*r_writer)->data.ring.nonblock =
+    !!(flags & GPGME_DATA_RING_NONBLOCK_WRITER);
+
+  err = _gpgme_data_new (r_reader, &ring_cbs);
+  if (err)
+    {
+      /* Releasing the writer would leave the ring for the reader.  */
+      _gpgme_data_release (*r_writer);
+      *r_writer = NULL;
+      ring_free (ring);
+      return TRACE_ERR (err);
+    }
+  (*r_reader)->data.ring.ring = ring;
+  (*r_reader)->data.ring.nonblock =
+    !!(flags & GPGME_DATA_RING_NONBLOCK_READER);
+
+  TRACE_SUC ("writer=%p reader=%p", *r_writer, *r_reader);
+  return 0;
+}
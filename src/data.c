@@ -49,21 +49,29 @@
  * number which is good enough to create a new data object every
  * nanosecond for more than 500 years.  Thus no wrap around will ever
  * happen.
+ *
+ * The unused slots are kept in a free list so that inserting and
+ * removing a data object takes constant time even with many active
+ * data objects.  The table is doubled in size when it is full.
  */
 struct property_s
 {
   gpgme_data_t dh;   /* The data objcet or NULL if the slot is not used.  */
   uint64_t dserial;  /* The serial number of the data object.  */
+  unsigned int next_free; /* Index of the next unused slot if DH is NULL. */
   struct {
     unsigned int blankout : 1;  /* Void the held data.  */
   } flags;
 };
 typedef struct property_s *property_t;
 
+#define PROPERTY_TABLE_INITIAL_SIZE 32
+#define PROPERTY_TABLE_NO_SLOT ((unsigned int)(-1))
+
 static property_t property_table;
 static unsigned int property_table_size;
+static unsigned int property_table_free = PROPERTY_TABLE_NO_SLOT;
 DEFINE_STATIC_LOCK (property_table_lock);
-#define PROPERTY_TABLE_ALLOCATION_CHUNK 32
 
 
 
@@ -78,35 +86,26 @@ insert_into_property_table (gpgme_data_t dh, unsigned int *r_idx)
   unsigned int idx;
 
   LOCK (property_table_lock);
-  if (!property_table)
-    {
-      property_table_size = PROPERTY_TABLE_ALLOCATION_CHUNK;
-      property_table = calloc (property_table_size, sizeof *property_table);
-      if (!property_table)
-        {
-          err = gpg_error_from_syserror ();
-          goto leave;
-        }
-    }
-
-  /* Find an empty slot.  */
-  for (idx = 0; idx < property_table_size; idx++)
-    if (!property_table[idx].dh)
-      break;
-  if (!(idx < property_table_size))
+  if (property_table_free == PROPERTY_TABLE_NO_SLOT)
     {
-      /* No empty slot found.  Enlarge the table.  */
+      /* No empty slot available.  Enlarge the table.  */
       property_t newtbl;
       unsigned int newsize;
-
-      newsize = property_table_size + PROPERTY_TABLE_ALLOCATION_CHUNK;;
-      if ((newsize * sizeof *property_table)
-          < (property_table_size * sizeof *property_table))
+      size_t nbytes;
+
+      if (!property_table_size)
+        newsize = PROPERTY_TABLE_INITIAL_SIZE;
+      else
+        newsize = property_table_size * 2;
+      nbytes = (size_t)newsize * sizeof *property_table;
+      if (newsize <= property_table_size
+          || newsize == PROPERTY_TABLE_NO_SLOT
+          || nbytes / sizeof *property_table != newsize)
         {
           err = gpg_error (GPG_ERR_ENOMEM);
           goto leave;
         }
-      newtbl = realloc (property_table, newsize * sizeof *property_table);
+      newtbl = realloc (property_table, nbytes);
       if (!newtbl)
         {
           err = gpg_error_from_syserror ();
@@ -114,12 +113,18 @@ insert_into_property_table (gpgme_data_t dh, unsigned int *r_idx)
         }
       property_table = newtbl;
       for (idx = property_table_size; idx < newsize; idx++)
-        property_table[idx].dh = NULL;
-      idx = property_table_size;
+        {
+          property_table[idx].dh = NULL;
+          property_table[idx].next_free = idx + 1;
+        }
+      property_table[newsize - 1].next_free = PROPERTY_TABLE_NO_SLOT;
+      property_table_free = property_table_size;
       property_table_size = newsize;
     }
 
-  /* Slot found. */
+  /* Take the first slot from the free list. */
+  idx = property_table_free;
+  property_table_free = property_table[idx].next_free;
   property_table[idx].dh = dh;
   property_table[idx].dserial = ++last_dserial;
   memset (&property_table[idx].flags, 0, sizeof property_table[idx].flags);
@@ -142,6 +147,8 @@ remove_from_property_table (gpgme_data_t dh, unsigned int propidx)
   assert (propidx < property_table_size);
   assert (property_table[propidx].dh == dh);
   property_table[propidx].dh = NULL;
+  property_table[propidx].next_free = property_table_free;
+  property_table_free = propidx;
   UNLOCK (property_table_lock);
 }
 
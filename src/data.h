@@ -70,6 +70,8 @@ struct _gpgme_data_cbs
   gpgme_data_get_fd_cb get_fd;
 };
 
+struct data_ring;
+
 struct gpgme_data
 {
   struct _gpgme_data_cbs *cbs;
@@ -123,6 +125,28 @@ struct gpgme_data
       gpgme_off_t offset;
     } mem;
 
+    /* For gpgme_data_new_ring.  */
+    struct
+    {
+      struct data_ring *ring;
+      unsigned int writer : 1;
+      unsigned int nonblock : 1;
+    } ring;
+
+    /* For gpgme_data_new_chunked.  */
+    struct
+    {
+      char **chunks;
+      /* Number of allocated chunks and allocated size of CHUNKS.  */
+      size_t nchunks;
+      size_t chunks_alloc;
+      size_t chunk_size;
+      size_t length;
+      gpgme_off_t offset;
+      /* The array returned by gpgme_data_get_segments.  */
+      struct _gpgme_data_segment *segs;
+    } chunked;
+
     /* For gpgme_data_new_from_read_cb.  */
     struct
     {
@@ -163,6 +187,14 @@ void _gpgme_data_release (gpgme_data_t dh);
    return -1.  */
 int _gpgme_data_get_fd (gpgme_data_t dh);
 
+/* Get the file descriptor of DH if it may be handed directly to an
+   engine process.  Otherwise return -1.  */
+int _gpgme_data_get_direct_fd (gpgme_data_t dh);
+
+/* Tell DH that an engine process has been spawned with a copy of its
+   direct file descriptor.  */
+void _gpgme_data_direct_fd_passed (gpgme_data_t dh);
+
 /* Get the size-hint value for DH or 0 if not available.  */
 gpgme_off_t _gpgme_data_get_size_hint (gpgme_data_t dh);
 
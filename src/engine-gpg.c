@@ -71,6 +71,7 @@ struct fd_data_map_s
   int fd;       /* the fd to use */
   int peer_fd;  /* the other side of the pipe */
   int arg_loc;  /* The index into the argv for translation purposes.  */
+  int direct;   /* PEER_FD is a copy of the fd of DATA.  */
   void *tag;
 };
 
@@ -1123,10 +1124,34 @@ build_argv (engine_gpg_t gpg, const char *pgmname)
 
       if (a->data)
 	{
-	  /* Create a pipe to pass it down to gpg.  */
+	  int direct_fd = -1;
+
 	  fd_data_map[datac].inbound = a->inbound;
 
-	  /* Create a pipe.  */
+	  /* A regular file is handed down to gpg so that gpg does the
+	     I/O itself and we only need to process the status lines.
+	     Note that the command fd is not backed by a data object.  */
+	  if (!(gpg->cmd.used && gpg->cmd.cb_data == a->data))
+	    direct_fd = _gpgme_data_get_direct_fd (a->data);
+	  if (direct_fd != -1)
+	    {
+	      int fd = _gpgme_io_dup (direct_fd);
+
+	      if (fd == -1)
+		{
+		  int saved_err = gpg_error_from_syserror ();
+		  free_fd_data_map (fd_data_map);
+		  free_argv (argv);
+		  return saved_err;
+		}
+	      if (_gpgme_io_set_close_notify (fd, close_notify_handler, gpg))
+		return gpg_error (GPG_ERR_GENERAL);
+	      fd_data_map[datac].fd       = -1;
+	      fd_data_map[datac].peer_fd  = fd;
+	      fd_data_map[datac].direct   = 1;
+	    }
+	  else
+	  /* Create a pipe to pass it down to gpg.  */
 	  {
 	    int fds[2];
 
@@ -1134,7 +1159,7 @@ build_argv (engine_gpg_t gpg, const char *pgmname)
 		== -1)
 	      {
 		int saved_err = gpg_error_from_syserror ();
-		free (fd_data_map);
+		free_fd_data_map (fd_data_map);
 		free_argv (argv);
 		return saved_err;
 	      }
@@ -1185,7 +1210,7 @@ build_argv (engine_gpg_t gpg, const char *pgmname)
 	      if (!argv[argc])
 		{
                   int saved_err = gpg_error_from_syserror ();
-		  free (fd_data_map);
+		  free_fd_data_map (fd_data_map);
 		  free_argv (argv);
 		  return saved_err;
                 }
@@ -1210,7 +1235,7 @@ build_argv (engine_gpg_t gpg, const char *pgmname)
 	  if (!argv[argc])
 	    {
               int saved_err = gpg_error_from_syserror ();
-	      free (fd_data_map);
+	      free_fd_data_map (fd_data_map);
 	      free_argv (argv);
 	      return saved_err;
             }
@@ -1609,6 +1634,13 @@ start (engine_gpg_t gpg)
       return saved_err;
   }
 
+  /* Only now that gpg has its copies, our ends of the pipes passed
+     directly are closed; before that the data objects are left
+     intact so that the operation can be retried.  */
+  for (i = 0; gpg->fd_data_map[i].data; i++)
+    if (gpg->fd_data_map[i].direct)
+      _gpgme_data_direct_fd_passed (gpg->fd_data_map[i].data);
+
   /*_gpgme_register_term_handler ( closure, closure_value, pid );*/
 
   rc = add_io_cb (gpg, gpg->status.fd[0], 1, status_handler, gpg,
@@ -1635,7 +1667,7 @@ start (engine_gpg_t gpg)
 	  gpg->cmd.fd = gpg->fd_data_map[i].fd;
 	  gpg->fd_data_map[i].fd = -1;
 	}
-      else
+      else if (gpg->fd_data_map[i].fd != -1)
 	{
 	  rc = add_io_cb (gpg, gpg->fd_data_map[i].fd,
 			  gpg->fd_data_map[i].inbound,
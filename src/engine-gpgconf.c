@@ -213,28 +213,20 @@ gpgconf_config_release (gpgme_conf_comp_t conf)
     }
 }
 
-/* Read from gpgconf and pass line after line to the hook function.
-   We put a limit of 64 k on the maximum size for a line.  This should
-   allow for quite a long "group" line, which is usually the longest
-   line (mine is currently ~3k).  */
+/* Run gpgconf with the arguments ARG1 and ARG2 and store the read end
+   of a pipe connected to its stdout at R_FD.  */
 static gpgme_error_t
-gpgconf_read (void *engine, const char *arg1, char *arg2,
-	      gpgme_error_t (*cb) (void *hook, char *line),
-	      void *hook)
+gpgconf_spawn (void *engine, const char *arg1, char *arg2, int *r_fd)
 {
   struct engine_gpgconf *gpgconf = engine;
-  gpgme_error_t err = 0;
-  char *linebuf;
-  size_t linebufsize;
-  int linelen;
   char *argv[6];
   int argc = 0;
   int rp[2];
   struct spawn_fd_item_s cfd[] = { {-1, 1 /* STDOUT_FILENO */, -1, 0},
 				   {-1, -1} };
   int status;
-  int nread;
-  char *mark = NULL;
+
+  *r_fd = -1;
 
   /* _gpgme_engine_new guarantees that this is not NULL.  */
   argv[argc++] = gpgconf->file_name;
@@ -264,6 +256,27 @@ gpgconf_read (void *engine, const char *arg1, char *arg2,
       return gpg_error_from_syserror ();
     }
 
+  *r_fd = rp[0];
+  return 0;
+}
+
+
+/* Read the output of gpgconf from FD and pass line after line to the
+   hook function.  FD is closed in all cases.  We put a limit of 64 k
+   on the maximum size for a line.  This should allow for quite a long
+   "group" line, which is usually the longest line (mine is currently
+   ~3k).  */
+static gpgme_error_t
+gpgconf_read_fd (int fd, gpgme_error_t (*cb) (void *hook, char *line),
+                 void *hook)
+{
+  gpgme_error_t err = 0;
+  char *linebuf;
+  size_t linebufsize;
+  int linelen;
+  int nread;
+  char *mark = NULL;
+
   linebufsize = 1024; /* Usually enough for conf lines.  */
   linebuf = malloc (linebufsize);
   if (!linebuf)
@@ -273,7 +286,7 @@ gpgconf_read (void *engine, const char *arg1, char *arg2,
     }
   linelen = 0;
 
-  while ((nread = _gpgme_io_read (rp[0], linebuf + linelen,
+  while ((nread = _gpgme_io_read (fd, linebuf + linelen,
                                   linebufsize - linelen - 1)))
     {
       char *line;
@@ -337,11 +350,27 @@ gpgconf_read (void *engine, const char *arg1, char *arg2,
 
  leave:
   free (linebuf);
-  _gpgme_io_close (rp[0]);
+  _gpgme_io_close (fd);
   return err;
 }
 
 
+/* Read from gpgconf and pass line after line to the hook function.  */
+static gpgme_error_t
+gpgconf_read (void *engine, const char *arg1, char *arg2,
+	      gpgme_error_t (*cb) (void *hook, char *line),
+	      void *hook)
+{
+  gpgme_error_t err;
+  int fd;
+
+  err = gpgconf_spawn (engine, arg1, arg2, &fd);
+  if (err)
+    return err;
+  return gpgconf_read_fd (fd, cb, hook);
+}
+
+
 static gpgme_error_t
 gpgconf_config_load_cb (void *hook, char *line)
 {
@@ -566,6 +595,8 @@ gpgconf_conf_load (void *engine, gpgme_conf_comp_t *comp_p)
   gpgme_error_t err;
   gpgme_conf_comp_t comp = NULL;
   gpgme_conf_comp_t cur_comp;
+  int *fds;
+  int i, ncomps;
 
   *comp_p = NULL;
 
@@ -573,21 +604,45 @@ gpgconf_conf_load (void *engine, gpgme_conf_comp_t *comp_p)
 		      gpgconf_config_load_cb, &comp);
   if (err)
     {
-      gpgconf_release (comp);
+      gpgconf_config_release (comp);
       return err;
     }
 
-  cur_comp = comp;
-  while (!err && cur_comp)
+  for (ncomps = 0, cur_comp = comp; cur_comp; cur_comp = cur_comp->next)
+    ncomps++;
+  fds = malloc ((ncomps? ncomps : 1) * sizeof *fds);
+  if (!fds)
     {
-      err = gpgconf_read (engine, "--list-options", cur_comp->name,
-			  gpgconf_config_load_cb2, cur_comp);
-      cur_comp = cur_comp->next;
+      err = gpg_error_from_syserror ();
+      gpgconf_config_release (comp);
+      return err;
+    }
+
+  /* Start gpgconf for all components before reading the first output
+     so that the processes run concurrently.  Reading all the output
+     then takes about as long as the slowest process.  */
+  for (i = 0, cur_comp = comp; cur_comp; i++, cur_comp = cur_comp->next)
+    {
+      fds[i] = -1;
+      if (!err)
+        err = gpgconf_spawn (engine, "--list-options", cur_comp->name,
+                             &fds[i]);
+    }
+
+  for (i = 0, cur_comp = comp; cur_comp; i++, cur_comp = cur_comp->next)
+    {
+      if (fds[i] == -1)
+        continue;
+      if (!err)
+        err = gpgconf_read_fd (fds[i], gpgconf_config_load_cb2, cur_comp);
+      else
+        _gpgme_io_close (fds[i]);
     }
+  free (fds);
 
   if (err)
     {
-      gpgconf_release (comp);
+      gpgconf_config_release (comp);
       return err;
     }
 
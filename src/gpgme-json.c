@@ -33,6 +33,9 @@
 #endif
 #include <stdint.h>
 #include <sys/stat.h>
+#ifndef HAVE_W32_SYSTEM
+# include <pthread.h>
+#endif
 
 #define GPGRT_ENABLE_ES_MACROS 1
 #define GPGRT_ENABLE_LOG_MACROS 1
@@ -44,6 +47,13 @@
 /* We don't allow a request with more than 64 MiB.  */
 #define MAX_REQUEST_SIZE (64 * 1024 * 1024)
 
+/* The maximum length of the JSON representation of a request id.  */
+#define MAX_REQUEST_ID_LENGTH 64
+
+/* The maximum number of request ids with pending data.  If more
+ * requests leave data for getmore the oldest data is dropped.  */
+#define MAX_PENDING_DATA 64
+
 /* Minimal chunk size for returned data.*/
 #define MIN_REPLY_CHUNK_SIZE  30
 
@@ -63,6 +73,7 @@ static cjson_t error_object (cjson_t json, const char *message,
 static char *error_object_string (const char *message,
                                   ...) GPGRT_ATTR_PRINTF(1,2);
 static char *process_request (const char *request);
+static char *process_request_ext (const char *request, int nested);
 
 
 /* True if interactive mode is active.  */
@@ -70,13 +81,41 @@ static int opt_interactive;
 /* True is debug mode is active.  */
 static int opt_debug;
 
-/* Pending data to be returned by a getmore command.  */
-static struct
+/* Number of worker threads used to process requests concurrently.
+ * 0 processes them one after the other in the main thread.  */
+static int opt_workers;
+
+/* Pending data to be returned by a getmore command.  There is one
+ * item for each request id with pending data; requests without an
+ * "id" property use the item with ID set to NULL.  */
+struct pending_data_s
 {
+  struct pending_data_s *next;
+  char  *id;       /* Malloced id of the request or NULL.  */
   char  *buffer;   /* Malloced data or NULL if not used.  */
   size_t length;   /* Length of that data.  */
   size_t written;  /* # of already written bytes from BUFFER.  */
-} pending_data;
+};
+static struct pending_data_s *pending_data;
+
+/* The ids of the requests being processed.  Only one request with the
+ * same id (or without an id) may be processed at a time; requests
+ * without an "id" property are recorded with ID set to NULL.  */
+struct active_request_s
+{
+  struct active_request_s *next;
+  char *id;        /* Malloced id of the request or NULL.  */
+};
+static struct active_request_s *active_requests;
+
+/* Lock to protect PENDING_DATA and ACTIVE_REQUESTS.  */
+GPGRT_LOCK_DEFINE (pending_data_lock);
+
+/* Lock to protect the pool of unused contexts.  */
+GPGRT_LOCK_DEFINE (context_pool_lock);
+
+/* Lock to serialize writing of responses.  */
+GPGRT_LOCK_DEFINE (output_lock);
 
 
 /*
@@ -235,49 +274,97 @@ xjson_AddItemToObject (cjson_t object, const char *name, cjson_t item)
   return ;
 }
 
+/* The alphabet used by the base64 functions below.  */
+static const char bintoasc[64] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* The reverse of BINTOASC; 0xff marks characters which are not part
+ * of the alphabet.  The table is constant so that it can be used by
+ * several threads.  */
+static unsigned char const asctobin[256] =
+  {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0x3e, 0xff, 0xff, 0xff, 0x3f,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b,
+    0x3c, 0x3d, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+    0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+    0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16,
+    0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20,
+    0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30,
+    0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+  };
+
+
 /* This is similar to cJSON_AddStringToObject but takes (DATA,
  * DATALEN) and adds it under NAME as a base 64 encoded string to
- * OBJECT.  */
+ * OBJECT.  The output is the same as gpgrt_b64enc_write with an
+ * empty title would create (padded, no linefeeds) but we encode
+ * directly into a buffer of the final size.  */
 static gpg_error_t
 add_base64_to_object (cjson_t object, const char *name,
                       const void *data, size_t datalen)
 {
-  gpg_err_code_t err;
-  estream_t fp = NULL;
-  gpgrt_b64state_t state = NULL;
+  gpg_err_code_t err = 0;
+  const unsigned char *s = data;
   cjson_t j_str = NULL;
-  void *buffer = NULL;
+  char *buffer, *p;
+  size_t n;
 
-  fp = es_fopenmem (0, "rwb");
-  if (!fp)
+  if (datalen / 3 >= (SIZE_MAX - 5) / 4)
+    return gpg_error (GPG_ERR_TOO_LARGE);
+
+  buffer = xtrymalloc ((datalen + 2) / 3 * 4 + 1);
+  if (!buffer)
     {
-      err = gpg_err_code_from_syserror ();
+      err = gpg_error_from_syserror ();
       goto leave;
     }
-  state = gpgrt_b64enc_start (fp, "");
-  if (!state)
+
+  for (p = buffer, n = datalen; n >= 3; n -= 3, s += 3)
     {
-      err = gpg_err_code_from_syserror ();
-      goto leave;
+      *p++ = bintoasc[(s[0] >> 2) & 0x3f];
+      *p++ = bintoasc[((s[0] << 4) & 0x30) | ((s[1] >> 4) & 0x0f)];
+      *p++ = bintoasc[((s[1] << 2) & 0x3c) | ((s[2] >> 6) & 0x03)];
+      *p++ = bintoasc[s[2] & 0x3f];
     }
-
-  err = gpgrt_b64enc_write (state, data, datalen);
-  if (err)
-    goto leave;
-
-  err = gpgrt_b64enc_finish (state);
-  state = NULL;
-  if (err)
-    return err;
-
-  es_fputc (0, fp);
-  if (es_fclose_snatch (fp, &buffer, NULL))
+  if (n == 2)
     {
-      fp = NULL;
-      err = gpg_error_from_syserror ();
-      goto leave;
+      *p++ = bintoasc[(s[0] >> 2) & 0x3f];
+      *p++ = bintoasc[((s[0] << 4) & 0x30) | ((s[1] >> 4) & 0x0f)];
+      *p++ = bintoasc[(s[1] << 2) & 0x3c];
+      *p++ = '=';
+    }
+  else if (n == 1)
+    {
+      *p++ = bintoasc[(s[0] >> 2) & 0x3f];
+      *p++ = bintoasc[(s[0] << 4) & 0x30];
+      *p++ = '=';
+      *p++ = '=';
     }
-  fp = NULL;
+  *p = 0;
 
   j_str = cJSON_CreateStringConvey (buffer);
   if (!j_str)
@@ -299,8 +386,6 @@ add_base64_to_object (cjson_t object, const char *name,
  leave:
   xfree (buffer);
   cJSON_Delete (j_str);
-  gpgrt_b64enc_finish (state);
-  es_fclose (fp);
   return err;
 }
 
@@ -466,6 +551,26 @@ get_chunksize (cjson_t json, size_t *r_chunksize)
 }
 
 
+/* Return the "id" property of the request JSON as a malloced string
+ * in its JSON representation; i.e. a string id is returned with its
+ * quotes.  Returns NULL if the request has no id.  Terminates the
+ * process on out of core.  */
+static char *
+get_request_id (cjson_t json)
+{
+  cjson_t j_item;
+  char *id;
+
+  j_item = cJSON_GetObjectItem (json, "id");
+  if (!j_item || !(cjson_is_string (j_item) || cjson_is_number (j_item)))
+    return NULL;
+  id = cJSON_PrintUnformatted (j_item);
+  if (!id)
+    xoutofcore ("cJSON_PrintUnformatted");
+  return id;
+}
+
+
 /* Extract the keys from the array or string with the name "name"
  * in the JSON object.  On success a string with the keys identifiers
  * is stored at R_KEYS.
@@ -558,43 +663,73 @@ _create_new_context (gpgme_protocol_t proto)
 }
 
 
-/* Return a context object for protocol PROTO.  This is currently a
- * statically allocated context initialized for PROTO.  Terminates
- * process on failure.  */
-static gpgme_ctx_t
-get_context (gpgme_protocol_t proto)
+/* The maximum number of unused contexts kept per protocol.  */
+#define CONTEXT_POOL_SIZE 16
+
+/* Unused contexts for OpenPGP, CMS and GPGCONF.  */
+static struct
 {
-  static gpgme_ctx_t ctx_openpgp, ctx_cms, ctx_conf;
+  gpgme_ctx_t ctx[CONTEXT_POOL_SIZE];
+  int count;
+} context_pool[3];
 
+
+/* Return the index into CONTEXT_POOL for PROTO.  */
+static int
+context_pool_index (gpgme_protocol_t proto)
+{
   if (proto == GPGME_PROTOCOL_OpenPGP)
-    {
-      if (!ctx_openpgp)
-        ctx_openpgp = _create_new_context (proto);
-      return ctx_openpgp;
-    }
+    return 0;
   else if (proto == GPGME_PROTOCOL_CMS)
-    {
-      if (!ctx_cms)
-        ctx_cms = _create_new_context (proto);
-      return ctx_cms;
-    }
+    return 1;
   else if (proto == GPGME_PROTOCOL_GPGCONF)
-    {
-      if (!ctx_conf)
-        ctx_conf = _create_new_context (proto);
-      return ctx_conf;
-    }
+    return 2;
   else
     log_bug ("invalid protocol %d requested\n", proto);
 }
 
 
-/* Free context object retrieved by get_context.  */
+/* Return a context object for protocol PROTO.  An unused context is
+ * taken from the pool; if there is none a new context is created.
+ * Without concurrent processing this always returns the same context
+ * for a protocol.  Terminates process on failure.  */
+static gpgme_ctx_t
+get_context (gpgme_protocol_t proto)
+{
+  int idx = context_pool_index (proto);
+  gpgme_ctx_t ctx = NULL;
+
+  gpgrt_lock_lock (&context_pool_lock);
+  if (context_pool[idx].count)
+    ctx = context_pool[idx].ctx[--context_pool[idx].count];
+  gpgrt_lock_unlock (&context_pool_lock);
+
+  if (!ctx)
+    ctx = _create_new_context (proto);
+  return ctx;
+}
+
+
+/* Free context object retrieved by get_context.  The context is put
+ * back into the pool for reuse.  */
 static void
 release_context (gpgme_ctx_t ctx)
 {
-  /* Nothing to do right now.  */
-  (void)ctx;
+  int idx;
+
+  if (!ctx)
+    return;
+
+  idx = context_pool_index (gpgme_get_protocol (ctx));
+  gpgrt_lock_lock (&context_pool_lock);
+  if (context_pool[idx].count < CONTEXT_POOL_SIZE)
+    {
+      context_pool[idx].ctx[context_pool[idx].count++] = ctx;
+      ctx = NULL;
+    }
+  gpgrt_lock_unlock (&context_pool_lock);
+
+  gpgme_release (ctx);
 }
 
 
@@ -616,6 +751,250 @@ release_onetime_context (gpgme_ctx_t ctx)
 }
 
 
+/* Return true if the request ids A and B are equal.  NULL is the id
+ * of requests without an id.  */
+static int
+same_request_id (const char *a, const char *b)
+{
+  return (!a && !b) || (a && b && !strcmp (a, b));
+}
+
+
+/* Return true if a request with id ID is being processed.  The caller
+ * must hold PENDING_DATA_LOCK.  */
+static int
+is_active_request (const char *id)
+{
+  struct active_request_s *ar;
+
+  for (ar = active_requests; ar; ar = ar->next)
+    if (same_request_id (id, ar->id))
+      return 1;
+  return 0;
+}
+
+
+/* Mark the request with id ID as being processed.  Returns an error
+ * if another request with the same id is being processed.  */
+static gpg_error_t
+begin_request (const char *id)
+{
+  struct active_request_s *ar;
+  gpg_error_t err = 0;
+
+  ar = xcalloc (1, sizeof *ar);
+  ar->id = id? xstrdup (id) : NULL;
+
+  gpgrt_lock_lock (&pending_data_lock);
+  if (is_active_request (id))
+    err = gpg_error (GPG_ERR_EBUSY);
+  else
+    {
+      ar->next = active_requests;
+      active_requests = ar;
+      ar = NULL;
+    }
+  gpgrt_lock_unlock (&pending_data_lock);
+
+  if (ar)
+    {
+      xfree (ar->id);
+      xfree (ar);
+    }
+  return err;
+}
+
+
+/* Mark the request with id ID as done.  */
+static void
+end_request (const char *id)
+{
+  struct active_request_s *ar, *arprev;
+
+  gpgrt_lock_lock (&pending_data_lock);
+  for (arprev = NULL, ar = active_requests; ar; arprev = ar, ar = ar->next)
+    if (same_request_id (id, ar->id))
+      {
+        if (arprev)
+          arprev->next = ar->next;
+        else
+          active_requests = ar->next;
+        break;
+      }
+  gpgrt_lock_unlock (&pending_data_lock);
+
+  if (ar)
+    {
+      xfree (ar->id);
+      xfree (ar);
+    }
+}
+
+
+/* Release the pending data item PD.  */
+static void
+free_pending_data (struct pending_data_s *pd)
+{
+  if (pd)
+    {
+      xfree (pd->buffer);
+      xfree (pd->id);
+      xfree (pd);
+    }
+}
+
+
+/* Remove the pending data item for request id ID from the list and
+ * return it or NULL if there is none.  The caller must hold
+ * PENDING_DATA_LOCK.  */
+static struct pending_data_s *
+unlink_pending_data (const char *id)
+{
+  struct pending_data_s *pd, *pdprev;
+
+  for (pdprev = NULL, pd = pending_data; pd; pdprev = pd, pd = pd->next)
+    if (same_request_id (id, pd->id))
+      {
+        if (pdprev)
+          pdprev->next = pd->next;
+        else
+          pending_data = pd->next;
+        break;
+      }
+  return pd;
+}
+
+
+/* Release the pending data item for request id ID.  */
+static void
+release_pending_data (const char *id)
+{
+  struct pending_data_s *pd;
+
+  gpgrt_lock_lock (&pending_data_lock);
+  pd = unlink_pending_data (id);
+  gpgrt_lock_unlock (&pending_data_lock);
+
+  free_pending_data (pd);
+}
+
+
+/* Release all pending data.  */
+static void
+release_all_pending_data (void)
+{
+  struct pending_data_s *pd;
+
+  gpgrt_lock_lock (&pending_data_lock);
+  while ((pd = pending_data))
+    {
+      pending_data = pd->next;
+      free_pending_data (pd);
+    }
+  gpgrt_lock_unlock (&pending_data_lock);
+}
+
+
+/* Take the next chunk of at most CHUNKSIZE bytes from the pending data
+ * of request id ID.  On success the malloced chunk is stored at
+ * R_CHUNK, its length at R_LENGTH and whether more data is pending at
+ * R_MORE; the item is released after its last chunk has been taken.
+ * The chunk is copied under the lock so that the item may be released
+ * by other threads as soon as the lock is dropped.  */
+static gpg_error_t
+take_pending_data (const char *id, size_t chunksize,
+                   char **r_chunk, size_t *r_length, int *r_more)
+{
+  gpg_error_t err = 0;
+  struct pending_data_s *pd, *done = NULL;
+  size_t n = 0;
+
+  *r_chunk = NULL;
+  *r_length = 0;
+  *r_more = 0;
+
+  gpgrt_lock_lock (&pending_data_lock);
+  for (pd = pending_data; pd; pd = pd->next)
+    if (same_request_id (id, pd->id))
+      break;
+  if (!pd)
+    err = gpg_error (GPG_ERR_NO_DATA);
+  else
+    {
+      /* At EOF an empty chunk is returned once in case of client
+       * errors.  */
+      n = pd->length - pd->written;
+      if (n > chunksize)
+        n = chunksize;
+      *r_chunk = xtrymalloc (n + 1);
+      if (!*r_chunk)
+        err = gpg_error_from_syserror ();
+      else
+        {
+          memcpy (*r_chunk, pd->buffer + pd->written, n);
+          (*r_chunk)[n] = 0;
+          pd->written += n;
+          if (pd->written >= pd->length)
+            done = unlink_pending_data (id);
+          else
+            *r_more = 1;
+        }
+    }
+  gpgrt_lock_unlock (&pending_data_lock);
+
+  free_pending_data (done);
+  if (!err)
+    *r_length = n;
+  return err;
+}
+
+
+/* Store BUFFER as pending data for request id ID.  BUFFER is
+ * consumed by this function.  If there are too many items with
+ * pending data, the data of the oldest one whose request is not
+ * being processed is released.  */
+static void
+store_pending_data (const char *id, char *buffer)
+{
+  struct pending_data_s *pd, *old, *prev, *oldest = NULL;
+  int n;
+
+  pd = xcalloc (1, sizeof *pd);
+  pd->id = id? xstrdup (id) : NULL;
+  pd->buffer = buffer;
+  /* Data should already be encoded so that it does not
+     contain 0.*/
+  pd->length = strlen (buffer);
+  pd->written = 0;
+
+  gpgrt_lock_lock (&pending_data_lock);
+  old = unlink_pending_data (id);
+  pd->next = pending_data;
+  pending_data = pd;
+  /* Find the item before the oldest one not in use.  */
+  for (n = 0, prev = NULL; pd; pd = pd->next)
+    {
+      n++;
+      if (pd->next && !is_active_request (pd->next->id))
+        prev = pd;
+    }
+  if (n > MAX_PENDING_DATA && prev)
+    {
+      oldest = prev->next;
+      prev->next = oldest->next;
+    }
+  gpgrt_lock_unlock (&pending_data_lock);
+
+  free_pending_data (old);
+  if (oldest)
+    {
+      log_info ("dropping pending data of request %s\n",
+                oldest->id? oldest->id : "without id");
+      free_pending_data (oldest);
+    }
+}
+
+
 /* Given a Base-64 encoded string object in JSON return a gpgme data
  * object at R_DATA.  */
 static gpg_error_t
@@ -653,9 +1032,40 @@ data_from_base64_string (gpgme_data_t *r_data, cjson_t json)
       goto leave;
     }
 
-  err = gpgrt_b64dec_proc (state, buf, len, &len);
-  if (err)
-    goto leave;
+  /* Decode as many complete quads as possible in place; this covers
+   * the usual case of a string without any linefeeds or other white
+   * space.  Whatever is left (padding, white space or invalid
+   * characters) is handed to the generic decoder which starts at a
+   * quad boundary.  */
+  {
+    const unsigned char *u = (const unsigned char *)buf;
+    unsigned char *d = (unsigned char *)buf;
+    unsigned int c0, c1, c2, c3;
+    size_t n, rest;
+
+    for (rest = len;
+         rest >= 4
+           && (c0 = asctobin[u[0]]) != 0xff
+           && (c1 = asctobin[u[1]]) != 0xff
+           && (c2 = asctobin[u[2]]) != 0xff
+           && (c3 = asctobin[u[3]]) != 0xff;
+         rest -= 4, u += 4)
+      {
+        *d++ = (c0 << 2) | (c1 >> 4);
+        *d++ = ((c1 << 4) & 0xf0) | (c2 >> 2);
+        *d++ = ((c2 << 6) & 0xc0) | c3;
+      }
+    len = d - (unsigned char *)buf;
+
+    if (rest)
+      {
+        memmove (d, u, rest);
+        err = gpgrt_b64dec_proc (state, d, rest, &n);
+        if (err)
+          goto leave;
+        len += n;
+      }
+  }
 
   err = gpgrt_b64dec_finish (state);
   state = NULL;
@@ -1513,6 +1923,7 @@ encode_and_chunk (cjson_t request, cjson_t response)
   gpg_error_t err = 0;
   size_t chunksize = 0;
   char *getmore_request = NULL;
+  char *id = NULL;
 
   if (opt_interactive)
     data = cJSON_Print (response);
@@ -1539,24 +1950,23 @@ encode_and_chunk (cjson_t request, cjson_t response)
   if (!chunksize)
     goto leave;
 
-  pending_data.buffer = data;
-  /* Data should already be encoded so that it does not
-     contain 0.*/
-  pending_data.length = strlen (data);
-  pending_data.written = 0;
+  id = get_request_id (request);
+  store_pending_data (id, data);
 
   if (gpgrt_asprintf (&getmore_request,
-                  "{ \"op\":\"getmore\", \"chunksize\": %i }",
-                  (int) chunksize) == -1)
+                  "{ \"op\":\"getmore\", \"chunksize\": %i%s%s }",
+                  (int) chunksize, id? ", \"id\": ":"", id? id:"") == -1)
     {
       err = gpg_error_from_syserror ();
+      data = NULL;
       goto leave;
     }
 
-  data = process_request (getmore_request);
+  data = process_request_ext (getmore_request, 1);
 
 leave:
   xfree (getmore_request);
+  xfree (id);
 
   if (!err && !data)
     {
@@ -2506,6 +2916,7 @@ op_keylist (cjson_t request, cjson_t result)
     }
 
  leave:
+  release_context (ctx);
   xfree_array (patterns);
   if (err)
     {
@@ -3062,6 +3473,9 @@ leave:
 static const char hlp_getmore[] =
   "op:     \"getmore\"\n"
   "\n"
+  "Optional parameters:\n"
+  "id:     The id of the request with pending data.\n"
+  "\n"
   "Response on success:\n"
   "response:       base64 encoded json response.\n"
   "more:           Another getmore is required.\n"
@@ -3070,70 +3484,51 @@ static gpg_error_t
 op_getmore (cjson_t request, cjson_t result)
 {
   gpg_error_t err;
-  int c;
   size_t n;
   size_t chunksize;
+  size_t overhead;
+  char *id;
+  char *chunk = NULL;
+  int more;
+
+  id = get_request_id (request);
 
   if ((err = get_chunksize (request, &chunksize)))
     goto leave;
 
   /* For the meta data we need 41 bytes:
-     {"more":true,"base64":true,"response":""} */
-  chunksize -= 41;
+     {"more":true,"base64":true,"response":""}
+     and another 6 plus the length of the id for ,"id":ID .  The
+     chunk size is at least MIN_REPLY_CHUNK_SIZE even if this
+     exceeds the requested size.  */
+  overhead = 41 + (id? 6 + strlen (id) : 0);
+  if (chunksize < overhead + MIN_REPLY_CHUNK_SIZE)
+    chunksize = MIN_REPLY_CHUNK_SIZE;
+  else
+    chunksize -= overhead;
 
   /* Adjust the chunksize for the base64 conversion.  */
   chunksize = (chunksize / 4) * 3;
 
   /* Do we have anything pending?  */
-  if (!pending_data.buffer)
+  err = take_pending_data (id, chunksize, &chunk, &n, &more);
+  if (gpg_err_code (err) == GPG_ERR_NO_DATA)
     {
-      err = gpg_error (GPG_ERR_NO_DATA);
       gpg_error_object (result, err, "Operation not possible: %s",
                         gpg_strerror (err));
       goto leave;
     }
+  else if (err)
+    goto leave;
 
   /* We currently always use base64 encoding for simplicity. */
   xjson_AddBoolToObject (result, "base64", 1);
-
-  if (pending_data.written >= pending_data.length)
-    {
-      /* EOF reached.  This should not happen but we return an empty
-       * string once in case of client errors.  */
-      gpgme_free (pending_data.buffer);
-      pending_data.buffer = NULL;
-      xjson_AddBoolToObject (result, "more", 0);
-      err = cjson_AddStringToObject (result, "response", "");
-    }
-  else
-    {
-      n = pending_data.length - pending_data.written;
-      if (n > chunksize)
-        {
-          n = chunksize;
-          xjson_AddBoolToObject (result, "more", 1);
-        }
-      else
-        xjson_AddBoolToObject (result, "more", 0);
-
-      c = pending_data.buffer[pending_data.written + n];
-      pending_data.buffer[pending_data.written + n] = 0;
-      err = add_base64_to_object (result, "response",
-                                  (pending_data.buffer
-                                   + pending_data.written), n);
-      pending_data.buffer[pending_data.written + n] = c;
-      if (!err)
-        {
-          pending_data.written += n;
-          if (pending_data.written >= pending_data.length)
-            {
-              xfree (pending_data.buffer);
-              pending_data.buffer = NULL;
-            }
-        }
-    }
+  xjson_AddBoolToObject (result, "more", more);
+  err = add_base64_to_object (result, "response", chunk, n);
 
  leave:
+  xfree (chunk);
+  xfree (id);
   return err;
 }
 
@@ -3167,7 +3562,15 @@ static const char hlp_help[] =
   "When \"chunksize\" is set the response (including json) will\n"
   "not be larger then \"chunksize\" but might be smaller.\n"
   "The chunked result will be transferred in base64 encoded chunks\n"
-  "using the \"getmore\" operation. See help getmore for more info.";
+  "using the \"getmore\" operation. See help getmore for more info.\n"
+  "\n"
+  "If the request has the property \"id\" with a string or number\n"
+  "value, that value is returned as property \"id\" of the response\n"
+  "and must also be given with \"getmore\".  When gpgme-json has been\n"
+  "started with --workers (or GPGME_JSON_WORKERS) requests are\n"
+  "processed concurrently and responses may arrive out of order.\n"
+  "A request is rejected while another request with the same id (or\n"
+  "without an id) is being processed.";
 static gpg_error_t
 op_help (cjson_t request, cjson_t result)
 {
@@ -3195,9 +3598,11 @@ op_help (cjson_t request, cjson_t result)
  */
 
 /* Process a request and return the response.  The response is a newly
- * allocated string or NULL in case of an error.  */
+ * allocated string or NULL in case of an error.  NESTED is set for the
+ * first getmore of a chunked response, which is processed on behalf of
+ * the request with the same id.  */
 static char *
-process_request (const char *request)
+process_request_ext (const char *request, int nested)
 {
   static struct {
     const char *op;
@@ -3226,8 +3631,10 @@ process_request (const char *request)
   cjson_t response;
   int helpmode;
   int is_getmore = 0;
+  int active = 0;
   const char *op;
   char *res = NULL;
+  char *id = NULL;
   int idx;
 
   response = xjson_CreateObject ();
@@ -3241,6 +3648,26 @@ process_request (const char *request)
       goto leave;
     }
 
+  /* Echo the id of the request so that the client is able to match
+   * responses which are returned out of order.  */
+  id = get_request_id (json);
+  if (id)
+    xjson_AddItemToObject (response, "id",
+                           cJSON_Duplicate (cJSON_GetObjectItem (json, "id"),
+                                            0));
+  if (id && strlen (id) > MAX_REQUEST_ID_LENGTH)
+    {
+      error_object (response, "Property \"id\" too long");
+      goto leave;
+    }
+  if (!nested && begin_request (id))
+    {
+      error_object (response, "Another request with the same id"
+                    " is being processed");
+      goto leave;
+    }
+  active = !nested;
+
   j_tmp = cJSON_GetObjectItem (json, "help");
   helpmode = (j_tmp && cjson_is_true (j_tmp));
 
@@ -3274,11 +3701,8 @@ process_request (const char *request)
           is_getmore = optbl[idx].handler == op_getmore;
           /* If this is not the "getmore" command and we have any
            * pending data release that data.  */
-          if (pending_data.buffer && optbl[idx].handler != op_getmore)
-            {
-              gpgme_free (pending_data.buffer);
-              pending_data.buffer = NULL;
-            }
+          if (optbl[idx].handler != op_getmore)
+            release_pending_data (id);
 
           err = optbl[idx].handler (json, response);
           if (err)
@@ -3303,9 +3727,11 @@ process_request (const char *request)
     }
 
  leave:
-  if (is_getmore)
+  if (is_getmore || !active)
     {
-      /* For getmore we bypass the encode_and_chunk. */
+      /* For getmore we bypass the encode_and_chunk.  This is also
+       * done for rejected requests so that they do not replace the
+       * pending data of another request with the same id.  */
       if (opt_interactive)
         res = cJSON_Print (response);
       else
@@ -3326,6 +3752,9 @@ process_request (const char *request)
       cJSON_Delete (err_obj);
     }
 
+  if (active)
+    end_request (id);
+  xfree (id);
   cJSON_Delete (json);
   cJSON_Delete (response);
 
@@ -3338,6 +3767,15 @@ process_request (const char *request)
 }
 
 
+/* Process a request and return the response.  The response is a newly
+ * allocated string or NULL in case of an error.  */
+static char *
+process_request (const char *request)
+{
+  return process_request_ext (request, 0);
+}
+
+
 
 /*
  *  Driver code
@@ -3662,15 +4100,195 @@ read_and_process_single_request (void)
 }
 
 
-/* The Native Messaging processing loop.  */
+/* Write RESPONSE using the Native Messaging framing to stdout.  This
+ * may be called from several threads.  */
+static gpg_error_t
+write_native_response (const char *response)
+{
+  gpg_error_t err = 0;
+  uint32_t nresponse;
+  size_t n;
+
+  nresponse = strlen (response);
+
+  gpgrt_lock_lock (&output_lock);
+
+  if (es_write (es_stdout, &nresponse, sizeof nresponse, &n))
+    {
+      err = gpg_error_from_syserror ();
+      log_error ("error writing request header: %s\n", gpg_strerror (err));
+      goto leave;
+    }
+  if (n != sizeof nresponse)
+    {
+      err = gpg_error (GPG_ERR_EIO);
+      log_error ("error writing request header: short write\n");
+      goto leave;
+    }
+  if (es_write (es_stdout, response, nresponse, &n))
+    {
+      err = gpg_error_from_syserror ();
+      log_error ("error writing request: %s\n", gpg_strerror (err));
+      goto leave;
+    }
+  if (n != nresponse)
+    {
+      err = gpg_error (GPG_ERR_EIO);
+      log_error ("error writing request: short write\n");
+      goto leave;
+    }
+  if (es_fflush (es_stdout) || es_ferror (es_stdout))
+    {
+      err = gpg_error_from_syserror ();
+      log_error ("error writing request: %s\n", gpg_strerror (err));
+      goto leave;
+    }
+
+ leave:
+  gpgrt_lock_unlock (&output_lock);
+  return err;
+}
+
+
+/* Process REQUEST and write the response.  REQUEST is released.  */
+static gpg_error_t
+process_native_request (char *request)
+{
+  gpg_error_t err;
+  char *response;
+
+  if (opt_debug)
+    log_debug ("request='%s'\n", request);
+  response = process_request (request);
+  if (opt_debug)
+    log_debug ("response='%s'\n", response);
+  xfree (request);
+
+  err = write_native_response (response);
+  xfree (response);
+  return err;
+}
+
+
+#ifndef HAVE_W32_SYSTEM
+/* The queue of requests for the worker threads.  */
+struct work_item_s
+{
+  struct work_item_s *next;
+  char *request;
+};
+
+static struct
+{
+  pthread_mutex_t lock;
+  pthread_cond_t  notempty;  /* Signaled if an item has been queued.  */
+  pthread_cond_t  notfull;   /* Signaled if an item has been taken.   */
+  struct work_item_s *head;
+  struct work_item_s *tail;
+  int count;    /* Number of items in the queue.  */
+  int eof;      /* No more items will be queued.  */
+  int failed;   /* Writing a response failed.  */
+} work_queue = { PTHREAD_MUTEX_INITIALIZER,
+                 PTHREAD_COND_INITIALIZER,
+                 PTHREAD_COND_INITIALIZER };
+
+
+/* The worker thread: Take requests from the queue and process them
+ * until EOF has been seen and the queue is empty.  */
+static void *
+worker_thread (void *arg)
+{
+  struct work_item_s *item;
+
+  (void)arg;
+
+  for (;;)
+    {
+      pthread_mutex_lock (&work_queue.lock);
+      while (!work_queue.head && !work_queue.eof)
+        pthread_cond_wait (&work_queue.notempty, &work_queue.lock);
+      item = work_queue.head;
+      if (item)
+        {
+          work_queue.head = item->next;
+          if (!work_queue.head)
+            work_queue.tail = NULL;
+          work_queue.count--;
+          pthread_cond_signal (&work_queue.notfull);
+        }
+      pthread_mutex_unlock (&work_queue.lock);
+      if (!item)
+        break;  /* EOF and nothing left to do.  */
+
+      if (process_native_request (item->request))
+        {
+          pthread_mutex_lock (&work_queue.lock);
+          work_queue.failed = 1;
+          pthread_cond_broadcast (&work_queue.notfull);
+          pthread_mutex_unlock (&work_queue.lock);
+        }
+      xfree (item);
+    }
+
+  return NULL;
+}
+
+
+/* Queue REQUEST for processing by a worker thread.  REQUEST is
+ * consumed.  Blocks while the queue is full.  Returns false if
+ * writing a response already failed.  */
+static int
+queue_native_request (char *request)
+{
+  struct work_item_s *item;
+  int okay;
+
+  item = xcalloc (1, sizeof *item);
+  item->request = request;
+
+  pthread_mutex_lock (&work_queue.lock);
+  while (work_queue.count >= 2 * opt_workers && !work_queue.failed)
+    pthread_cond_wait (&work_queue.notfull, &work_queue.lock);
+  okay = !work_queue.failed;
+  if (okay)
+    {
+      if (work_queue.tail)
+        work_queue.tail->next = item;
+      else
+        work_queue.head = item;
+      work_queue.tail = item;
+      work_queue.count++;
+      pthread_cond_signal (&work_queue.notempty);
+    }
+  pthread_mutex_unlock (&work_queue.lock);
+
+  if (!okay)
+    {
+      xfree (item->request);
+      xfree (item);
+    }
+  return okay;
+}
+#endif /*!HAVE_W32_SYSTEM*/
+
+
+/* The Native Messaging processing loop.  If OPT_WORKERS is set
+ * requests are processed concurrently by that many worker threads;
+ * the responses are written in the order they are ready and thus
+ * clients need to use the "id" property to match them.  */
 static void
 native_messaging_repl (void)
 {
   gpg_error_t err;
-  uint32_t nrequest, nresponse;
+  uint32_t nrequest;
   char *request = NULL;
   char *response = NULL;
   size_t n;
+  int okay;
+#ifndef HAVE_W32_SYSTEM
+  pthread_t *workers = NULL;
+  int nworkers = 0;
+#endif
 
   /* Due to the length octets we need to switch the I/O stream into
    * binary mode.  */
@@ -3678,6 +4296,23 @@ native_messaging_repl (void)
   es_set_binary (es_stdout);
   es_setbuf (es_stdin, NULL);  /* stdin needs to be unbuffered! */
 
+#ifndef HAVE_W32_SYSTEM
+  if (opt_workers)
+    {
+      workers = xcalloc (opt_workers, sizeof *workers);
+      for (nworkers = 0; nworkers < opt_workers; nworkers++)
+        if (pthread_create (&workers[nworkers], NULL, worker_thread, NULL))
+          {
+            err = gpg_error_from_syserror ();
+            log_error ("error creating worker thread: %s\n",
+                       gpg_strerror (err));
+            break;
+          }
+      if (!nworkers)
+        opt_workers = 0;
+    }
+#endif
+
   for (;;)
     {
       /* Read length.  Note that the protocol uses native endianness.
@@ -3725,64 +4360,51 @@ native_messaging_repl (void)
       if (n != nrequest)
         {
           /* That is a protocol violation.  */
-          xfree (response);
           response = error_object_string ("Invalid request:"
                                           " short read (%zu of %zu bytes)\n",
                                           n, (size_t)nrequest);
+          err = write_native_response (response);
+          xfree (response);
+          response = NULL;
+          if (err)
+            break;
         }
       else /* Process request  */
         {
           request[n] = '\0'; /* Ensure that request has an end */
-          if (opt_debug)
-            log_debug ("request='%s'\n", request);
-          xfree (response);
-          response = process_request (request);
-          if (opt_debug)
-            log_debug ("response='%s'\n", response);
-        }
-      nresponse = strlen (response);
-
-      /* Write response */
-      if (es_write (es_stdout, &nresponse, sizeof nresponse, &n))
-        {
-          err = gpg_error_from_syserror ();
-          log_error ("error writing request header: %s\n", gpg_strerror (err));
-          break;
-        }
-      if (n != sizeof nresponse)
-        {
-          log_error ("error writing request header: short write\n");
-          break;
-        }
-      if (es_write (es_stdout, response, nresponse, &n))
-        {
-          err = gpg_error_from_syserror ();
-          log_error ("error writing request: %s\n", gpg_strerror (err));
-          break;
-        }
-      if (n != nresponse)
-        {
-          log_error ("error writing request: short write\n");
-          break;
-        }
-      if (es_fflush (es_stdout) || es_ferror (es_stdout))
-        {
-          err = gpg_error_from_syserror ();
-          log_error ("error writing request: %s\n", gpg_strerror (err));
-          break;
+#ifndef HAVE_W32_SYSTEM
+          if (opt_workers)
+            okay = queue_native_request (request);
+          else
+#endif
+            okay = !process_native_request (request);
+          request = NULL;
+          if (!okay)
+            break;
         }
-      xfree (response);
-      response = NULL;
       xfree (request);
       request = NULL;
     }
 
+#ifndef HAVE_W32_SYSTEM
+  if (nworkers)
+    {
+      pthread_mutex_lock (&work_queue.lock);
+      work_queue.eof = 1;
+      pthread_cond_broadcast (&work_queue.notempty);
+      pthread_mutex_unlock (&work_queue.lock);
+      while (nworkers)
+        pthread_join (workers[--nworkers], NULL);
+    }
+  xfree (workers);
+#endif
+
   xfree (response);
   xfree (request);
 }
 
 
-
+
 static const char *
 my_strusage( int level )
 {
@@ -3819,7 +4441,8 @@ main (int argc, char *argv[])
          CMD_LIBVERSION  = 501,
   } cmd = CMD_DEFAULT;
   enum {
-    OPT_DEBUG = 600
+    OPT_DEBUG = 600,
+    OPT_WORKERS
   };
 
   static gpgrt_opt_t opts[] = {
@@ -3827,6 +4450,8 @@ main (int argc, char *argv[])
     ARGPARSE_c  (CMD_SINGLE,      "single",      "Single request mode"),
     ARGPARSE_c  (CMD_LIBVERSION,  "lib-version", "Show library version"),
     ARGPARSE_s_n(OPT_DEBUG,       "debug",       "Flyswatter"),
+    ARGPARSE_s_i(OPT_WORKERS,     "workers",
+                 "|N|process up to N requests concurrently"),
 
     ARGPARSE_end()
   };
@@ -3860,6 +4485,7 @@ main (int argc, char *argv[])
           break;
 
         case OPT_DEBUG: opt_debug = 1; break;
+        case OPT_WORKERS: opt_workers = pargs.r.ret_int; break;
 
         default:
           pargs.err = ARGPARSE_PRINT_WARNING;
@@ -3903,6 +4529,27 @@ main (int argc, char *argv[])
         log_debug ("argv[%d]='%s'\n", i, argv[i]);
     }
 
+  /* The browser does not allow to pass options to us; thus the
+   * number of workers may also be given by an envvar.  */
+  if (!opt_workers)
+    {
+      const char *s = getenv ("GPGME_JSON_WORKERS");
+
+      if (s)
+        opt_workers = atoi (s);
+    }
+  if (opt_workers < 0)
+    opt_workers = 0;
+  else if (opt_workers > 64)
+    opt_workers = 64;
+#ifdef HAVE_W32_SYSTEM
+  if (opt_workers)
+    {
+      log_info ("concurrent processing is not supported on this platform\n");
+      opt_workers = 0;
+    }
+#endif
+
   switch (cmd)
     {
     case CMD_DEFAULT:
@@ -3925,6 +4572,8 @@ main (int argc, char *argv[])
       break;
     }
 
+  release_all_pending_data ();
+
   if (opt_debug)
     log_debug ("ready");
 
@@ -122,6 +122,7 @@ gpgme_new (gpgme_ctx_t *r_ctx)
   ctx->protocol = GPGME_PROTOCOL_OpenPGP;
   ctx->sub_protocol = GPGME_PROTOCOL_DEFAULT;
   _gpgme_fd_table_init (&ctx->fdt);
+  ctx->wakeup_fd[0] = ctx->wakeup_fd[1] = -1;
 
   LOCK (def_lc_lock);
   if (def_lc_ctype)
@@ -223,6 +224,10 @@ gpgme_cancel_async (gpgme_ctx_t ctx)
     return TRACE_ERR (gpg_error (GPG_ERR_INV_VALUE));
 
   LOCK (ctx->lock);
+  /* Wake up a private event loop waiting for this context so that the
+   * cancellation takes effect immediately.  */
+  if (!ctx->canceled && ctx->wakeup_fd[1] != -1)
+    _gpgme_io_write (ctx->wakeup_fd[1], "", 1);
   ctx->canceled = 1;
   UNLOCK (ctx->lock);
 
@@ -242,9 +247,14 @@ gpgme_release (gpgme_ctx_t ctx)
   _gpgme_engine_release (ctx->engine);
   ctx->engine = NULL;
   _gpgme_fd_table_deinit (&ctx->fdt);
+  if (ctx->wakeup_fd[0] != -1)
+    _gpgme_io_close (ctx->wakeup_fd[0]);
+  if (ctx->wakeup_fd[1] != -1)
+    _gpgme_io_close (ctx->wakeup_fd[1]);
   _gpgme_release_result (ctx);
   _gpgme_signers_clear (ctx);
   _gpgme_sig_notation_clear (ctx);
+  _gpgme_keylist_filter_release (ctx->keylist_filter);
   free (ctx->sender);
   free (ctx->signers);
   free (ctx->lc_ctype);
@@ -253,6 +263,7 @@ gpgme_release (gpgme_ctx_t ctx)
   free (ctx->request_origin);
   free (ctx->auto_key_locate);
   free (ctx->trust_model);
+  free (ctx->progress_what);
   _gpgme_engine_info_release (ctx->engine_info);
   ctx->engine_info = NULL;
   DESTROY_LOCK (ctx->lock);
@@ -578,6 +589,30 @@ gpgme_set_ctx_flag (gpgme_ctx_t ctx, const char *name, const char *value)
     {
       ctx->extended_edit = abool;
     }
+  else if (!strcmp (name, "timeout"))
+    {
+      ctx->timeout = (unsigned int)strtoul (value, NULL, 10);
+    }
+  else if (!strcmp (name, "verify-cache"))
+    {
+      ctx->verify_cache_ttl = (unsigned int)strtoul (value, NULL, 10);
+    }
+  else if (!strcmp (name, "keylist-limit"))
+    {
+      ctx->keylist_limit = (unsigned int)strtoul (value, NULL, 10);
+    }
+  else if (!strcmp (name, "lazy-key-sigs"))
+    {
+      ctx->lazy_key_sigs = abool;
+    }
+  else if (!strcmp (name, "progress-interval"))
+    {
+      ctx->progress_interval = (unsigned int)strtoul (value, NULL, 10);
+    }
+  else if (!strcmp (name, "progress-delta"))
+    {
+      ctx->progress_delta = (unsigned int)strtoul (value, NULL, 10);
+    }
   else
     err = gpg_error (GPG_ERR_UNKNOWN_NAME);
 
@@ -585,11 +620,22 @@ gpgme_set_ctx_flag (gpgme_ctx_t ctx, const char *name, const char *value)
 }
 
 
+/* Return VALUE as a decimal string in the flag value buffer of
+ * CTX.  */
+static const char *
+numeric_ctx_flag (gpgme_ctx_t ctx, unsigned int value)
+{
+  snprintf (ctx->flag_value, sizeof ctx->flag_value, "%u", value);
+  return ctx->flag_value;
+}
+
+
 /* Get the context flag named NAME.  See gpgme_set_ctx_flag for a list
  * of valid names.  If the NAME is unknown NULL is returned.  For a
  * boolean flag an empty string is returned for False and the string
  * "1" for True; thus either atoi or a simple string test can be
- * used.  */
+ * used.  For a numeric flag the decimal value is returned; it is
+ * valid until the next call of this function for CTX.  */
 const char *
 gpgme_get_ctx_flag (gpgme_ctx_t ctx, const char *name)
 {
@@ -647,6 +693,30 @@ gpgme_get_ctx_flag (gpgme_ctx_t ctx, const char *name)
     {
       return ctx->extended_edit ? "1":"";
     }
+  else if (!strcmp (name, "timeout"))
+    {
+      return numeric_ctx_flag (ctx, ctx->timeout);
+    }
+  else if (!strcmp (name, "verify-cache"))
+    {
+      return numeric_ctx_flag (ctx, ctx->verify_cache_ttl);
+    }
+  else if (!strcmp (name, "keylist-limit"))
+    {
+      return numeric_ctx_flag (ctx, ctx->keylist_limit);
+    }
+  else if (!strcmp (name, "lazy-key-sigs"))
+    {
+      return ctx->lazy_key_sigs? "1":"";
+    }
+  else if (!strcmp (name, "progress-interval"))
+    {
+      return numeric_ctx_flag (ctx, ctx->progress_interval);
+    }
+  else if (!strcmp (name, "progress-delta"))
+    {
+      return numeric_ctx_flag (ctx, ctx->progress_delta);
+    }
   else
     return NULL;
 }
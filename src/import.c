@@ -115,16 +115,14 @@ gpgme_op_import_result (gpgme_ctx_t ctx)
 }
 
 
+/* Parse the IMPORT_OK or IMPORT_PROBLEM status line ARGS into IMPORT.
+   The fingerprint is not copied; IMPORT->FPR points into ARGS.  */
 static gpgme_error_t
-parse_import (char *args, gpgme_import_status_t *import_status, int problem)
+parse_import (char *args, gpgme_import_status_t import, int problem)
 {
-  gpgme_import_status_t import;
   char *tail;
   long int nr;
 
-  import = malloc (sizeof (*import));
-  if (!import)
-    return gpg_error_from_syserror ();
   import->next = NULL;
 
   gpg_err_set_errno (0);
@@ -132,7 +130,6 @@ parse_import (char *args, gpgme_import_status_t *import_status, int problem)
   if (errno || args == tail || *tail != ' ')
     {
       /* The crypto backend does not behave.  */
-      free (import);
       return trace_gpg_error (GPG_ERR_INV_ENGINE);
     }
   args = tail;
@@ -173,14 +170,7 @@ parse_import (char *args, gpgme_import_status_t *import_status, int problem)
   if (tail)
     *tail = '\0';
 
-  import->fpr = strdup (args);
-  if (!import->fpr)
-    {
-      free (import);
-      return gpg_error_from_syserror ();
-    }
-
-  *import_status = import;
+  import->fpr = args;
   return 0;
 }
 
@@ -240,12 +230,40 @@ import_status_handler (void *priv, gpgme_status_code_t code, char *args)
     {
     case GPGME_STATUS_IMPORT_OK:
     case GPGME_STATUS_IMPORT_PROBLEM:
-      err = parse_import (args, opd->lastp,
-			  code == GPGME_STATUS_IMPORT_OK ? 0 : 1);
-      if (err)
-	return err;
-
-      opd->lastp = &(*opd->lastp)->next;
+      if (ctx->import_cb)
+        {
+          /* Pass the status to the callback without keeping it.  */
+          struct _gpgme_import_status import;
+
+          err = parse_import (args, &import,
+                              code == GPGME_STATUS_IMPORT_OK ? 0 : 1);
+          if (!err)
+            err = ctx->import_cb (ctx->import_cb_value, &import);
+          return err;
+        }
+      else
+        {
+          gpgme_import_status_t import;
+
+          import = malloc (sizeof (*import));
+          if (!import)
+            return gpg_error_from_syserror ();
+          err = parse_import (args, import,
+                              code == GPGME_STATUS_IMPORT_OK ? 0 : 1);
+          if (!err)
+            {
+              import->fpr = strdup (import->fpr);
+              if (!import->fpr)
+                err = gpg_error_from_syserror ();
+            }
+          if (err)
+            {
+              free (import);
+              return err;
+            }
+          *opd->lastp = import;
+          opd->lastp = &import->next;
+        }
       break;
 
     case GPGME_STATUS_IMPORT_RES:
@@ -259,6 +277,38 @@ import_status_handler (void *priv, gpgme_status_code_t code, char *args)
 }
 
 
+/* Set the callback function CB which is called with the status of
+   each imported key.  */
+void
+gpgme_set_import_cb (gpgme_ctx_t ctx, gpgme_import_cb_t cb, void *cb_value)
+{
+  TRACE (DEBUG_CTX, "gpgme_set_import_cb", ctx, "import_cb=%p/%p",
+	  cb, cb_value);
+
+  if (!ctx)
+    return;
+
+  ctx->import_cb = cb;
+  ctx->import_cb_value = cb_value;
+}
+
+
+/* Return the callback function which is called with the status of
+   each imported key.  */
+void
+gpgme_get_import_cb (gpgme_ctx_t ctx, gpgme_import_cb_t *r_cb,
+                     void **r_cb_value)
+{
+  TRACE (DEBUG_CTX, "gpgme_get_import_cb", ctx, "ctx->import_cb=%p/%p",
+	  ctx ? ctx->import_cb : NULL, ctx ? ctx->import_cb_value : NULL);
+
+  if (r_cb)
+    *r_cb = ctx ? ctx->import_cb : NULL;
+  if (r_cb_value)
+    *r_cb_value = ctx && ctx->import_cb ? ctx->import_cb_value : NULL;
+}
+
+
 static gpgme_error_t
 _gpgme_op_import_start (gpgme_ctx_t ctx, int synchronous, gpgme_data_t keydata)
 {
@@ -39,6 +39,99 @@
    key are read only.  */
 DEFINE_STATIC_LOCK (key_ref_lock);
 
+/* Protects the parsing of signatures on demand.  */
+DEFINE_STATIC_LOCK (key_sigs_lock);
+
+
+/* Strings which are the same for many keys, like curve names and
+   issuer names, are shared by all keys.  The table does not grow
+   because the number of distinct strings is small.  */
+#define INTERN_TABLE_SIZE 251
+
+struct intern_s
+{
+  struct intern_s *next;
+  unsigned int refs;
+  unsigned int hash;
+  char string[1];
+};
+
+static struct intern_s *intern_table[INTERN_TABLE_SIZE];
+
+/* Protects INTERN_TABLE and the reference counters of its items.  */
+DEFINE_STATIC_LOCK (intern_lock);
+
+
+static unsigned int
+intern_hash (const char *string)
+{
+  unsigned int hash = 5381;
+
+  for (; *string; string++)
+    hash = hash * 33 + (unsigned char)*string;
+  return hash;
+}
+
+
+/* Return a shared copy of STRING which must be released with
+   _gpgme_key_intern_release.  Returns NULL with ERRNO set on
+   error.  */
+char *
+_gpgme_key_intern (const char *string)
+{
+  unsigned int hash = intern_hash (string);
+  struct intern_s *item;
+  size_t len;
+
+  LOCK (intern_lock);
+  for (item = intern_table[hash % INTERN_TABLE_SIZE]; item; item = item->next)
+    if (item->hash == hash && !strcmp (item->string, string))
+      {
+        item->refs++;
+        UNLOCK (intern_lock);
+        return item->string;
+      }
+
+  len = strlen (string);
+  item = malloc (sizeof *item + len);
+  if (!item)
+    {
+      UNLOCK (intern_lock);
+      return NULL;
+    }
+  item->refs = 1;
+  item->hash = hash;
+  memcpy (item->string, string, len + 1);
+  item->next = intern_table[hash % INTERN_TABLE_SIZE];
+  intern_table[hash % INTERN_TABLE_SIZE] = item;
+  UNLOCK (intern_lock);
+
+  return item->string;
+}
+
+
+void
+_gpgme_key_intern_release (char *string)
+{
+  struct intern_s *item, **itemp;
+
+  if (!string)
+    return;
+
+  item = (struct intern_s *)(string - offsetof (struct intern_s, string));
+  LOCK (intern_lock);
+  assert (item->refs > 0);
+  if (!--item->refs)
+    {
+      for (itemp = &intern_table[item->hash % INTERN_TABLE_SIZE];
+           *itemp != item; itemp = &(*itemp)->next)
+        ;
+      *itemp = item->next;
+      free (item);
+    }
+  UNLOCK (intern_lock);
+}
+
 
 /* Create a new key.  */
 gpgme_error_t
@@ -256,15 +349,12 @@ _gpgme_key_append_name (gpgme_key_t key, const char *src, int convert)
 
 
 gpgme_key_sig_t
-_gpgme_key_add_sig (gpgme_key_t key, char *src)
+_gpgme_key_add_sig (gpgme_key_t key, gpgme_user_id_t uid, char *src)
 {
   int src_len = src ? strlen (src) : 0;
-  gpgme_user_id_t uid;
   gpgme_key_sig_t sig;
 
   assert (key);	/* XXX */
-
-  uid = key->_last_uid;
   assert (uid);	/* XXX */
 
   /* We can malloc a buffer of the same length, because the converted
@@ -314,6 +404,31 @@ gpgme_key_ref (gpgme_key_t key)
 }
 
 
+/* Return the signatures of UID of KEY at R_SIGS.  If the signatures
+   have been stored by a key listing with the flag "lazy-key-sigs" they
+   are parsed now.  */
+gpgme_error_t
+gpgme_key_get_signatures (gpgme_key_t key, gpgme_user_id_t uid,
+                          gpgme_key_sig_t *r_sigs)
+{
+  gpgme_error_t err = 0;
+
+  if (r_sigs)
+    *r_sigs = NULL;
+  if (!key || !uid || !r_sigs)
+    return gpg_error (GPG_ERR_INV_VALUE);
+
+  LOCK (key_sigs_lock);
+  if (uid->_raw_sigs)
+    err = _gpgme_keylist_parse_sigs (key, uid);
+  if (!err)
+    *r_sigs = uid->signatures;
+  UNLOCK (key_sigs_lock);
+
+  return err;
+}
+
+
 /* gpgme_key_unref releases the key object.  Note, that this function
    may not do an actual release if there are other shallow copies of
    the objects.  You have to call this function for every newly
@@ -337,14 +452,18 @@ gpgme_key_unref (gpgme_key_t key)
     }
   UNLOCK (key_ref_lock);
 
+  /* The fingerprint of a listed key is that of the primary key.  */
+  if (!key->subkeys || key->fpr != key->subkeys->fpr)
+    free (key->fpr);
+
   subkey = key->subkeys;
   while (subkey)
     {
       gpgme_subkey_t next = subkey->next;
       free (subkey->fpr);
-      free (subkey->curve);
+      _gpgme_key_intern_release (subkey->curve);
       free (subkey->keygrip);
-      free (subkey->card_number);
+      _gpgme_key_intern_release (subkey->card_number);
       free (subkey);
       subkey = next;
     }
@@ -386,14 +505,14 @@ gpgme_key_unref (gpgme_key_t key)
 
       free (uid->address);
       free (uid->uidhash);
+      free (uid->_raw_sigs);
       free (uid);
       uid = next_uid;
     }
 
   free (key->issuer_serial);
-  free (key->issuer_name);
-  free (key->chain_id);
-  free (key->fpr);
+  _gpgme_key_intern_release (key->issuer_name);
+  _gpgme_key_intern_release (key->chain_id);
 
   free (key);
 }
@@ -694,7 +813,8 @@ get_keysig (gpgme_key_t key, int uid_idx, int idx)
   if (!uid)
     return NULL;
 
-  sig = uid->signatures;
+  if (gpgme_key_get_signatures (key, uid, &sig))
+    return NULL;
   while (sig && idx > 0)
     {
       sig = sig->next;
@@ -0,0 +1,406 @@
+/* keylist-records.c - Listing keys as compact records.
+ * Copyright (C) 2021 g10 Code GmbH
+ *
+ * This file is part of GPGME.
+ *
+ * GPGME is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * GPGME is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <https://gnu.org/licenses/>.
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* The records are a projection of the key listing: only the requested
+ * fields of the primary key and its first user ID are parsed from the
+ * colon lines and no gpgme_key_t objects are built.  All records are
+ * stored in one array and all strings in one pool.  */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "gpgme.h"
+#include "util.h"
+#include "context.h"
+#include "ops.h"
+#include "debug.h"
+
+
+typedef struct
+{
+  struct _gpgme_op_keylist_records_result result;
+
+  /* The requested fields.  */
+  unsigned int fields;
+
+  /* The allocated number of records.  */
+  size_t records_size;
+
+  /* The string pool, its used and its allocated length.  */
+  char *strings;
+  size_t strings_len;
+  size_t strings_size;
+
+  /* True while the lines of the primary key of the current record are
+     parsed; false before the first key and after a subkey.  */
+  int in_primary;
+
+  /* Set when the fingerprint resp. the user ID of the current record
+     have been seen.  */
+  int have_fpr;
+  int have_uid;
+
+  /* The error code from ERROR keydb_search. */
+  gpgme_error_t keydb_search_err;
+} *op_data_t;
+
+
+static void
+release_op_data (void *hook)
+{
+  op_data_t opd = (op_data_t) hook;
+
+  free (opd->result.records);
+  free (opd->strings);
+}
+
+
+gpgme_keylist_records_result_t
+gpgme_op_keylist_records_result (gpgme_ctx_t ctx)
+{
+  void *hook;
+  op_data_t opd;
+  gpgme_error_t err;
+
+  TRACE_BEG (DEBUG_CTX, "gpgme_op_keylist_records_result", ctx, "");
+
+  err = _gpgme_op_data_lookup (ctx, OPDATA_KEYLIST_RECORDS, &hook, -1, NULL);
+  opd = hook;
+  if (err || !opd)
+    {
+      TRACE_SUC ("result=(null)");
+      return NULL;
+    }
+
+  TRACE_LOG ("%zu records, %zu bytes of strings",
+             opd->result.nrecords, opd->strings_len);
+  TRACE_SUC ("result=%p", &opd->result);
+  return &opd->result;
+}
+
+
+/* Append the C escaped string SRC to the string pool of OPD and return
+   its offset at R_OFF.  */
+static gpgme_error_t
+add_string (op_data_t opd, const char *src, size_t *r_off)
+{
+  size_t needed = strlen (src) + 1;
+  gpgme_error_t err;
+  char *dst;
+
+  if (opd->strings_size - opd->strings_len < needed)
+    {
+      size_t new_size = opd->strings_size;
+      char *new_strings;
+
+      while (new_size - opd->strings_len < needed)
+        new_size *= 2;
+      new_strings = realloc (opd->strings, new_size);
+      if (!new_strings)
+        return gpg_error_from_syserror ();
+      opd->strings = new_strings;
+      opd->strings_size = new_size;
+      opd->result.strings = new_strings;
+    }
+
+  dst = opd->strings + opd->strings_len;
+  err = _gpgme_decode_c_string (src, &dst,
+                                opd->strings_size - opd->strings_len);
+  if (err)
+    return err;
+  *r_off = opd->strings_len;
+  opd->strings_len += strlen (dst) + 1;
+  return 0;
+}
+
+
+/* Append a new record to the result of OPD and return it at R_REC.  */
+static gpgme_error_t
+add_record (op_data_t opd, gpgme_key_record_t *r_rec)
+{
+  gpgme_key_record_t rec;
+
+  if (opd->result.nrecords == opd->records_size)
+    {
+      size_t new_size = opd->records_size? 2 * opd->records_size : 64;
+
+      rec = realloc (opd->result.records, new_size * sizeof *rec);
+      if (!rec)
+        return gpg_error_from_syserror ();
+      opd->result.records = rec;
+      opd->records_size = new_size;
+    }
+
+  rec = opd->result.records + opd->result.nrecords++;
+  memset (rec, 0, sizeof *rec);
+  *r_rec = rec;
+  return 0;
+}
+
+
+/* Set the flags of REC from the validity field VALIDITY and the
+   capability field CAPS of the primary key.  */
+static void
+set_flags (gpgme_key_record_t rec, const char *validity, const char *caps)
+{
+  for (; *validity && !isdigit (*validity); validity++)
+    switch (*validity)
+      {
+      case 'e': rec->expired = 1; break;
+      case 'r': rec->revoked = 1; break;
+      case 'd': rec->disabled = 1; break;
+      case 'i': rec->invalid = 1; break;
+      }
+
+  /* The upper case letters give the capabilities of the whole key.  */
+  for (; *caps; caps++)
+    switch (*caps)
+      {
+      case 'E': rec->can_encrypt = 1; break;
+      case 'S': rec->can_sign = 1; break;
+      case 'C': rec->can_certify = 1; break;
+      case 'A': rec->can_authenticate = 1; break;
+      case 'D': rec->disabled = 1; break;
+      }
+}
+
+
+static gpgme_error_t
+records_status_handler (void *priv, gpgme_status_code_t code, char *args)
+{
+  gpgme_ctx_t ctx = (gpgme_ctx_t) priv;
+  gpgme_error_t err;
+  void *hook;
+  op_data_t opd;
+
+  err = _gpgme_op_data_lookup (ctx, OPDATA_KEYLIST_RECORDS, &hook, -1, NULL);
+  opd = hook;
+  if (err)
+    return err;
+
+  switch (code)
+    {
+    case GPGME_STATUS_ERROR:
+      err = _gpgme_parse_failure (args);
+      if (!opd->keydb_search_err && !strcmp (args, "keydb_search"))
+        opd->keydb_search_err = err;
+      err = 0;
+      break;
+
+    case GPGME_STATUS_EOF:
+      err = opd->keydb_search_err;
+      break;
+
+    default:
+      break;
+    }
+  return err;
+}
+
+
+static gpgme_error_t
+records_colon_handler (void *priv, char *line)
+{
+  gpgme_ctx_t ctx = (gpgme_ctx_t) priv;
+#define NR_FIELDS 12
+  char *field[NR_FIELDS];
+  int fields = 0;
+  gpgme_error_t err;
+  void *hook;
+  op_data_t opd;
+  gpgme_key_record_t rec;
+
+  if (!line)
+    return 0;  /* End Of File.  */
+
+  err = _gpgme_op_data_lookup (ctx, OPDATA_KEYLIST_RECORDS, &hook, -1, NULL);
+  opd = hook;
+  if (err)
+    return err;
+
+  /* Look only at the first three letters to skip uninteresting
+     records as early as possible.  */
+  if (!strncmp (line, "pub:", 4) || !strncmp (line, "sec:", 4)
+      || !strncmp (line, "crt:", 4) || !strncmp (line, "crs:", 4))
+    {
+      err = add_record (opd, &rec);
+      if (err)
+        return err;
+      opd->in_primary = 1;
+      opd->have_fpr = opd->have_uid = 0;
+    }
+  else if (!strncmp (line, "sub:", 4) || !strncmp (line, "ssb:", 4))
+    {
+      opd->in_primary = 0;
+      return 0;
+    }
+  else if (!strncmp (line, "fpr:", 4))
+    {
+      if (!opd->in_primary || opd->have_fpr
+          || !(opd->fields & GPGME_KEYREC_FPR))
+        return 0;
+    }
+  else if (!strncmp (line, "uid:", 4))
+    {
+      /* The user IDs follow the subkeys with gpgsm.  */
+      if (!opd->result.nrecords || opd->have_uid
+          || !(opd->fields & GPGME_KEYREC_UID))
+        return 0;
+    }
+  else
+    return 0;
+
+  while (line && fields < NR_FIELDS)
+    {
+      field[fields++] = line;
+      line = strchr (line, ':');
+      if (line)
+	*(line++) = '\0';
+    }
+
+  rec = opd->result.records + opd->result.nrecords - 1;
+  switch (*field[0])
+    {
+    case 'p':
+    case 's':
+    case 'c':
+      /* Field 5 has the long keyid.  */
+      if ((opd->fields & GPGME_KEYREC_KEYID)
+          && fields >= 5 && strlen (field[4]) < DIM (rec->keyid))
+        strcpy (rec->keyid, field[4]);
+      /* Field 2 has the validity and field 12 the capabilities.  */
+      if ((opd->fields & GPGME_KEYREC_FLAGS) && fields >= 2)
+        {
+          rec->secret = (field[0][0] == 's' || field[0][2] == 's');
+          set_flags (rec, field[1], fields >= 12? field[11] : "");
+        }
+      break;
+
+    case 'f':
+      /* Field 10 has the fingerprint.  */
+      if (fields >= 10 && strlen (field[9]) < DIM (rec->fpr))
+        strcpy (rec->fpr, field[9]);
+      opd->have_fpr = 1;
+      break;
+
+    case 'u':
+      /* Field 10 has the user ID.  */
+      if (fields >= 10)
+        {
+          err = add_string (opd, field[9], &rec->uid);
+          if (err)
+            return err;
+        }
+      opd->have_uid = 1;
+      break;
+    }
+
+  return 0;
+}
+
+
+static gpgme_error_t
+keylist_records_start (gpgme_ctx_t ctx, int synchronous,
+                       const char *pattern[], int secret_only,
+                       unsigned int fields)
+{
+  gpgme_error_t err;
+  void *hook;
+  op_data_t opd;
+  int flags = 0;
+
+  err = _gpgme_op_reset (ctx, synchronous);
+  if (err)
+    return err;
+
+  err = _gpgme_op_data_lookup (ctx, OPDATA_KEYLIST_RECORDS, &hook,
+			       sizeof (*opd), release_op_data);
+  opd = hook;
+  if (err)
+    return err;
+  opd->fields = fields;
+
+  /* The offset 0 of the string pool is the empty string.  */
+  opd->strings_size = 4096;
+  opd->strings = malloc (opd->strings_size);
+  if (!opd->strings)
+    return gpg_error_from_syserror ();
+  *opd->strings = 0;
+  opd->strings_len = 1;
+  opd->result.strings = opd->strings;
+
+  _gpgme_engine_set_status_handler (ctx->engine, records_status_handler, ctx);
+  err = _gpgme_engine_set_colon_line_handler (ctx->engine,
+					      records_colon_handler, ctx);
+  if (err)
+    return err;
+
+  if (ctx->offline)
+    flags |= GPGME_ENGINE_FLAG_OFFLINE;
+
+  /* Signatures, validation and secret key details are never needed
+     for the records.  */
+  return _gpgme_engine_op_keylist_ext (ctx->engine, pattern, secret_only, 0,
+                                       GPGME_KEYLIST_MODE_LOCAL, flags);
+}
+
+
+/* Start a listing of the keys matching PATTERN as compact records
+   with the given FIELDS.  */
+gpgme_error_t
+gpgme_op_keylist_records_start (gpgme_ctx_t ctx, const char *pattern[],
+                                int secret_only, unsigned int fields)
+{
+  gpgme_error_t err;
+
+  TRACE_BEG (DEBUG_CTX, "gpgme_op_keylist_records_start", ctx,
+	     "secret_only=%i, fields=0x%x", secret_only, fields);
+
+  if (!ctx)
+    return TRACE_ERR (gpg_error (GPG_ERR_INV_VALUE));
+
+  err = keylist_records_start (ctx, 0, pattern, secret_only, fields);
+  return TRACE_ERR (err);
+}
+
+
+/* List the keys matching PATTERN as compact records with the given
+   FIELDS.  */
+gpgme_error_t
+gpgme_op_keylist_records (gpgme_ctx_t ctx, const char *pattern[],
+                          int secret_only, unsigned int fields)
+{
+  gpgme_error_t err;
+
+  TRACE_BEG (DEBUG_CTX, "gpgme_op_keylist_records", ctx,
+	     "secret_only=%i, fields=0x%x", secret_only, fields);
+
+  if (!ctx)
+    return TRACE_ERR (gpg_error (GPG_ERR_INV_VALUE));
+
+  err = keylist_records_start (ctx, 1, pattern, secret_only, fields);
+  if (!err)
+    err = _gpgme_wait_one (ctx);
+  return TRACE_ERR (err);
+}
@@ -35,6 +35,9 @@
 #include <ctype.h>
 #include <errno.h>
 #include <limits.h>
+#ifdef HAVE_REGEX_H
+# include <regex.h>
+#endif
 
 /* Suppress warning for accessing deprecated member "class".  */
 #define _GPGME_IN_GPGME
@@ -42,9 +45,23 @@
 #include "util.h"
 #include "context.h"
 #include "ops.h"
+#include "priv-io.h"
 #include "debug.h"
 
 
+/* A keylist filter as stored in the context.  */
+struct keylist_filter_s
+{
+  /* A copy of the filter set by the user.  UID_REGEX points to
+     REGEX_STRING.  */
+  struct _gpgme_keylist_filter filter;
+  char *regex_string;
+#ifdef HAVE_REGEX_H
+  regex_t regex;
+#endif
+};
+
+
 struct key_queue_item_s
 {
   struct key_queue_item_s *next;
@@ -66,31 +83,111 @@ typedef struct
   /* This points to the last sig in tmp_uid.  */
   gpgme_key_sig_t tmp_keysig;
 
+  /* With the context flag "lazy-key-sigs" the used and the allocated
+     length of the stored signature records of tmp_uid, and whether the
+     last stored record is a signature.  */
+  size_t raw_sigs_len;
+  size_t raw_sigs_size;
+  int raw_keysig;
+
   /* Something new is available.  */
   int key_cond;
   struct key_queue_item_s *key_queue;
+
+  /* The maximum number of keys to return or 0 for no limit, and the
+     number of keys queued so far.  */
+  unsigned int limit;
+  unsigned int nkeys;
+
+  /* Set if the current key has been rejected by the keylist filter
+     and the remaining lines of its keyblock are to be skipped.  */
+  int skip_key;
+
+  /* Set if a user ID of the current key matched the user ID criteria
+     of the keylist filter.  */
+  int uid_matched;
 } *op_data_t;
 
 
-static void
-release_op_data (void *hook)
+/* Return true if KEY passes the key criteria of FILTER.  Only the
+   line of the primary key has been parsed yet.  */
+static int
+filter_match_key (gpgme_keylist_filter_t filter, gpgme_key_t key)
 {
-  op_data_t opd = (op_data_t) hook;
-  struct key_queue_item_s *key = opd->key_queue;
+  if ((filter->can_encrypt && !key->can_encrypt)
+      || (filter->can_sign && !key->can_sign)
+      || (filter->can_certify && !key->can_certify)
+      || (filter->can_authenticate && !key->can_authenticate)
+      || (filter->not_revoked && key->revoked)
+      || (filter->not_expired && key->expired)
+      || (filter->not_disabled && key->disabled)
+      || (filter->not_invalid && key->invalid)
+      || (filter->secret && !key->secret))
+    return 0;
 
-  if (opd->tmp_key)
-    gpgme_key_unref (opd->tmp_key);
+  if (filter->expires_after && key->subkeys && key->subkeys->expires > 0
+      && (unsigned long)key->subkeys->expires < filter->expires_after)
+    return 0;
 
-  /* opd->tmp_uid and opd->tmp_keysig are actually part of opd->tmp_key,
-     so we do not need to release them here.  */
+  return 1;
+}
+
+
+/* Return true if FILTER has criteria for the user IDs.  */
+static int
+filter_has_uid_criteria (struct keylist_filter_s *filter)
+{
+  return (filter->filter.min_validity != GPGME_VALIDITY_UNKNOWN
+          || filter->filter.uid_regex);
+}
+
+
+/* Return true if UID passes the user ID criteria of FILTER.  */
+static int
+filter_match_uid (struct keylist_filter_s *filter, gpgme_user_id_t uid)
+{
+  if (uid->validity < filter->filter.min_validity)
+    return 0;
+#ifdef HAVE_REGEX_H
+  if (filter->filter.uid_regex
+      && regexec (&filter->regex, uid->uid, 0, NULL, 0))
+    return 0;
+#endif
+  return 1;
+}
+
+
+/* Release all keys in the queue of OPD.  */
+static void
+release_key_queue (op_data_t opd)
+{
+  struct key_queue_item_s *key = opd->key_queue;
 
   while (key)
     {
       struct key_queue_item_s *next = key->next;
 
       gpgme_key_unref (key->key);
+      free (key);
       key = next;
     }
+  opd->key_queue = NULL;
+  opd->key_cond = 0;
+}
+
+
+static void
+release_op_data (void *hook)
+{
+  op_data_t opd = (op_data_t) hook;
+
+  if (opd->tmp_key)
+    gpgme_key_unref (opd->tmp_key);
+
+  /* opd->tmp_uid and opd->tmp_keysig are actually part of opd->tmp_key,
+     so we do not need to release them here.  */
+
+  release_key_queue (opd);
 }
 
 
@@ -418,7 +515,7 @@ parse_sec_field15 (gpgme_key_t key, gpgme_subkey_t subkey, char *field)
       /* Fields starts with a hex digit; thus it is a serial number.  */
       key->secret = 1;
       subkey->is_cardkey = 1;
-      subkey->card_number = strdup (field);
+      subkey->card_number = _gpgme_key_intern (field);
       if (!subkey->card_number)
         return gpg_error_from_syserror ();
     }
@@ -528,6 +625,66 @@ parse_tfs_record (gpgme_user_id_t uid, char **field, int nfield)
 }
 
 
+/* Append the record with the NFIELDS fields in FIELD to the stored
+   signature records of the current user ID.  */
+static gpgme_error_t
+store_raw_sig (op_data_t opd, char **field, int nfields)
+{
+  gpgme_user_id_t uid = opd->tmp_uid;
+  size_t needed;
+  char *p;
+  int i;
+
+  for (needed = 1, i = 0; i < nfields; i++)
+    needed += strlen (field[i]) + 1;
+
+  if (opd->raw_sigs_size - opd->raw_sigs_len < needed)
+    {
+      size_t new_size = opd->raw_sigs_size? opd->raw_sigs_size : 256;
+
+      while (new_size - opd->raw_sigs_len < needed)
+        new_size *= 2;
+      p = realloc (uid->_raw_sigs, new_size);
+      if (!p)
+        return gpg_error_from_syserror ();
+      uid->_raw_sigs = p;
+      opd->raw_sigs_size = new_size;
+    }
+
+  /* The fields are joined again and the records are separated by
+     linefeeds.  */
+  p = uid->_raw_sigs + opd->raw_sigs_len;
+  for (i = 0; i < nfields; i++)
+    {
+      p = stpcpy (p, field[i]);
+      *p++ = i + 1 < nfields? ':' : '\n';
+    }
+  *p = 0;
+  opd->raw_sigs_len = p - uid->_raw_sigs;
+  return 0;
+}
+
+
+/* Shrink the stored signature records of the current user ID to
+   their length.  Called when the records of the user ID are
+   complete.  */
+static void
+finish_raw_sigs (op_data_t opd)
+{
+  char *p;
+
+  if (opd->tmp_uid && opd->tmp_uid->_raw_sigs
+      && opd->raw_sigs_len + 1 < opd->raw_sigs_size)
+    {
+      p = realloc (opd->tmp_uid->_raw_sigs, opd->raw_sigs_len + 1);
+      if (p)
+        opd->tmp_uid->_raw_sigs = p;
+    }
+  opd->raw_sigs_len = opd->raw_sigs_size = 0;
+  opd->raw_keysig = 0;
+}
+
+
 /* We have read an entire key into tmp_key and should now finish it.
    It is assumed that this releases tmp_key.  */
 static void
@@ -535,15 +692,147 @@ finish_key (gpgme_ctx_t ctx, op_data_t opd)
 {
   gpgme_key_t key = opd->tmp_key;
 
+  finish_raw_sigs (opd);
   opd->tmp_key = NULL;
   opd->tmp_uid = NULL;
   opd->tmp_keysig = NULL;
 
+  if (key && ctx->keylist_filter && !opd->uid_matched
+      && filter_has_uid_criteria (ctx->keylist_filter))
+    {
+      gpgme_key_unref (key);
+      key = NULL;
+    }
+
   if (key)
     _gpgme_engine_io_event (ctx->engine, GPGME_EVENT_NEXT_KEY, key);
 }
 
 
+/* Parse the signature record with the FIELDS fields in FIELD and add
+   the signature to UID of KEY.  The new signature is returned at
+   R_KEYSIG.  */
+static gpgme_error_t
+parse_sig_record (gpgme_key_t key, gpgme_user_id_t uid,
+                  char **field, int fields, gpgme_key_sig_t *r_keysig)
+{
+  gpgme_key_sig_t keysig;
+
+  keysig = _gpgme_key_add_sig (key, uid, (fields >= 10) ? field[9] : NULL);
+  if (!keysig)
+    return gpg_error (GPG_ERR_ENOMEM);	/* FIXME */
+
+  /* Field 2 has the calculated trust ('!', '-', '?', '%').  */
+  if (fields >= 2)
+    switch (field[1][0])
+      {
+      case '!':
+	keysig->status = gpg_error (GPG_ERR_NO_ERROR);
+	break;
+
+      case '-':
+	keysig->status = gpg_error (GPG_ERR_BAD_SIGNATURE);
+	break;
+
+      case '?':
+	keysig->status = gpg_error (GPG_ERR_NO_PUBKEY);
+	break;
+
+      case '%':
+	keysig->status = gpg_error (GPG_ERR_GENERAL);
+	break;
+
+      default:
+	keysig->status = gpg_error (GPG_ERR_NO_ERROR);
+	break;
+      }
+
+  /* Field 4 has the public key algorithm.  */
+  if (fields >= 4)
+    {
+      int i = atoi (field[3]);
+      if (i >= 1 && i < 128)
+	keysig->pubkey_algo = _gpgme_map_pk_algo (i, key->protocol);
+    }
+
+  /* Field 5 has the long keyid.  */
+  if (fields >= 5 && strlen (field[4]) == DIM(keysig->_keyid) - 1)
+    strcpy (keysig->_keyid, field[4]);
+
+  /* Field 6 has the timestamp (seconds).  */
+  if (fields >= 6)
+    keysig->timestamp = _gpgme_parse_timestamp (field[5], NULL);
+
+  /* Field 7 has the expiration time (seconds).  */
+  if (fields >= 7)
+    keysig->expires = _gpgme_parse_timestamp (field[6], NULL);
+
+  /* Field 11 has the signature class (eg, 0x30 means revoked).  */
+  if (fields >= 11)
+    if (field[10][0] && field[10][1])
+      {
+	int sig_class = _gpgme_hextobyte (field[10]);
+	if (sig_class >= 0)
+	  {
+	    keysig->sig_class = sig_class;
+	    keysig->class = keysig->sig_class;
+	    if (sig_class == 0x30)
+	      keysig->revoked = 1;
+	  }
+	if (field[10][2] == 'x')
+	  keysig->exportable = 1;
+      }
+
+  *r_keysig = keysig;
+  return 0;
+}
+
+
+/* Parse the subpacket record with the FIELDS fields in FIELD and add a
+   notation or policy URL to KEYSIG.  */
+static gpgme_error_t
+parse_spk_record (gpgme_key_sig_t keysig, char **field, int fields)
+{
+  gpgme_error_t err;
+
+  if (fields >= 4)
+    {
+      /* Field 2 has the subpacket type.  */
+      int type = atoi (field[1]);
+
+      /* Field 3 has the flags.  */
+      int flags = atoi (field[2]);
+
+      /* Field 4 has the length.  */
+      int len = atoi (field[3]);
+
+      /* Field 5 has the data.  */
+      char *data = field[4];
+
+      /* Type 20: Notation data.  */
+      /* Type 26: Policy URL.  */
+      if (type == 20 || type == 26)
+	{
+	  gpgme_sig_notation_t notation;
+
+	  /* At this time, any error is serious.  */
+	  err = _gpgme_parse_notation (&notation, type, flags, len, data);
+	  if (err)
+	    return err;
+
+	  /* Add a new notation.  FIXME: Could be factored out.  */
+	  if (!keysig->notations)
+	    keysig->notations = notation;
+	  if (keysig->_last_notation)
+	    keysig->_last_notation->next = notation;
+	  keysig->_last_notation = notation;
+	}
+    }
+
+  return 0;
+}
+
+
 /* Note: We are allowed to modify LINE.  */
 static gpgme_error_t
 keylist_colon_handler (void *priv, char *line)
@@ -619,18 +908,33 @@ keylist_colon_handler (void *priv, char *line)
   else
     rectype = RT_NONE;
 
+  /* Skip the keyblock of a key rejected by the keylist filter.  */
+  if (opd->skip_key)
+    {
+      if (rectype != RT_PUB && rectype != RT_SEC
+          && rectype != RT_CRT && rectype != RT_CRS)
+        return 0;
+      opd->skip_key = 0;
+    }
+
   /* Only look at signature and trust info records immediately
      following a user ID.  For this, clear the user ID pointer when
      encountering anything but a signature, trust record or subpacket.  */
   if (rectype != RT_SIG && rectype != RT_REV && rectype != RT_TFS &&
       rectype != RT_SPK)
-    opd->tmp_uid = NULL;
+    {
+      finish_raw_sigs (opd);
+      opd->tmp_uid = NULL;
+    }
 
   /* Only look at subpackets immediately following a signature.  For
      this, clear the signature pointer when encountering anything but
      a subpacket.  */
   if (rectype != RT_SPK)
-    opd->tmp_keysig = NULL;
+    {
+      opd->tmp_keysig = NULL;
+      opd->raw_keysig = 0;
+    }
 
   switch (rectype)
     {
@@ -706,8 +1010,16 @@ keylist_colon_handler (void *priv, char *line)
       /* Field 10 is not used for gpg due to --fixed-list-mode option
 	 but GPGSM stores the issuer name.  */
       if (fields >= 10 && (rectype == RT_CRT || rectype == RT_CRS))
-	if (_gpgme_decode_c_string (field[9], &key->issuer_name, 0))
-	  return gpg_error (GPG_ERR_ENOMEM);	/* FIXME */
+	{
+	  char *issuer_name = NULL;
+
+	  if (_gpgme_decode_c_string (field[9], &issuer_name, 0))
+	    return gpg_error (GPG_ERR_ENOMEM);	/* FIXME */
+	  key->issuer_name = _gpgme_key_intern (issuer_name);
+	  free (issuer_name);
+	  if (!key->issuer_name)
+	    return gpg_error (GPG_ERR_ENOMEM);
+	}
 
       /* Field 11 has the signature class.  */
 
@@ -728,7 +1040,7 @@ keylist_colon_handler (void *priv, char *line)
       /* Field 17 has the curve name for ECC.  */
       if (fields >= 17 && *field[16])
         {
-          subkey->curve = strdup (field[16]);
+          subkey->curve = _gpgme_key_intern (field[16]);
           if (!subkey->curve)
             return gpg_error_from_syserror ();
         }
@@ -743,6 +1055,18 @@ keylist_colon_handler (void *priv, char *line)
           key->origin = parse_keyorg (field[19]);
         }
 
+      /* Reject the key before its subkeys, user IDs and signatures
+         are parsed.  */
+      if (ctx->keylist_filter)
+        {
+          opd->uid_matched = 0;
+          if (!filter_match_key (&ctx->keylist_filter->filter, key))
+            {
+              opd->tmp_key = NULL;
+              gpgme_key_unref (key);
+              opd->skip_key = 1;
+            }
+        }
       break;
 
     case RT_SUB:
@@ -811,7 +1135,7 @@ keylist_colon_handler (void *priv, char *line)
       /* Field 17 has the curve name for ECC.  */
       if (fields >= 17 && *field[16])
         {
-          subkey->curve = strdup (field[16]);
+          subkey->curve = _gpgme_key_intern (field[16]);
           if (!subkey->curve)
             return gpg_error_from_syserror ();
         }
@@ -843,6 +1167,9 @@ keylist_colon_handler (void *priv, char *line)
               opd->tmp_uid->last_update = _gpgme_parse_timestamp_ul (field[18]);
               opd->tmp_uid->origin = parse_keyorg (field[19]);
             }
+          if (ctx->keylist_filter && !opd->uid_matched
+              && filter_match_uid (ctx->keylist_filter, opd->tmp_uid))
+            opd->uid_matched = 1;
 	}
       break;
 
@@ -868,8 +1195,8 @@ keylist_colon_handler (void *priv, char *line)
               if (!subkey->fpr)
                 return gpg_error_from_syserror ();
             }
-          /* If this is the first subkey, store the fingerprint also
-             in the KEY object.  */
+          /* If this is the first subkey, the KEY object uses its
+             fingerprint.  */
           if (subkey == key->subkeys)
             {
               if (key->fpr && strcmp (key->fpr, subkey->fpr))
@@ -878,18 +1205,14 @@ keylist_colon_handler (void *priv, char *line)
                   return trace_gpg_error (GPG_ERR_INTERNAL);
                 }
               if (!key->fpr)
-                {
-                  key->fpr = strdup (subkey->fpr);
-                  if (!key->fpr)
-                    return gpg_error_from_syserror ();
-                }
+                key->fpr = subkey->fpr;
             }
 	}
 
       /* Field 13 has the gpgsm chain ID (take only the first one).  */
       if (fields >= 13 && !key->chain_id && *field[12])
 	{
-	  key->chain_id = strdup (field[12]);
+	  key->chain_id = _gpgme_key_intern (field[12]);
 	  if (!key->chain_id)
 	    return gpg_error_from_syserror ();
 	}
@@ -916,116 +1239,42 @@ keylist_colon_handler (void *priv, char *line)
       if (!opd->tmp_uid)
 	return 0;
 
+      if (ctx->lazy_key_sigs)
+        {
+          /* Store the record to be parsed on demand.  */
+          err = store_raw_sig (opd, field, fields);
+          if (err)
+            return err;
+          opd->raw_keysig = 1;
+          break;
+        }
+
       /* Start a new (revoked) signature.  */
       assert (opd->tmp_uid == key->_last_uid);
-      keysig = _gpgme_key_add_sig (key, (fields >= 10) ? field[9] : NULL);
-      if (!keysig)
-	return gpg_error (GPG_ERR_ENOMEM);	/* FIXME */
-
-      /* Field 2 has the calculated trust ('!', '-', '?', '%').  */
-      if (fields >= 2)
-	switch (field[1][0])
-	  {
-	  case '!':
-	    keysig->status = gpg_error (GPG_ERR_NO_ERROR);
-	    break;
-
-	  case '-':
-	    keysig->status = gpg_error (GPG_ERR_BAD_SIGNATURE);
-	    break;
-
-	  case '?':
-	    keysig->status = gpg_error (GPG_ERR_NO_PUBKEY);
-	    break;
-
-	  case '%':
-	    keysig->status = gpg_error (GPG_ERR_GENERAL);
-	    break;
-
-	  default:
-	    keysig->status = gpg_error (GPG_ERR_NO_ERROR);
-	    break;
-	  }
-
-      /* Field 4 has the public key algorithm.  */
-      if (fields >= 4)
-	{
-	  int i = atoi (field[3]);
-	  if (i >= 1 && i < 128)
-	    keysig->pubkey_algo = _gpgme_map_pk_algo (i, ctx->protocol);
-	}
-
-      /* Field 5 has the long keyid.  */
-      if (fields >= 5 && strlen (field[4]) == DIM(keysig->_keyid) - 1)
-	strcpy (keysig->_keyid, field[4]);
-
-      /* Field 6 has the timestamp (seconds).  */
-      if (fields >= 6)
-	keysig->timestamp = _gpgme_parse_timestamp (field[5], NULL);
-
-      /* Field 7 has the expiration time (seconds).  */
-      if (fields >= 7)
-	keysig->expires = _gpgme_parse_timestamp (field[6], NULL);
-
-      /* Field 11 has the signature class (eg, 0x30 means revoked).  */
-      if (fields >= 11)
-	if (field[10][0] && field[10][1])
-	  {
-	    int sig_class = _gpgme_hextobyte (field[10]);
-	    if (sig_class >= 0)
-	      {
-		keysig->sig_class = sig_class;
-		keysig->class = keysig->sig_class;
-		if (sig_class == 0x30)
-		  keysig->revoked = 1;
-	      }
-	    if (field[10][2] == 'x')
-	      keysig->exportable = 1;
-	  }
-
+      err = parse_sig_record (key, opd->tmp_uid, field, fields, &keysig);
+      if (err)
+        return err;
       opd->tmp_keysig = keysig;
       break;
 
     case RT_SPK:
+      if (opd->raw_keysig)
+        {
+          /* Only the notations are needed from the subpackets.  */
+          if (fields >= 4 && (atoi (field[1]) == 20 || atoi (field[1]) == 26))
+            err = store_raw_sig (opd, field, fields);
+          if (err)
+            return err;
+          break;
+        }
       if (!opd->tmp_keysig)
 	return 0;
       assert (opd->tmp_keysig == key->_last_uid->_last_keysig);
 
-      if (fields >= 4)
-	{
-	  /* Field 2 has the subpacket type.  */
-	  int type = atoi (field[1]);
-
-	  /* Field 3 has the flags.  */
-	  int flags = atoi (field[2]);
-
-	  /* Field 4 has the length.  */
-	  int len = atoi (field[3]);
-
-	  /* Field 5 has the data.  */
-	  char *data = field[4];
-
-	  /* Type 20: Notation data.  */
-	  /* Type 26: Policy URL.  */
-	  if (type == 20 || type == 26)
-	    {
-	      gpgme_sig_notation_t notation;
-
-	      keysig = opd->tmp_keysig;
-
-	      /* At this time, any error is serious.  */
-	      err = _gpgme_parse_notation (&notation, type, flags, len, data);
-	      if (err)
-		return err;
-
-	      /* Add a new notation.  FIXME: Could be factored out.  */
-	      if (!keysig->notations)
-		keysig->notations = notation;
-	      if (keysig->_last_notation)
-		keysig->_last_notation->next = notation;
-	      keysig->_last_notation = notation;
-	    }
-	}
+      err = parse_spk_record (opd->tmp_keysig, field, fields);
+      if (err)
+        return err;
+      break;
 
     case RT_NONE:
       /* Unknown record.  */
@@ -1052,6 +1301,14 @@ _gpgme_op_keylist_event_cb (void *data, gpgme_event_io_t type, void *type_data)
   if (err)
     return;
 
+  /* Drop keys beyond the limit which have already been produced by
+     the engine.  */
+  if (opd->limit && opd->nkeys >= opd->limit)
+    {
+      gpgme_key_unref (key);
+      return;
+    }
+
   q = malloc (sizeof *q);
   if (!q)
     {
@@ -1070,10 +1327,34 @@ _gpgme_op_keylist_event_cb (void *data, gpgme_event_io_t type, void *type_data)
 	;
       q2->next = q;
     }
+  opd->nkeys++;
   opd->key_cond = 1;
 }
 
 
+/* Stop a running key listing in CTX.  The pipes to the engine are
+   closed which makes the engine terminate and the operation is
+   finished with success.  */
+static gpgme_error_t
+stop_keylist (gpgme_ctx_t ctx)
+{
+  gpgme_error_t err;
+  struct gpgme_io_event_done_data data;
+
+  if (!ctx->engine || !_gpgme_op_is_pending (ctx))
+    return 0;
+
+  err = _gpgme_engine_cancel (ctx->engine);
+  if (err)
+    return err;
+
+  data.err = 0;
+  data.op_err = 0;
+  _gpgme_engine_io_event (ctx->engine, GPGME_EVENT_DONE, &data);
+  return 0;
+}
+
+
 /* Start a keylist operation within CTX, searching for keys which
    match PATTERN.  If SECRET_ONLY is true, only secret keys are
    returned.  */
@@ -1100,6 +1381,7 @@ gpgme_op_keylist_start (gpgme_ctx_t ctx, const char *pattern, int secret_only)
   opd = hook;
   if (err)
     return TRACE_ERR (err);
+  opd->limit = ctx->keylist_limit;
 
   _gpgme_engine_set_status_handler (ctx->engine, keylist_status_handler, ctx);
 
@@ -1144,6 +1426,7 @@ gpgme_op_keylist_ext_start (gpgme_ctx_t ctx, const char *pattern[],
   opd = hook;
   if (err)
     return TRACE_ERR (err);
+  opd->limit = ctx->keylist_limit;
 
   _gpgme_engine_set_status_handler (ctx->engine, keylist_status_handler, ctx);
   err = _gpgme_engine_set_colon_line_handler (ctx->engine,
@@ -1185,6 +1468,7 @@ gpgme_op_keylist_from_data_start (gpgme_ctx_t ctx, gpgme_data_t data,
   opd = hook;
   if (err)
     return TRACE_ERR (err);
+  opd->limit = ctx->keylist_limit;
 
   _gpgme_engine_set_status_handler (ctx->engine, keylist_status_handler, ctx);
   err = _gpgme_engine_set_colon_line_handler (ctx->engine,
@@ -1223,6 +1507,9 @@ gpgme_op_keylist_next (gpgme_ctx_t ctx, gpgme_key_t *r_key)
 
   if (!opd->key_queue)
     {
+      if (opd->limit && opd->nkeys >= opd->limit)
+        return TRACE_ERR (gpg_error (GPG_ERR_EOF));
+
       err = _gpgme_wait_on_condition (ctx, &opd->key_cond, NULL);
       if (err)
 	return TRACE_ERR (err);
@@ -1242,6 +1529,18 @@ gpgme_op_keylist_next (gpgme_ctx_t ctx, gpgme_key_t *r_key)
   *r_key = queue_item->key;
   free (queue_item);
 
+  /* Stop the engine as soon as the last key has been returned.  */
+  if (opd->limit && opd->nkeys >= opd->limit && !opd->key_queue)
+    {
+      err = stop_keylist (ctx);
+      if (err)
+        {
+          gpgme_key_unref (*r_key);
+          *r_key = NULL;
+          return TRACE_ERR (err);
+        }
+    }
+
   TRACE_SUC ("key=%p (%s)", *r_key,
              ((*r_key)->subkeys && (*r_key)->subkeys->fpr) ?
              (*r_key)->subkeys->fpr : "invalid");
@@ -1249,19 +1548,178 @@ gpgme_op_keylist_next (gpgme_ctx_t ctx, gpgme_key_t *r_key)
 }
 
 
-/* Terminate a pending keylist operation within CTX.  */
+/* Terminate a pending keylist operation within CTX.  The engine is
+   stopped and keys not yet returned are released.  */
 gpgme_error_t
 gpgme_op_keylist_end (gpgme_ctx_t ctx)
 {
-  TRACE (DEBUG_CTX, "gpgme_op_keylist_end", ctx, "");
+  gpgme_error_t err;
+  void *hook;
+  op_data_t opd;
+
+  TRACE_BEG (DEBUG_CTX, "gpgme_op_keylist_end", ctx, "");
 
   if (!ctx)
-    return gpg_error (GPG_ERR_INV_VALUE);
+    return TRACE_ERR (gpg_error (GPG_ERR_INV_VALUE));
 
-  return 0;
+  err = _gpgme_op_data_lookup (ctx, OPDATA_KEYLIST, &hook, -1, NULL);
+  opd = hook;
+  if (err || !opd)
+    return TRACE_ERR (err);
+
+  err = stop_keylist (ctx);
+  release_key_queue (opd);
+  return TRACE_ERR (err);
 }
 
 
+/* Set the filter for key listings in CTX to a copy of FILTER or
+   remove the filter if FILTER is NULL.  */
+gpgme_error_t
+gpgme_set_keylist_filter (gpgme_ctx_t ctx, gpgme_keylist_filter_t filter)
+{
+  struct keylist_filter_s *kf = NULL;
+
+  TRACE_BEG (DEBUG_CTX, "gpgme_set_keylist_filter", ctx, "filter=%p", filter);
+
+  if (!ctx)
+    return TRACE_ERR (gpg_error (GPG_ERR_INV_VALUE));
+
+  if (filter)
+    {
+      kf = calloc (1, sizeof *kf);
+      if (!kf)
+        return TRACE_ERR (gpg_error_from_syserror ());
+      kf->filter = *filter;
+      kf->filter.uid_regex = NULL;
+      if (filter->uid_regex)
+        {
+#ifdef HAVE_REGEX_H
+          gpgme_error_t err;
+
+          kf->regex_string = strdup (filter->uid_regex);
+          if (!kf->regex_string)
+            {
+              err = gpg_error_from_syserror ();
+              free (kf);
+              return TRACE_ERR (err);
+            }
+          if (regcomp (&kf->regex, kf->regex_string,
+                       REG_EXTENDED | REG_ICASE | REG_NOSUB))
+            {
+              free (kf->regex_string);
+              free (kf);
+              return TRACE_ERR (gpg_error (GPG_ERR_INV_VALUE));
+            }
+          kf->filter.uid_regex = kf->regex_string;
+#else
+          free (kf);
+          return TRACE_ERR (gpg_error (GPG_ERR_NOT_SUPPORTED));
+#endif
+        }
+    }
+
+  _gpgme_keylist_filter_release (ctx->keylist_filter);
+  ctx->keylist_filter = kf;
+  return TRACE_ERR (0);
+}
+
+
+gpgme_error_t
+_gpgme_keylist_filter_copy (gpgme_ctx_t ctx, gpgme_ctx_t src)
+{
+  return gpgme_set_keylist_filter (ctx, (src->keylist_filter
+                                         ? &src->keylist_filter->filter
+                                         : NULL));
+}
+
+
+void
+_gpgme_keylist_filter_release (struct keylist_filter_s *filter)
+{
+  if (!filter)
+    return;
+#ifdef HAVE_REGEX_H
+  if (filter->regex_string)
+    regfree (&filter->regex);
+#endif
+  free (filter->regex_string);
+  free (filter);
+}
+
+
+/* Parse the signature records of UID of KEY which have been stored by
+   a key listing with the context flag "lazy-key-sigs".  On success the
+   stored records are released.  The caller must make sure that this
+   function is not called concurrently for the same key.  */
+gpgme_error_t
+_gpgme_keylist_parse_sigs (gpgme_key_t key, gpgme_user_id_t uid)
+{
+  gpgme_error_t err = 0;
+  char *field[NR_FIELDS];
+  int fields;
+  gpgme_key_sig_t keysig = NULL;
+  char *buffer, *line, *next;
+
+  /* The records are parsed from a copy so that they are retained if
+     parsing fails.  */
+  buffer = strdup (uid->_raw_sigs);
+  if (!buffer)
+    return gpg_error_from_syserror ();
+
+  for (line = buffer; !err && *line; line = next)
+    {
+      next = strchr (line, '\n');
+      if (next)
+        *(next++) = '\0';
+      else
+        next = line + strlen (line);
+
+      fields = 0;
+      while (line && fields < NR_FIELDS)
+        {
+          field[fields++] = line;
+          line = strchr (line, ':');
+          if (line)
+            *(line++) = '\0';
+        }
+
+      if (!strcmp (field[0], "spk"))
+        {
+          if (keysig)
+            err = parse_spk_record (keysig, field, fields);
+        }
+      else
+        err = parse_sig_record (key, uid, field, fields, &keysig);
+    }
+  free (buffer);
+
+  if (err)
+    {
+      while (uid->signatures)
+        {
+          keysig = uid->signatures->next;
+          while (uid->signatures->notations)
+            {
+              gpgme_sig_notation_t next_notation;
+
+              next_notation = uid->signatures->notations->next;
+              _gpgme_sig_notation_free (uid->signatures->notations);
+              uid->signatures->notations = next_notation;
+            }
+          free (uid->signatures);
+          uid->signatures = keysig;
+        }
+      uid->_last_keysig = NULL;
+      return err;
+    }
+
+  free (uid->_raw_sigs);
+  uid->_raw_sigs = NULL;
+  return 0;
+}
+
+
 /* Get the key with the fingerprint FPR from the crypto backend.  If
    SECRET is true, get the secret key.  */
 gpgme_error_t
@@ -32,6 +32,8 @@
 #include "context.h"
 #include "ops.h"
 #include "util.h"
+#include "sys-util.h"
+#include "priv-io.h"
 #include "debug.h"
 
 
@@ -92,7 +94,9 @@ _gpgme_op_reset (gpgme_ctx_t ctx, int type)
   LOCK (ctx->lock);
   ctx->canceled = 0;
   ctx->redraw_suggested = 0;
+  ctx->deadline = ctx->timeout? _gpgme_get_monotonic_ms () + ctx->timeout : 0;
   UNLOCK (ctx->lock);
+  _gpgme_progress_reset (ctx);
 
   if (ctx->engine && no_reset)
     reuse_engine = 1;
@@ -200,6 +204,21 @@ _gpgme_op_reset (gpgme_ctx_t ctx, int type)
   return err;
 }
 
+
+/* Return true if CTX has file descriptors registered with its
+   private event loop, i.e. the engine is still running an
+   operation.  */
+int
+_gpgme_op_is_pending (gpgme_ctx_t ctx)
+{
+  size_t i;
+
+  for (i = 0; i < ctx->fdt.size; i++)
+    if (ctx->fdt.fds[i].fd != -1)
+      return 1;
+  return 0;
+}
+
 
 /* Parse the INV_RECP or INV_SNDR status line in ARGS and return the
    result in KEY.  If KC_FPR (from the KEY_CONSIDERED status line) is
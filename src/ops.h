@@ -24,6 +24,7 @@
 
 #include "gpgme.h"
 #include "context.h"
+#include "util.h"
 
 
 /* From gpgme.c.  */
@@ -40,6 +41,9 @@ gpgme_error_t _gpgme_wait_one (gpgme_ctx_t ctx);
 gpgme_error_t _gpgme_wait_one_ext (gpgme_ctx_t ctx, gpgme_error_t *op_err);
 gpgme_error_t _gpgme_wait_on_condition (gpgme_ctx_t ctx, volatile int *cond,
 					gpgme_error_t *op_err);
+gpgme_error_t _gpgme_wait_on_any (gpgme_ctx_t ctx,
+                                  gpgme_ctx_t *ctxs, size_t nctxs,
+                                  size_t *r_idx, gpgme_error_t *r_err);
 
 
 /* From data.c.  */
@@ -57,6 +61,9 @@ gpgme_error_t _gpgme_op_data_lookup (gpgme_ctx_t ctx, ctx_op_data_id_t type,
 /* Prepare a new operation on CTX.  */
 gpgme_error_t _gpgme_op_reset (gpgme_ctx_t ctx, int synchronous);
 
+/* Return true if an operation on CTX is still pending.  */
+int _gpgme_op_is_pending (gpgme_ctx_t ctx);
+
 /* Parse the KEY_CONSIDERED status line.  */
 gpgme_error_t _gpgme_parse_key_considered (const char *args,
                                            char **r_fpr, unsigned int *r_flags);
@@ -79,6 +86,9 @@ gpgme_error_t _gpgme_parse_failure (char *args);
 
 /* From verify.c.  */
 gpgme_error_t _gpgme_op_verify_init_result (gpgme_ctx_t ctx);
+void _gpgme_verify_result_release (struct _gpgme_op_verify_result *result);
+gpgme_error_t _gpgme_verify_result_copy (struct _gpgme_op_verify_result *dst,
+                                         gpgme_verify_result_t src);
 gpgme_error_t _gpgme_verify_status_handler (void *priv,
 					    gpgme_status_code_t code,
 					    char *args);
@@ -136,6 +146,7 @@ gpgme_error_t _gpgme_passphrase_command_handler (void *opaque,
 gpgme_error_t _gpgme_progress_status_handler (void *priv,
 					      gpgme_status_code_t code,
 					      char *args);
+void _gpgme_progress_reset (gpgme_ctx_t ctx);
 
 
 /* From key.c.  */
@@ -144,7 +155,14 @@ gpgme_error_t _gpgme_key_add_subkey (gpgme_key_t key,
 				     gpgme_subkey_t *r_subkey);
 gpgme_error_t _gpgme_key_append_name (gpgme_key_t key,
                                       const char *src, int convert);
-gpgme_key_sig_t _gpgme_key_add_sig (gpgme_key_t key, char *src);
+gpgme_key_sig_t _gpgme_key_add_sig (gpgme_key_t key, gpgme_user_id_t uid,
+                                    char *src);
+
+/* Return a shared copy of the string STRING or NULL on error.  */
+char *_gpgme_key_intern (const char *string);
+
+/* Release a string returned by _gpgme_key_intern.  */
+void _gpgme_key_intern_release (char *string);
 
 
 
@@ -152,6 +170,15 @@ gpgme_key_sig_t _gpgme_key_add_sig (gpgme_key_t key, char *src);
 void _gpgme_op_keylist_event_cb (void *data, gpgme_event_io_t type,
 				 void *type_data);
 
+/* Set the keylist filter of CTX to that of SRC.  */
+gpgme_error_t _gpgme_keylist_filter_copy (gpgme_ctx_t ctx, gpgme_ctx_t src);
+
+/* Release the keylist filter FILTER.  */
+void _gpgme_keylist_filter_release (struct keylist_filter_s *filter);
+
+/* Parse the stored signature records of UID of KEY.  */
+gpgme_error_t _gpgme_keylist_parse_sigs (gpgme_key_t key, gpgme_user_id_t uid);
+
 
 /* From trust-item.c.  */
 
@@ -173,6 +200,24 @@ int _gpgme_compare_versions (const char *my_version,
 char *_gpgme_get_program_version (const char *const path);
 
 
+/* From verify-cache.c.  */
+struct verify_cache_key
+{
+  int valid;
+  uint64_t start;
+  unsigned char id[SHA256_DIGEST_LEN];
+  unsigned char stamp[SHA256_DIGEST_LEN];
+};
+
+gpgme_error_t _gpgme_verify_cache_make_key (gpgme_ctx_t ctx, gpgme_data_t sig,
+                                            gpgme_data_t signed_text,
+                                            struct verify_cache_key *ckey);
+int _gpgme_verify_cache_get (const struct verify_cache_key *ckey,
+                             struct _gpgme_op_verify_result *result);
+void _gpgme_verify_cache_put (const struct verify_cache_key *ckey,
+                              unsigned int ttl, gpgme_verify_result_t result);
+
+
 /* From sig-notation.c.  */
 
 /* Create a new, empty signature notation data object.  */
@@ -693,6 +693,16 @@ _gpgme_io_spawn (const char *path, char *const argv[], unsigned int flags,
    nothing to select, > 0 = number of signaled fds.  */
 int
 _gpgme_io_select (struct io_select_fd_s *fds, size_t nfds, int nonblock)
+{
+  /* Use a 1s timeout.  */
+  return _gpgme_io_select_timeout (fds, nfds, nonblock? 0 : 1000);
+}
+
+
+/* Same as _gpgme_io_select but wait at most TIMEOUT milliseconds.  */
+int
+_gpgme_io_select_timeout (struct io_select_fd_s *fds, size_t nfds,
+                          unsigned int timeout_ms)
 {
   fd_set readfds;
   fd_set writefds;
@@ -701,17 +711,16 @@ _gpgme_io_select (struct io_select_fd_s *fds, size_t nfds, int nonblock)
   int max_fd;
   int n;
   int count;
-  /* Use a 1s timeout.  */
-  struct timeval timeout = { 1, 0 };
+  struct timeval timeout;
   void *dbg_help = NULL;
   TRACE_BEG  (DEBUG_SYSIO, "_gpgme_io_select", NULL,
-	      "nfds=%zu, nonblock=%u", nfds, nonblock);
+	      "nfds=%zu, timeout=%u", nfds, timeout_ms);
 
   FD_ZERO (&readfds);
   FD_ZERO (&writefds);
   max_fd = 0;
-  if (nonblock)
-    timeout.tv_sec = 0;
+  timeout.tv_sec = timeout_ms / 1000;
+  timeout.tv_usec = (timeout_ms % 1000) * 1000;
 
   TRACE_SEQ (dbg_help, "select on [ ");
 
@@ -26,6 +26,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
+#include <sys/time.h>
 
 #include "util.h"
 #include "sys-util.h"
@@ -193,3 +195,32 @@ _gpgme_access (const char *path, int mode)
 {
   return access (path, mode);
 }
+
+
+/* Return a time stamp in microseconds which is not affected by
+ * changes of the system time.  Only differences of the returned
+ * values are meaningful.  */
+uint64_t
+_gpgme_get_monotonic_us (void)
+{
+#ifdef CLOCK_MONOTONIC
+  struct timespec ts;
+
+  if (!clock_gettime (CLOCK_MONOTONIC, &ts))
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+  {
+    struct timeval tv;
+
+    gettimeofday (&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+  }
+}
+
+
+/* Same as _gpgme_get_monotonic_us but in milliseconds.  */
+uint64_t
+_gpgme_get_monotonic_ms (void)
+{
+  return _gpgme_get_monotonic_us () / 1000;
+}
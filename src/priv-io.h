@@ -93,6 +93,8 @@ int _gpgme_io_spawn (const char *path, char *const argv[], unsigned int flags,
 		     void *atforkvalue, pid_t *r_pid);
 
 int _gpgme_io_select (struct io_select_fd_s *fds, size_t nfds, int nonblock);
+int _gpgme_io_select_timeout (struct io_select_fd_s *fds, size_t nfds,
+                              unsigned int timeout_ms);
 
 /* Write the printable version of FD to the buffer BUF of length
    BUFLEN.  The printable version is the representation on the command
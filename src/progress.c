@@ -29,6 +29,57 @@
 #include "util.h"
 #include "context.h"
 #include "debug.h"
+#include "ops.h"
+#include "sys-util.h"
+
+
+/* Forget the progress events of the previous operation of CTX.  */
+void
+_gpgme_progress_reset (gpgme_ctx_t ctx)
+{
+  if (ctx->progress_what)
+    *ctx->progress_what = 0;
+  ctx->progress_pending = 0;
+}
+
+
+/* Pass the dropped progress event of CTX to the callback.  */
+static void
+flush_pending (gpgme_ctx_t ctx)
+{
+  if (!ctx->progress_pending)
+    return;
+  ctx->progress_pending = 0;
+  ctx->progress_current = ctx->progress_pending_current;
+  ctx->progress_time = _gpgme_get_monotonic_ms ();
+  ctx->progress_cb (ctx->progress_cb_value, ctx->progress_what,
+                    ctx->progress_pending_type,
+                    ctx->progress_pending_current,
+                    ctx->progress_pending_total);
+}
+
+
+/* Return true if the progress event for the last item of CTX with the
+ * values CURRENT and TOTAL shall not be passed to the progress
+ * callback because of the progress policy set by the context flags
+ * "progress-interval" and "progress-delta".  The first event of an
+ * item, the final event and an event whose current value went back
+ * are always passed.  The delta does not apply to events without a
+ * current value.  */
+static int
+progress_suppressed (gpgme_ctx_t ctx, int current, int total, uint64_t now)
+{
+  if ((total && current == total) || current < ctx->progress_current)
+    return 0;
+  if (ctx->progress_interval
+      && now - ctx->progress_time < ctx->progress_interval)
+    return 1;
+  if (ctx->progress_delta && current
+      && (unsigned int)(current - ctx->progress_current)
+         < ctx->progress_delta)
+    return 1;
+  return 0;
+}
 
 
 /* The status handler for progress status lines which also monitors
@@ -38,11 +89,13 @@ _gpgme_progress_status_handler (void *priv, gpgme_status_code_t code,
 				char *args)
 {
   gpgme_ctx_t ctx = (gpgme_ctx_t) priv;
-  char *p;
-  char *args_cpy;
+  const char *p;
+  size_t whatlen;
   int type = 0;
   int current = 0;
   int total = 0;
+  int new_item;
+  uint64_t now = 0;
 
   if (code == GPGME_STATUS_PINENTRY_LAUNCHED)
     {
@@ -50,41 +103,72 @@ _gpgme_progress_status_handler (void *priv, gpgme_status_code_t code,
       return 0;
     }
 
+  if (code == GPGME_STATUS_EOF && ctx->progress_cb)
+    {
+      /* The last value of an item is never dropped.  */
+      flush_pending (ctx);
+      return 0;
+    }
+
   if (code != GPGME_STATUS_PROGRESS || !*args || !ctx->progress_cb)
     return 0;
 
-  args_cpy = strdup (args);
-  if (!args_cpy)
-    return gpg_error_from_syserror ();
-
-  p = strchr (args_cpy, ' ');
-  if (p)
+  /* The fields are parsed in place; the item is copied only if it
+   * differs from the item of the last event.  */
+  whatlen = strcspn (args, " ");
+  p = args + whatlen;
+  if (*p && *++p)
     {
-      *p++ = 0;
-      if (*p)
+      type = *(const unsigned char *)p;
+      p = strchr (p+1, ' ');
+      if (p && *++p)
 	{
-	  type = *(unsigned char *)p;
+	  current = atoi (p);
 	  p = strchr (p+1, ' ');
 	  if (p)
-	    {
-	      *p++ = 0;
-	      if (*p)
-		{
-		  current = atoi (p);
-		  p = strchr (p+1, ' ');
-		  if (p)
-		    {
-		      *p++ = 0;
-		      total = atoi (p);
-		    }
-		}
-	    }
+	    total = atoi (p+1);
 	}
     }
 
-  if (type != 'X')
-    ctx->progress_cb (ctx->progress_cb_value, args_cpy, type, current, total);
+  if (type == 'X')
+    return 0;
+
+  new_item = (!ctx->progress_what || !*ctx->progress_what
+              || strncmp (ctx->progress_what, args, whatlen)
+              || ctx->progress_what[whatlen]);
+  if (ctx->progress_interval || ctx->progress_delta)
+    {
+      now = _gpgme_get_monotonic_ms ();
+      if (!new_item && progress_suppressed (ctx, current, total, now))
+        {
+          ctx->progress_pending = 1;
+          ctx->progress_pending_type = type;
+          ctx->progress_pending_current = current;
+          ctx->progress_pending_total = total;
+          return 0;
+        }
+    }
+
+  if (new_item)
+    {
+      flush_pending (ctx);
+      if (ctx->progress_what_size < whatlen + 1)
+        {
+          char *what = realloc (ctx->progress_what, whatlen + 1);
+
+          if (!what)
+            return gpg_error_from_syserror ();
+          ctx->progress_what = what;
+          ctx->progress_what_size = whatlen + 1;
+        }
+      memcpy (ctx->progress_what, args, whatlen);
+      ctx->progress_what[whatlen] = 0;
+    }
 
-  free (args_cpy);
+  ctx->progress_pending = 0;
+  ctx->progress_current = current;
+  ctx->progress_time = now;
+  ctx->progress_cb (ctx->progress_cb_value, ctx->progress_what,
+                    type, current, total);
   return 0;
 }
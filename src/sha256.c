@@ -0,0 +1,162 @@
+/* sha256.c - Simple SHA-256 implementation.
+ * Copyright (C) 2021 g10 Code GmbH
+ *
+ * This file is part of GPGME.
+ *
+ * GPGME is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * GPGME is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <https://gnu.org/licenses/>.
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* This is a straightforward implementation of SHA-256 as specified
+ * in FIPS 180-4.  It is only used to compute lookup keys for internal
+ * caches; GPGME does not do any cryptography on its own.  */
+
+#include <config.h>
+#include <string.h>
+
+#include "util.h"
+
+
+static const uint32_t k256[64] =
+  {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+  };
+
+#define ROR(x,n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+
+/* Process the 64 byte block at DATA.  */
+static void
+transform (struct sha256_state *state, const unsigned char *data)
+{
+  uint32_t w[64];
+  uint32_t a, b, c, d, e, f, g, h, t1, t2;
+  int i;
+
+  for (i = 0; i < 16; i++, data += 4)
+    w[i] = (((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16)
+            | ((uint32_t)data[2] << 8) | (uint32_t)data[3]);
+  for (; i < 64; i++)
+    w[i] = (w[i-16]
+            + (ROR (w[i-15], 7) ^ ROR (w[i-15], 18) ^ (w[i-15] >> 3))
+            + w[i-7]
+            + (ROR (w[i-2], 17) ^ ROR (w[i-2], 19) ^ (w[i-2] >> 10)));
+
+  a = state->h[0]; b = state->h[1]; c = state->h[2]; d = state->h[3];
+  e = state->h[4]; f = state->h[5]; g = state->h[6]; h = state->h[7];
+
+  for (i = 0; i < 64; i++)
+    {
+      t1 = (h + (ROR (e, 6) ^ ROR (e, 11) ^ ROR (e, 25))
+            + ((e & f) ^ (~e & g)) + k256[i] + w[i]);
+      t2 = ((ROR (a, 2) ^ ROR (a, 13) ^ ROR (a, 22))
+            + ((a & b) ^ (a & c) ^ (b & c)));
+      h = g; g = f; f = e; e = d + t1;
+      d = c; c = b; b = a; a = t1 + t2;
+    }
+
+  state->h[0] += a; state->h[1] += b; state->h[2] += c; state->h[3] += d;
+  state->h[4] += e; state->h[5] += f; state->h[6] += g; state->h[7] += h;
+}
+
+
+void
+_gpgme_sha256_init (struct sha256_state *state)
+{
+  state->h[0] = 0x6a09e667;
+  state->h[1] = 0xbb67ae85;
+  state->h[2] = 0x3c6ef372;
+  state->h[3] = 0xa54ff53a;
+  state->h[4] = 0x510e527f;
+  state->h[5] = 0x9b05688c;
+  state->h[6] = 0x1f83d9ab;
+  state->h[7] = 0x5be0cd19;
+  state->nbytes = 0;
+  state->count = 0;
+}
+
+
+/* Hash LENGTH bytes of BUFFER.  */
+void
+_gpgme_sha256_write (struct sha256_state *state,
+                     const void *buffer, size_t length)
+{
+  const unsigned char *p = buffer;
+  size_t n;
+
+  state->nbytes += length;
+  if (state->count)
+    {
+      n = 64 - state->count;
+      if (n > length)
+        n = length;
+      memcpy (state->buf + state->count, p, n);
+      state->count += n;
+      p += n;
+      length -= n;
+      if (state->count < 64)
+        return;
+      transform (state, state->buf);
+      state->count = 0;
+    }
+  for (; length >= 64; p += 64, length -= 64)
+    transform (state, p);
+  memcpy (state->buf, p, length);
+  state->count = length;
+}
+
+
+/* Finish the computation and store the digest at DIGEST.  */
+void
+_gpgme_sha256_final (struct sha256_state *state,
+                     unsigned char digest[SHA256_DIGEST_LEN])
+{
+  uint64_t nbits = state->nbytes * 8;
+  int i;
+
+  state->buf[state->count++] = 0x80;
+  if (state->count > 56)
+    {
+      memset (state->buf + state->count, 0, 64 - state->count);
+      transform (state, state->buf);
+      state->count = 0;
+    }
+  memset (state->buf + state->count, 0, 56 - state->count);
+  for (i = 0; i < 8; i++)
+    state->buf[56 + i] = nbits >> (56 - 8 * i);
+  transform (state, state->buf);
+
+  for (i = 0; i < 8; i++)
+    {
+      digest[4*i]   = state->h[i] >> 24;
+      digest[4*i+1] = state->h[i] >> 16;
+      digest[4*i+2] = state->h[i] >> 8;
+      digest[4*i+3] = state->h[i];
+    }
+}
@@ -20,6 +20,8 @@
 #ifndef SYS_UTIL_H
 #define SYS_UTIL_H
 
+#include <stdint.h>
+
 /*-- {posix,w32}-util.c --*/
 int _gpgme_set_default_gpg_name (const char *name);
 int _gpgme_set_default_gpgconf_name (const char *name);
@@ -30,6 +32,9 @@ char *_gpgme_get_gpgconf_path (void);
 
 int _gpgme_access (const char *path_utf8, int mode);
 
+uint64_t _gpgme_get_monotonic_ms (void);
+uint64_t _gpgme_get_monotonic_us (void);
+
 #ifdef HAVE_W32_SYSTEM
 const char *_gpgme_get_inst_dir (void);
 void _gpgme_w32_cancel_synchronous_io (HANDLE thread);
@@ -35,6 +35,7 @@
 #ifdef HAVE_UNISTD_H
 # include <unistd.h>
 #endif
+#include <stdint.h>
 
 #include "gpgme.h"
 
@@ -177,6 +178,25 @@ gpg_error_t _gpgme_b64dec_proc (struct b64state *state,
 gpg_error_t _gpgme_b64dec_finish (struct b64state *state);
 
 
+/*-- sha256.c --*/
+
+#define SHA256_DIGEST_LEN 32
+
+struct sha256_state
+{
+  uint32_t h[8];
+  uint64_t nbytes;
+  unsigned char buf[64];
+  size_t count;
+};
+
+void _gpgme_sha256_init (struct sha256_state *state);
+void _gpgme_sha256_write (struct sha256_state *state,
+                          const void *buffer, size_t length);
+void _gpgme_sha256_final (struct sha256_state *state,
+                          unsigned char digest[SHA256_DIGEST_LEN]);
+
+
 
 /* Retrieve the environment variable NAME and return a copy of it in a
    malloc()'ed buffer in *VALUE.  If the environment variable is not
@@ -0,0 +1,383 @@
+/* verify-cache.c - Cache for the results of verify operations.
+ * Copyright (C) 2021 g10 Code GmbH
+ *
+ * This file is part of GPGME.
+ *
+ * GPGME is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * GPGME is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <https://gnu.org/licenses/>.
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* The results of detached signature verifications are cached if the
+ * context flag "verify-cache" is set.  The lookup key is a SHA-256
+ * digest over the signature, the signed data and the context
+ * settings affecting the result.  An entry is only used as long as
+ * its time to live has not expired and the keyring and trust files
+ * in the engine's home directory have not been modified.  */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "util.h"
+#include "context.h"
+#include "ops.h"
+#include "sema.h"
+#include "sys-util.h"
+#include "debug.h"
+
+
+/* The maximum number of entries in the cache.  If the cache is full
+ * the oldest entry is removed.  */
+#define MAX_ENTRIES 4096
+
+/* The number of hash buckets; must be a power of 2.  */
+#define NBUCKETS 1024
+
+
+struct cache_entry
+{
+  /* The hash chain.  */
+  struct cache_entry *hnext;
+
+  /* The list of all entries in the order of insertion.  */
+  struct cache_entry *prev;
+  struct cache_entry *next;
+
+  unsigned char id[SHA256_DIGEST_LEN];
+  unsigned char stamp[SHA256_DIGEST_LEN];
+
+  /* The time of expiration in terms of _gpgme_get_monotonic_ms.  */
+  uint64_t expires;
+
+  struct _gpgme_op_verify_result result;
+};
+
+
+DEFINE_STATIC_LOCK (cache_lock);
+
+static struct cache_entry *buckets[NBUCKETS];
+static struct cache_entry *oldest;
+static struct cache_entry *newest;
+static struct _gpgme_verify_cache_stats stats;
+
+
+/* The files which are checked for modifications.  */
+static const char *const openpgp_files[] =
+  { "pubring.kbx", "pubring.gpg", "trustdb.gpg", "gpg.conf", NULL };
+static const char *const cms_files[] =
+  { "pubring.kbx", "trustlist.txt", "gpgsm.conf", NULL };
+
+
+
+/* Hash a string including the terminating nul so that the
+ * concatenation of several strings is unambiguous.  */
+static void
+hash_string (struct sha256_state *state, const char *string)
+{
+  if (!string)
+    string = "";
+  _gpgme_sha256_write (state, string, strlen (string) + 1);
+}
+
+
+/* Store the SHA-256 digest of the data DH from its current position
+ * to the end at DIGEST and seek back to the current position.  Store
+ * true at R_SEEKABLE if that is possible.  */
+static gpgme_error_t
+hash_data (gpgme_data_t dh, unsigned char *digest, int *r_seekable)
+{
+  struct sha256_state state;
+  char buffer[4096];
+  gpgme_off_t pos;
+  gpgme_ssize_t n;
+  gpgme_error_t err = 0;
+
+  *r_seekable = 0;
+  pos = gpgme_data_seek (dh, 0, SEEK_CUR);
+  if (pos < 0)
+    return 0;
+
+  _gpgme_sha256_init (&state);
+  while ((n = gpgme_data_read (dh, buffer, sizeof buffer)) > 0)
+    _gpgme_sha256_write (&state, buffer, n);
+  if (n < 0)
+    err = gpg_error_from_syserror ();
+  _gpgme_sha256_final (&state, digest);
+
+  /* The data has been consumed; failing to seek back is an error.  */
+  if (gpgme_data_seek (dh, pos, SEEK_SET) != pos && !err)
+    err = gpg_error_from_syserror ();
+  if (!err)
+    *r_seekable = 1;
+  return err;
+}
+
+
+/* Hash the state of the files in the home directory of the engine
+ * used by CTX into STATE.  */
+static void
+hash_keyring_state (struct sha256_state *state, gpgme_ctx_t ctx,
+                    const char *homedir)
+{
+  const char *const *names;
+  struct stat st;
+  char *fname;
+  unsigned long long values[3];
+
+  names = ctx->protocol == GPGME_PROTOCOL_CMS? cms_files : openpgp_files;
+  for (; *names; names++)
+    {
+      memset (values, 0, sizeof values);
+      fname = _gpgme_strconcat (homedir, "/", *names, NULL);
+      if (fname && !stat (fname, &st))
+        {
+          values[0] = st.st_ino;
+          values[1] = st.st_size;
+          values[2] = st.st_mtime;
+        }
+      free (fname);
+      _gpgme_sha256_write (state, values, sizeof values);
+    }
+}
+
+
+/* Prepare the cache key CKEY for the verification of SIG and
+ * SIGNED_TEXT in CTX.  If the data objects are not seekable
+ * CKEY->VALID is set to false and the verification can't be cached.
+ * Note that the data is read in full and the position is reset.  */
+gpgme_error_t
+_gpgme_verify_cache_make_key (gpgme_ctx_t ctx, gpgme_data_t sig,
+                              gpgme_data_t signed_text,
+                              struct verify_cache_key *ckey)
+{
+  gpgme_error_t err;
+  struct sha256_state state;
+  unsigned char digest[SHA256_DIGEST_LEN];
+  gpgme_engine_info_t info;
+  const char *homedir = NULL;
+  const char *file_name = NULL;
+  unsigned char proto, flags;
+  int seekable;
+
+  ckey->valid = 0;
+  ckey->start = _gpgme_get_monotonic_us ();
+
+  if (ctx->protocol != GPGME_PROTOCOL_OpenPGP
+      && ctx->protocol != GPGME_PROTOCOL_CMS)
+    return 0;
+
+  for (info = ctx->engine_info; info; info = info->next)
+    if (info->protocol == ctx->protocol)
+      {
+        homedir = info->home_dir;
+        file_name = info->file_name;
+        break;
+      }
+  if (!homedir)
+    homedir = gpgme_get_dirinfo ("homedir");
+  if (!homedir)
+    return 0;
+
+  _gpgme_sha256_init (&state);
+  proto = ctx->protocol;
+  _gpgme_sha256_write (&state, &proto, 1);
+  hash_string (&state, homedir);
+  hash_string (&state, file_name);
+  hash_string (&state, ctx->trust_model);
+  hash_string (&state, ctx->sender);
+  /* The flags which change the result.  */
+  flags = ((ctx->auto_key_retrieve << 0)
+           | (ctx->auto_key_import << 1)
+           | (ctx->offline << 2)
+           | (ctx->raw_description << 3)
+           | (ctx->full_status << 4));
+  _gpgme_sha256_write (&state, &flags, 1);
+  err = hash_data (sig, digest, &seekable);
+  if (err || !seekable)
+    return err;
+  _gpgme_sha256_write (&state, digest, sizeof digest);
+  err = hash_data (signed_text, digest, &seekable);
+  if (err || !seekable)
+    return err;
+  _gpgme_sha256_write (&state, digest, sizeof digest);
+  _gpgme_sha256_final (&state, ckey->id);
+
+  _gpgme_sha256_init (&state);
+  hash_keyring_state (&state, ctx, homedir);
+  _gpgme_sha256_final (&state, ckey->stamp);
+
+  ckey->valid = 1;
+  return 0;
+}
+
+
+/* Return the hash chain for ID.  */
+static struct cache_entry **
+bucket_for (const unsigned char *id)
+{
+  return &buckets[(id[0] | (id[1] << 8)) & (NBUCKETS - 1)];
+}
+
+
+/* Unlink ENTRY from the cache and release it.  The caller must hold
+ * the lock.  */
+static void
+remove_entry (struct cache_entry *entry)
+{
+  struct cache_entry **ep;
+
+  for (ep = bucket_for (entry->id); *ep != entry; ep = &(*ep)->hnext)
+    ;
+  *ep = entry->hnext;
+
+  if (entry->prev)
+    entry->prev->next = entry->next;
+  else
+    oldest = entry->next;
+  if (entry->next)
+    entry->next->prev = entry->prev;
+  else
+    newest = entry->prev;
+
+  _gpgme_verify_result_release (&entry->result);
+  free (entry);
+  stats.entries--;
+}
+
+
+/* Look up the result for CKEY.  On a hit a copy of the result is
+ * stored at RESULT and true is returned.  */
+int
+_gpgme_verify_cache_get (const struct verify_cache_key *ckey,
+                         struct _gpgme_op_verify_result *result)
+{
+  struct cache_entry *entry;
+  int hit = 0;
+
+  if (!ckey->valid)
+    return 0;
+
+  LOCK (cache_lock);
+  for (entry = *bucket_for (ckey->id); entry; entry = entry->hnext)
+    if (!memcmp (entry->id, ckey->id, SHA256_DIGEST_LEN))
+      break;
+  if (entry && (entry->expires <= _gpgme_get_monotonic_ms ()
+                || memcmp (entry->stamp, ckey->stamp, SHA256_DIGEST_LEN)))
+    {
+      remove_entry (entry);
+      stats.invalidated++;
+      entry = NULL;
+    }
+  if (entry && !_gpgme_verify_result_copy (result, &entry->result))
+    hit = 1;
+
+  if (hit)
+    stats.hits++;
+  else
+    stats.misses++;
+  stats.lookup_usec += _gpgme_get_monotonic_us () - ckey->start;
+  UNLOCK (cache_lock);
+
+  TRACE (DEBUG_CTX, "_gpgme_verify_cache_get", NULL, "hit=%d", hit);
+  return hit;
+}
+
+
+/* Store a copy of RESULT for CKEY in the cache.  The entry expires
+ * after TTL seconds.  Errors are ignored because the cache is only an
+ * optimization.  */
+void
+_gpgme_verify_cache_put (const struct verify_cache_key *ckey,
+                         unsigned int ttl, gpgme_verify_result_t result)
+{
+  struct cache_entry *entry, **bucket;
+
+  if (!ckey->valid || !ttl || !result)
+    return;
+
+  entry = calloc (1, sizeof *entry);
+  if (!entry)
+    return;
+  if (_gpgme_verify_result_copy (&entry->result, result))
+    {
+      free (entry);
+      return;
+    }
+  memcpy (entry->id, ckey->id, SHA256_DIGEST_LEN);
+  memcpy (entry->stamp, ckey->stamp, SHA256_DIGEST_LEN);
+  entry->expires = _gpgme_get_monotonic_ms () + (uint64_t)ttl * 1000;
+
+  LOCK (cache_lock);
+  bucket = bucket_for (ckey->id);
+
+  /* Replace an existing entry for the same key; this happens if two
+   * threads verified the same data at the same time.  */
+  {
+    struct cache_entry *e;
+
+    for (e = *bucket; e; e = e->hnext)
+      if (!memcmp (e->id, ckey->id, SHA256_DIGEST_LEN))
+        {
+          remove_entry (e);
+          break;
+        }
+  }
+  if (stats.entries >= MAX_ENTRIES)
+    remove_entry (oldest);
+
+  entry->hnext = *bucket;
+  *bucket = entry;
+  entry->prev = newest;
+  if (newest)
+    newest->next = entry;
+  else
+    oldest = entry;
+  newest = entry;
+  stats.entries++;
+  UNLOCK (cache_lock);
+}
+
+
+
+/* Store the counters of the verify cache at R_STATS.  */
+gpgme_error_t
+gpgme_verify_cache_get_stats (gpgme_verify_cache_stats_t r_stats)
+{
+  if (!r_stats)
+    return gpg_error (GPG_ERR_INV_VALUE);
+
+  LOCK (cache_lock);
+  *r_stats = stats;
+  UNLOCK (cache_lock);
+  return 0;
+}
+
+
+/* Remove all entries from the verify cache.  The counters are not
+ * reset.  */
+void
+gpgme_verify_cache_clear (void)
+{
+  TRACE (DEBUG_CTX, "gpgme_verify_cache_clear", NULL, "");
+
+  LOCK (cache_lock);
+  while (oldest)
+    remove_entry (oldest);
+  UNLOCK (cache_lock);
+}
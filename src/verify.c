@@ -50,11 +50,12 @@ typedef struct
 } *op_data_t;
 
 
-static void
-release_op_data (void *hook)
+/* Release the signatures and the file name of RESULT but not RESULT
+ * itself.  */
+void
+_gpgme_verify_result_release (struct _gpgme_op_verify_result *result)
 {
-  op_data_t opd = (op_data_t) hook;
-  gpgme_signature_t sig = opd->result.signatures;
+  gpgme_signature_t sig = result->signatures;
 
   while (sig)
     {
@@ -78,9 +79,108 @@ release_op_data (void *hook)
       free (sig);
       sig = next;
     }
+  result->signatures = NULL;
+
+  if (result->file_name)
+    free (result->file_name);
+  result->file_name = NULL;
+}
+
+
+static void
+release_op_data (void *hook)
+{
+  op_data_t opd = (op_data_t) hook;
+
+  _gpgme_verify_result_release (&opd->result);
+}
+
+
+/* Return a copy of the string STRING of length LEN or NULL if STRING
+ * is NULL.  Sets ERRNO and stores true at R_ERR on error.  */
+static char *
+copy_mem (const char *string, size_t len, int *r_err)
+{
+  char *p;
+
+  if (!string)
+    return NULL;
+  p = malloc (len + 1);
+  if (!p)
+    {
+      *r_err = 1;
+      return NULL;
+    }
+  memcpy (p, string, len);
+  p[len] = 0;
+  return p;
+}
+
+
+/* Store a deep copy of SRC at DST.  The signature keys are shared.  */
+gpgme_error_t
+_gpgme_verify_result_copy (struct _gpgme_op_verify_result *dst,
+                           gpgme_verify_result_t src)
+{
+  gpgme_signature_t sig, *sigp;
+  gpgme_sig_notation_t nota, *notap;
+  int failed = 0;
+
+  *dst = *src;
+  dst->signatures = NULL;
+  dst->file_name = NULL;
+
+  sigp = &dst->signatures;
+  for (sig = src->signatures; sig && !failed; sig = sig->next)
+    {
+      *sigp = malloc (sizeof **sigp);
+      if (!*sigp)
+        {
+          failed = 1;
+          break;
+        }
+      **sigp = *sig;
+      (*sigp)->next = NULL;
+      (*sigp)->notations = NULL;
+      (*sigp)->fpr = copy_mem (sig->fpr, sig->fpr? strlen (sig->fpr) : 0,
+                               &failed);
+      (*sigp)->pka_address = copy_mem (sig->pka_address,
+                                       (sig->pka_address
+                                        ? strlen (sig->pka_address) : 0),
+                                       &failed);
+      if (sig->key)
+        gpgme_key_ref (sig->key);
+
+      notap = &(*sigp)->notations;
+      for (nota = sig->notations; nota && !failed; nota = nota->next)
+        {
+          *notap = calloc (1, sizeof **notap);
+          if (!*notap)
+            {
+              failed = 1;
+              break;
+            }
+          **notap = *nota;
+          (*notap)->next = NULL;
+          (*notap)->name = copy_mem (nota->name, nota->name_len, &failed);
+          (*notap)->value = copy_mem (nota->value, nota->value_len, &failed);
+          notap = &(*notap)->next;
+        }
+
+      sigp = &(*sigp)->next;
+    }
 
-  if (opd->result.file_name)
-    free (opd->result.file_name);
+  if (!failed)
+    dst->file_name = copy_mem (src->file_name,
+                               src->file_name? strlen (src->file_name) : 0,
+                               &failed);
+  if (failed)
+    {
+      gpgme_error_t err = gpg_error_from_syserror ();
+      _gpgme_verify_result_release (dst);
+      return err;
+    }
+  return 0;
 }
 
 
@@ -1158,6 +1258,47 @@ verify_start (gpgme_ctx_t ctx, int synchronous, gpgme_data_t sig,
 }
 
 
+/* Look up the verification of SIG and SIGNED_TEXT in the verify
+ * cache if enabled for CTX.  On a hit the cached result is made the
+ * result of CTX and true is stored at R_HIT.  On a miss CKEY is
+ * prepared for storing the result.  */
+static gpgme_error_t
+verify_cache_lookup (gpgme_ctx_t ctx, gpgme_data_t sig,
+                     gpgme_data_t signed_text, gpgme_data_t plaintext,
+                     struct verify_cache_key *ckey, int *r_hit)
+{
+  gpgme_error_t err;
+  void *hook;
+  op_data_t opd;
+  struct _gpgme_op_verify_result result;
+
+  *r_hit = 0;
+  ckey->valid = 0;
+
+  /* Only detached signatures are cached.  */
+  if (!ctx->verify_cache_ttl || !sig || !signed_text || plaintext)
+    return 0;
+
+  err = _gpgme_verify_cache_make_key (ctx, sig, signed_text, ckey);
+  if (err || !_gpgme_verify_cache_get (ckey, &result))
+    return err;
+
+  _gpgme_release_result (ctx);
+  err = _gpgme_op_verify_init_result (ctx);
+  if (!err)
+    err = _gpgme_op_data_lookup (ctx, OPDATA_VERIFY, &hook, -1, NULL);
+  if (err)
+    {
+      _gpgme_verify_result_release (&result);
+      return err;
+    }
+  opd = hook;
+  opd->result = result;
+  *r_hit = 1;
+  return 0;
+}
+
+
 /* Decrypt ciphertext CIPHER and make a signature verification within
    CTX and store the resulting plaintext in PLAIN.  */
 gpgme_error_t
@@ -1184,6 +1325,8 @@ gpgme_op_verify (gpgme_ctx_t ctx, gpgme_data_t sig, gpgme_data_t signed_text,
 		 gpgme_data_t plaintext)
 {
   gpgme_error_t err;
+  struct verify_cache_key ckey;
+  int hit;
 
   TRACE_BEG  (DEBUG_CTX, "gpgme_op_verify", ctx,
 	      "sig=%p, signed_text=%p, plaintext=%p",
@@ -1192,13 +1335,146 @@ gpgme_op_verify (gpgme_ctx_t ctx, gpgme_data_t sig, gpgme_data_t signed_text,
   if (!ctx)
     return TRACE_ERR (gpg_error (GPG_ERR_INV_VALUE));
 
+  err = verify_cache_lookup (ctx, sig, signed_text, plaintext, &ckey, &hit);
+  if (err || hit)
+    return TRACE_ERR (err);
+
   err = verify_start (ctx, 1, sig, signed_text, plaintext);
   if (!err)
     err = _gpgme_wait_one (ctx);
+  if (!err)
+    _gpgme_verify_cache_put (&ckey, ctx->verify_cache_ttl,
+                             gpgme_op_verify_result (ctx));
   return TRACE_ERR (err);
 }
 
 
+
+/* The default number of engines used by gpgme_op_verify_batch.  */
+#define VERIFY_BATCH_DEFAULT_WORKERS 4
+
+/* Verify the NITEMS signatures described by ITEMS.  Up to NWORKERS
+ * engines are run concurrently; 0 selects a default.  The engines are
+ * configured like CTX.  The error code and the result of each
+ * verification are stored in the item.  The function itself only
+ * returns an error if the batch could not be processed; in this case
+ * items not yet processed have their ERR set to GPG_ERR_CANCELED.  */
+gpgme_error_t
+gpgme_op_verify_batch (gpgme_ctx_t ctx, gpgme_verify_batch_item_t items,
+                       size_t nitems, unsigned int nworkers)
+{
+  gpgme_error_t err = 0;
+  gpgme_ctx_pool_t pool = NULL;
+  gpgme_ctx_t *workers = NULL;
+  size_t *assigned = NULL;
+  struct verify_cache_key *ckeys = NULL;
+  int hit;
+  size_t next, done, running, k;
+  gpgme_error_t op_err;
+
+  TRACE_BEG  (DEBUG_CTX, "gpgme_op_verify_batch", ctx,
+	      "items=%p, nitems=%zu, nworkers=%u", items, nitems, nworkers);
+
+  if (!ctx || (nitems && !items))
+    return TRACE_ERR (gpg_error (GPG_ERR_INV_VALUE));
+
+  for (k = 0; k < nitems; k++)
+    {
+      items[k].err = gpg_error (GPG_ERR_CANCELED);
+      items[k].result = NULL;
+    }
+  if (!nitems)
+    return TRACE_ERR (0);
+
+  if (!nworkers)
+    nworkers = VERIFY_BATCH_DEFAULT_WORKERS;
+  if (nworkers > nitems)
+    nworkers = nitems;
+
+  workers = calloc (nworkers, sizeof *workers);
+  assigned = calloc (nworkers, sizeof *assigned);
+  ckeys = calloc (nworkers, sizeof *ckeys);
+  if (!workers || !assigned || !ckeys)
+    {
+      err = gpg_error_from_syserror ();
+      goto leave;
+    }
+  err = gpgme_ctx_pool_new (&pool, ctx, nworkers);
+  if (err)
+    goto leave;
+
+  next = done = running = 0;
+  while (done < nitems)
+    {
+      /* Start an operation on each idle worker.  */
+      for (k = 0; k < nworkers && next < nitems; k++)
+        {
+          if (workers[k])
+            continue;
+          err = gpgme_ctx_pool_acquire (pool, &workers[k]);
+          if (err)
+            goto leave;
+          assigned[k] = next++;
+          err = verify_cache_lookup (workers[k], items[assigned[k]].sig,
+                                     items[assigned[k]].signed_text,
+                                     items[assigned[k]].plaintext,
+                                     &ckeys[k], &hit);
+          if (!err && !hit)
+            err = verify_start (workers[k], 1, items[assigned[k]].sig,
+                                items[assigned[k]].signed_text,
+                                items[assigned[k]].plaintext);
+          if (err || hit)
+            {
+              items[assigned[k]].err = err;
+              if (hit)
+                {
+                  items[assigned[k]].result
+                    = gpgme_op_verify_result (workers[k]);
+                  gpgme_result_ref (items[assigned[k]].result);
+                }
+              gpgme_ctx_pool_recycle (pool, workers[k]);
+              workers[k] = NULL;
+              done++;
+              err = 0;
+              continue;
+            }
+          running++;
+        }
+      if (!running)
+        continue;
+
+      /* This also returns GPG_ERR_CANCELED as soon as CTX has been
+         canceled.  */
+      err = _gpgme_wait_on_any (ctx, workers, nworkers, &k, &op_err);
+      if (err)
+        goto leave;
+
+      items[assigned[k]].err = op_err;
+      if (!items[assigned[k]].err)
+        {
+          items[assigned[k]].result = gpgme_op_verify_result (workers[k]);
+          gpgme_result_ref (items[assigned[k]].result);
+          _gpgme_verify_cache_put (&ckeys[k], workers[k]->verify_cache_ttl,
+                                   items[assigned[k]].result);
+        }
+      gpgme_ctx_pool_recycle (pool, workers[k]);
+      workers[k] = NULL;
+      running--;
+      done++;
+    }
+
+ leave:
+  /* Releasing a context also terminates a running engine.  */
+  for (k = 0; workers && k < nworkers; k++)
+    gpgme_release (workers[k]);
+  gpgme_ctx_pool_release (pool);
+  free (ckeys);
+  free (assigned);
+  free (workers);
+  return TRACE_ERR (err);
+}
+
+
 /* Compatibility interfaces.  */
 
 /* Get the key used to create signature IDX in CTX and return it in
@@ -809,6 +809,16 @@ _gpgme_io_spawn (const char *path, char * const argv[], unsigned int flags,
    nothing to select, > 0 = number of signaled fds.  */
 int
 _gpgme_io_select (struct io_select_fd_s *fds, size_t nfds, int nonblock)
+{
+  /* Use a 1s timeout.  */
+  return _gpgme_io_select_timeout (fds, nfds, nonblock? 0 : 1000);
+}
+
+
+/* Same as _gpgme_io_select but wait at most TIMEOUT_MS milliseconds.  */
+int
+_gpgme_io_select_timeout (struct io_select_fd_s *fds, size_t nfds,
+                          unsigned int timeout_ms)
 {
   int npollfds;
   GPollFD *pollfds;
@@ -818,14 +828,10 @@ _gpgme_io_select (struct io_select_fd_s *fds, size_t nfds, int nonblock)
   int any;
   int n;
   int count;
-  /* Use a 1s timeout.  */
-  int timeout = 1000;
+  int timeout = timeout_ms;
   void *dbg_help = NULL;
   TRACE_BEG  (DEBUG_SYSIO, "_gpgme_io_select", fds,
-	      "nfds=%u, nonblock=%u", nfds, nonblock);
-
-  if (nonblock)
-    timeout = 0;
+	      "nfds=%u, timeout=%u", nfds, timeout_ms);
 
   pollfds = calloc (nfds, sizeof *pollfds);
   if (!pollfds)
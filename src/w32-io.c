@@ -1635,6 +1635,16 @@ _gpgme_io_spawn (const char *path, char *const argv[], unsigned int flags,
    nothing to select, > 0 = number of signaled fds.  */
 int
 _gpgme_io_select (struct io_select_fd_s *fds, size_t nfds, int nonblock)
+{
+  /* Use a 1s timeout.  */
+  return _gpgme_io_select_timeout (fds, nfds, nonblock? 0 : 1000);
+}
+
+
+/* Same as _gpgme_io_select but wait at most TIMEOUT_MS milliseconds.  */
+int
+_gpgme_io_select_timeout (struct io_select_fd_s *fds, size_t nfds,
+                          unsigned int timeout_ms)
 {
   HANDLE waitbuf[MAXIMUM_WAIT_OBJECTS];
   int waitidx[MAXIMUM_WAIT_OBJECTS];
@@ -1645,7 +1655,7 @@ _gpgme_io_select (struct io_select_fd_s *fds, size_t nfds, int nonblock)
   int count;
   void *dbg_help = NULL;
   TRACE_BEG  (DEBUG_SYSIO, "_gpgme_io_select", fds,
-	      "nfds=%u, nonblock=%u", nfds, nonblock);
+	      "nfds=%u, timeout=%u", nfds, timeout_ms);
 
 #if 0
  restart:
@@ -1715,7 +1725,7 @@ _gpgme_io_select (struct io_select_fd_s *fds, size_t nfds, int nonblock)
   if (!any)
     return TRACE_SYSRES (0);
 
-  code = WaitForMultipleObjects (nwait, waitbuf, 0, nonblock ? 0 : 1000);
+  code = WaitForMultipleObjects (nwait, waitbuf, 0, timeout_ms);
   if (code < WAIT_OBJECT_0 + nwait)
     {
       /* The WFMO is a really silly function: It does return either
@@ -909,3 +909,29 @@ DllMain (HINSTANCE hinst, DWORD reason, LPVOID reserved)
   return TRUE;
 }
 #endif /*DLL_EXPORT*/
+
+
+/* Return a time stamp in milliseconds which is not affected by
+ * changes of the system time.  Only differences of the returned
+ * values are meaningful.  */
+uint64_t
+_gpgme_get_monotonic_ms (void)
+{
+  return GetTickCount64 ();
+}
+
+
+/* Return a time stamp in microseconds which is not affected by
+ * changes of the system time.  Only differences of the returned
+ * values are meaningful.  */
+uint64_t
+_gpgme_get_monotonic_us (void)
+{
+  LARGE_INTEGER freq, count;
+
+  if (!QueryPerformanceFrequency (&freq) || !freq.QuadPart
+      || !QueryPerformanceCounter (&count))
+    return GetTickCount64 () * 1000;
+  return (uint64_t)(count.QuadPart / freq.QuadPart) * 1000000
+    + (uint64_t)(count.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart;
+}
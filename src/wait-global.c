@@ -316,10 +316,10 @@ gpgme_wait_ext (gpgme_ctx_t ctx, gpgme_error_t *status,
 	      ictx = item->ctx;
 	      assert (ictx);
 
-	      LOCK (ctx->lock);
-	      if (ctx->canceled)
+	      LOCK (ictx->lock);
+	      if (ictx->canceled)
 		err = gpg_error (GPG_ERR_CANCELED);
-	      UNLOCK (ctx->lock);
+	      UNLOCK (ictx->lock);
 
 	      if (!err)
 		err = _gpgme_run_io_cb (&fdt.fds[i], 0, &local_op_err);
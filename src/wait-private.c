@@ -22,6 +22,8 @@
 #if HAVE_CONFIG_H
 #include <config.h>
 #endif
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <errno.h>
 
@@ -31,6 +33,7 @@
 #include "ops.h"
 #include "priv-io.h"
 #include "util.h"
+#include "sys-util.h"
 #include "debug.h"
 
 
@@ -69,24 +72,114 @@ _gpgme_wait_private_event_cb (void *data, gpgme_event_io_t type,
 }
 
 
-/* If COND is a null pointer, wait until the blocking operation in CTX
-   finished and return its error value.  Otherwise, wait until COND is
-   satisfied or the operation finished.  */
-gpgme_error_t
-_gpgme_wait_on_condition (gpgme_ctx_t ctx, volatile int *cond,
-			  gpgme_error_t *op_err_p)
+/* Return the read end of the wakeup pipe of CTX.  The pipe is
+   created on first use.  Returns -1 if this is not possible; a
+   cancellation is then only noticed at the next I/O.  */
+static int
+get_wakeup_fd (gpgme_ctx_t ctx)
+{
+  int fds[2];
+
+  LOCK (ctx->lock);
+  if (ctx->wakeup_fd[0] == -1 && !_gpgme_io_pipe (fds, 0))
+    {
+      /* gpgme_cancel_async must never block on a full pipe.  */
+      _gpgme_io_set_nonblocking (fds[1]);
+      ctx->wakeup_fd[0] = fds[0];
+      ctx->wakeup_fd[1] = fds[1];
+    }
+  UNLOCK (ctx->lock);
+
+  return ctx->wakeup_fd[0];
+}
+
+
+/* Register the read end of the wakeup pipe of CTX with the fd table
+   of CTX and return the index of its slot.  Returns -1 if this is not
+   possible.  */
+static int
+add_wakeup_fd (gpgme_ctx_t ctx)
+{
+  int idx;
+
+  if (get_wakeup_fd (ctx) == -1
+      || _gpgme_fd_table_put (&ctx->fdt, ctx->wakeup_fd[0], 1, NULL, &idx))
+    return -1;
+  return idx;
+}
+
+
+/* Drain the wakeup pipe whose read end is FD.  */
+static void
+drain_wakeup_fd (int fd)
+{
+  char buffer[16];
+
+  _gpgme_io_read (fd, buffer, sizeof buffer);
+}
+
+
+/* Return true if all file descriptors of CTX but the one at
+   SKIP_IDX have been closed.  */
+static int
+fds_closed_but (gpgme_ctx_t ctx, int skip_idx)
+{
+  unsigned int i;
+
+  for (i = 0; i < ctx->fdt.size; i++)
+    if (ctx->fdt.fds[i].fd != -1 && (int)i != skip_idx)
+      return 0;
+  return 1;
+}
+
+
+static gpgme_error_t
+wait_on_condition (gpgme_ctx_t ctx, volatile int *cond,
+                   gpgme_error_t *op_err_p, int wakeup_idx)
 {
   gpgme_error_t err = 0;
   int hang = 1;
 
-  if (op_err_p)
-    *op_err_p = 0;
-
   do
     {
-      int nr = _gpgme_io_select (ctx->fdt.fds, ctx->fdt.size, 0);
+      unsigned int timeout = 1000;
+      uint64_t now;
+      int nr;
       unsigned int i;
 
+      LOCK (ctx->lock);
+      if (ctx->canceled)
+	err = gpg_error (GPG_ERR_CANCELED);
+      UNLOCK (ctx->lock);
+
+      if (!err && ctx->deadline)
+        {
+          now = _gpgme_get_monotonic_ms ();
+          if (now >= ctx->deadline)
+            err = gpg_error (GPG_ERR_TIMEOUT);
+          else if (ctx->deadline - now < timeout)
+            timeout = (unsigned int)(ctx->deadline - now);
+        }
+
+      if (err)
+        {
+          _gpgme_cancel_with_err (ctx, err, 0);
+          return err;
+        }
+
+      /* This is checked before selecting; otherwise the wakeup fd
+         would keep us waiting for the timeout after the engine
+         closed its last fd.  */
+      if (fds_closed_but (ctx, wakeup_idx))
+	{
+	  struct gpgme_io_event_done_data data;
+	  data.err = 0;
+	  data.op_err = 0;
+	  _gpgme_engine_io_event (ctx->engine, GPGME_EVENT_DONE, &data);
+	  break;
+	}
+
+      nr = _gpgme_io_select_timeout (ctx->fdt.fds, ctx->fdt.size, timeout);
       if (nr < 0)
 	{
 	  /* An error occurred.  Close all fds in this context, and
@@ -107,6 +200,14 @@ _gpgme_wait_on_condition (gpgme_ctx_t ctx, volatile int *cond,
 	      assert (nr);
 	      nr--;
 
+              if ((int)i == wakeup_idx)
+                {
+                  /* Woken up by gpgme_cancel_async; the flag is
+                     checked at the top of the loop.  */
+                  drain_wakeup_fd (ctx->fdt.fds[i].fd);
+                  continue;
+                }
+
 	      LOCK (ctx->lock);
 	      if (ctx->canceled)
 		err = gpg_error (GPG_ERR_CANCELED);
@@ -141,17 +242,6 @@ _gpgme_wait_on_condition (gpgme_ctx_t ctx, volatile int *cond,
 	    }
 	}
 
-      for (i = 0; i < ctx->fdt.size; i++)
-	if (ctx->fdt.fds[i].fd != -1)
-	  break;
-      if (i == ctx->fdt.size)
-	{
-	  struct gpgme_io_event_done_data data;
-	  data.err = 0;
-	  data.op_err = 0;
-	  _gpgme_engine_io_event (ctx->engine, GPGME_EVENT_DONE, &data);
-	  hang = 0;
-	}
       if (cond && *cond)
 	hang = 0;
     }
@@ -161,6 +251,159 @@ _gpgme_wait_on_condition (gpgme_ctx_t ctx, volatile int *cond,
 }
 
 
+/* If COND is a null pointer, wait until the blocking operation in CTX
+   finished and return its error value.  Otherwise, wait until COND is
+   satisfied or the operation finished.  The wait is aborted
+   immediately by gpgme_cancel_async and with GPG_ERR_TIMEOUT when the
+   deadline of the operation has passed.  */
+gpgme_error_t
+_gpgme_wait_on_condition (gpgme_ctx_t ctx, volatile int *cond,
+			  gpgme_error_t *op_err_p)
+{
+  gpgme_error_t err;
+  int wakeup_idx;
+
+  if (op_err_p)
+    *op_err_p = 0;
+
+  wakeup_idx = add_wakeup_fd (ctx);
+  err = wait_on_condition (ctx, cond, op_err_p, wakeup_idx);
+  if (wakeup_idx != -1)
+    {
+      ctx->fdt.fds[wakeup_idx].fd = -1;
+      ctx->fdt.fds[wakeup_idx].signaled = 0;
+    }
+  return err;
+}
+
+
+/* Run the private event loop for the NCTXS contexts in CTXS until the
+   operation in one of them finished.  NULL entries are ignored.  The
+   index of that context is stored at R_IDX and the error value of its
+   operation at R_ERR.  An error is only returned if waiting itself
+   failed or if CTX, which owns the contexts, has been canceled; the
+   wakeup pipe of CTX is watched so that gpgme_cancel_async on CTX
+   interrupts the wait at once.  */
+gpgme_error_t
+_gpgme_wait_on_any (gpgme_ctx_t ctx, gpgme_ctx_t *ctxs, size_t nctxs,
+                    size_t *r_idx, gpgme_error_t *r_err)
+{
+  gpgme_error_t err = 0;
+  struct io_select_fd_s *fds = NULL;
+  size_t *sizes;
+  size_t nfds, k, j, off;
+  int wakeup_fd;
+  int nr;
+
+  /* The sizes of the fd tables when they were copied.  */
+  sizes = calloc (nctxs, sizeof *sizes);
+  if (!sizes)
+    return gpg_error_from_syserror ();
+
+  wakeup_fd = get_wakeup_fd (ctx);
+
+  for (;;)
+    {
+      LOCK (ctx->lock);
+      if (ctx->canceled)
+        err = gpg_error (GPG_ERR_CANCELED);
+      UNLOCK (ctx->lock);
+      if (err)
+        goto leave;
+
+      /* Report contexts which are done.  */
+      for (k = 0; k < nctxs; k++)
+        if (ctxs[k] && fds_closed_but (ctxs[k], -1))
+          {
+            struct gpgme_io_event_done_data data;
+            data.err = 0;
+            data.op_err = 0;
+            _gpgme_engine_io_event (ctxs[k]->engine, GPGME_EVENT_DONE,
+                                    &data);
+            *r_idx = k;
+            *r_err = 0;
+            goto leave;
+          }
+
+      /* Collect the active file descriptors.  The first slot is used
+         for the wakeup pipe.  */
+      nfds = 1;
+      for (k = 0; k < nctxs; k++)
+        {
+          sizes[k] = ctxs[k]? ctxs[k]->fdt.size : 0;
+          nfds += sizes[k];
+        }
+      fds = calloc (nfds, sizeof *fds);
+      if (!fds)
+        {
+          err = gpg_error_from_syserror ();
+          goto leave;
+        }
+      fds[0].fd = wakeup_fd;
+      fds[0].for_read = 1;
+      for (k = 0, off = 1; k < nctxs; off += sizes[k++])
+        if (sizes[k])
+          memcpy (fds + off, ctxs[k]->fdt.fds, sizes[k] * sizeof *fds);
+
+      nr = _gpgme_io_select (fds, nfds, 0);
+      if (nr < 0)
+        {
+          err = gpg_error_from_syserror ();
+          goto leave;
+        }
+
+      if (wakeup_fd != -1 && fds[0].signaled)
+        {
+          /* Woken up by gpgme_cancel_async; the flag is checked at
+             the top of the loop.  */
+          drain_wakeup_fd (wakeup_fd);
+          nr--;
+        }
+
+      /* The callbacks are run on the live entries of the fd tables
+         and not on the copies: a callback may close other fds of its
+         context and thereby release their data.  */
+      for (k = 0, off = 1; k < nctxs && nr > 0; off += sizes[k++])
+        for (j = 0; j < sizes[k] && nr > 0; j++)
+          {
+            gpgme_ctx_t ictx = ctxs[k];
+            struct io_select_fd_s *live;
+            gpgme_error_t op_err = 0;
+
+            if (fds[off + j].fd == -1 || !fds[off + j].signaled)
+              continue;
+            nr--;
+            live = &ictx->fdt.fds[j];
+            if (live->fd == -1 || live->fd != fds[off + j].fd)
+              continue;  /* Closed by an earlier callback.  */
+
+            LOCK (ictx->lock);
+            if (ictx->canceled)
+              err = gpg_error (GPG_ERR_CANCELED);
+            UNLOCK (ictx->lock);
+
+            if (!err)
+              err = _gpgme_run_io_cb (live, 0, &op_err);
+            if (err || op_err)
+              {
+                _gpgme_cancel_with_err (ictx, err, op_err);
+                *r_idx = k;
+                *r_err = err? err : op_err;
+                err = 0;
+                goto leave;
+              }
+          }
+      free (fds);
+      fds = NULL;
+    }
+
+ leave:
+  free (fds);
+  free (sizes);
+  return err;
+}
+
+
 /* Wait until the blocking operation in context CTX has finished and
    return the error value.  This variant can not be used for
    session-based protocols.  */
@@ -55,9 +55,11 @@ _gpgme_fd_table_deinit (fd_table_t fdt)
 }
 
 
+/* Store FD with direction DIR and OPAQUE in the first free slot of
+   FDT and return the index of that slot at IDX.  */
 /* XXX We should keep a marker and roll over for speed.  */
-static gpgme_error_t
-fd_table_put (fd_table_t fdt, int fd, int dir, void *opaque, int *idx)
+gpgme_error_t
+_gpgme_fd_table_put (fd_table_t fdt, int fd, int dir, void *opaque, int *idx)
 {
   unsigned int i, j;
   struct io_select_fd_s *new_fds;
@@ -128,7 +130,7 @@ _gpgme_add_io_cb (void *data, int fd, int dir, gpgme_io_cb_t fnc,
   item->handler = fnc;
   item->handler_value = fnc_data;
 
-  err = fd_table_put (fdt, fd, dir, item, &tag->idx);
+  err = _gpgme_fd_table_put (fdt, fd, dir, item, &tag->idx);
   if (err)
     {
       free (tag);
@@ -59,6 +59,8 @@ struct tag
 
 void _gpgme_fd_table_init (fd_table_t fdt);
 void _gpgme_fd_table_deinit (fd_table_t fdt);
+gpgme_error_t _gpgme_fd_table_put (fd_table_t fdt, int fd, int dir,
+                                   void *opaque, int *idx);
 
 gpgme_error_t _gpgme_add_io_cb (void *data, int fd, int dir,
 			     gpgme_io_cb_t fnc, void *fnc_data, void **r_tag);
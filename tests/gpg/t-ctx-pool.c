@@ -0,0 +1,169 @@
+/* t-ctx-pool.c - Regression test.
+ * Copyright (C) 2021 g10 Code GmbH
+ *
+ * This file is part of GPGME.
+ *
+ * GPGME is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * GPGME is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <https://gnu.org/licenses/>.
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* We need to include config.h so that we know whether we are building
+   with large file system (LFS) support. */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <gpgme.h>
+
+#define PGM "t-ctx-pool"
+#include "t-support.h"
+
+
+
+static const char test_text1[] = "Just GNU it!\n";
+static const char test_sig1[] =
+"-----BEGIN PGP SIGNATURE-----\n"
+"\n"
+"iN0EABECAJ0FAjoS+i9FFIAAAAAAAwA5YmFyw7bDpMO8w58gZGFzIHdhcmVuIFVt\n"
+"bGF1dGUgdW5kIGpldHp0IGVpbiBwcm96ZW50JS1aZWljaGVuNRSAAAAAAAgAJGZv\n"
+"b2Jhci4xdGhpcyBpcyBhIG5vdGF0aW9uIGRhdGEgd2l0aCAyIGxpbmVzGhpodHRw\n"
+"Oi8vd3d3Lmd1Lm9yZy9wb2xpY3kvAAoJEC1yfMdoaXc0JBIAoIiLlUsvpMDOyGEc\n"
+"dADGKXF/Hcb+AKCJWPphZCphduxSvrzH0hgzHdeQaA==\n"
+"=nts1\n"
+"-----END PGP SIGNATURE-----\n";
+
+
+static void
+check_stats (gpgme_ctx_pool_t pool, unsigned long created,
+             unsigned long reused, unsigned int idle, unsigned int in_use)
+{
+  gpgme_error_t err;
+  struct _gpgme_ctx_pool_stats stats;
+
+  err = gpgme_ctx_pool_get_stats (pool, &stats);
+  fail_if_err (err);
+  if (stats.created != created || stats.reused != reused
+      || stats.idle != idle || stats.in_use != in_use)
+    {
+      fprintf (stderr, "%s:%i: Unexpected stats: "
+               "created=%lu reused=%lu idle=%u in_use=%u\n",
+               PGM, __LINE__, stats.created, stats.reused,
+               stats.idle, stats.in_use);
+      exit (1);
+    }
+}
+
+
+static void
+verify_once (gpgme_ctx_t ctx)
+{
+  gpgme_error_t err;
+  gpgme_data_t sig, text;
+  gpgme_verify_result_t result;
+
+  err = gpgme_data_new_from_mem (&text, test_text1, strlen (test_text1), 0);
+  fail_if_err (err);
+  err = gpgme_data_new_from_mem (&sig, test_sig1, strlen (test_sig1), 0);
+  fail_if_err (err);
+  err = gpgme_op_verify (ctx, sig, text, NULL);
+  fail_if_err (err);
+  result = gpgme_op_verify_result (ctx);
+  if (!result || !result->signatures
+      || gpgme_err_code (result->signatures->status) != GPG_ERR_NO_ERROR
+      || strcmp (result->signatures->fpr,
+                 "A0FF4590BB6122EDEF6E3C542D727CC768697734"))
+    {
+      fprintf (stderr, "%s:%i: Unexpected verify result\n",
+               PGM, __LINE__);
+      exit (1);
+    }
+  gpgme_data_release (sig);
+  gpgme_data_release (text);
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  gpgme_ctx_pool_t pool;
+  gpgme_ctx_t templ, ctx, ctx2, first;
+  gpgme_error_t err;
+  int i;
+
+  (void)argc;
+  (void)argv;
+
+  init_gpgme (GPGME_PROTOCOL_OpenPGP);
+
+  err = gpgme_new (&templ);
+  fail_if_err (err);
+  gpgme_set_textmode (templ, 1);
+  gpgme_set_keylist_mode (templ, GPGME_KEYLIST_MODE_SIGS);
+  err = gpgme_ctx_pool_new (&pool, templ, 1);
+  fail_if_err (err);
+  gpgme_release (templ);
+
+  /* A new context is configured like the template.  */
+  err = gpgme_ctx_pool_acquire (pool, &ctx);
+  fail_if_err (err);
+  if (!gpgme_get_textmode (ctx) || gpgme_get_armor (ctx)
+      || gpgme_get_keylist_mode (ctx) != GPGME_KEYLIST_MODE_SIGS)
+    {
+      fprintf (stderr, "%s:%i: Template not applied\n", PGM, __LINE__);
+      exit (1);
+    }
+  check_stats (pool, 1, 0, 0, 1);
+
+  /* Changes and results are dropped when the context is recycled.  */
+  verify_once (ctx);
+  gpgme_set_armor (ctx, 1);
+  gpgme_set_textmode (ctx, 0);
+  first = ctx;
+  gpgme_ctx_pool_recycle (pool, ctx);
+  check_stats (pool, 1, 0, 1, 0);
+
+  err = gpgme_ctx_pool_acquire (pool, &ctx);
+  fail_if_err (err);
+  if (ctx != first)
+    {
+      fprintf (stderr, "%s:%i: Context not reused\n", PGM, __LINE__);
+      exit (1);
+    }
+  if (!gpgme_get_textmode (ctx) || gpgme_get_armor (ctx)
+      || gpgme_op_verify_result (ctx))
+    {
+      fprintf (stderr, "%s:%i: Context not scrubbed\n", PGM, __LINE__);
+      exit (1);
+    }
+  check_stats (pool, 1, 1, 0, 1);
+
+  /* The reused context still works.  */
+  for (i = 0; i < 3; i++)
+    verify_once (ctx);
+
+  /* With MAX_IDLE of 1 the second context is discarded.  */
+  err = gpgme_ctx_pool_acquire (pool, &ctx2);
+  fail_if_err (err);
+  check_stats (pool, 2, 1, 0, 2);
+  gpgme_ctx_pool_recycle (pool, ctx);
+  gpgme_ctx_pool_recycle (pool, ctx2);
+  check_stats (pool, 2, 1, 1, 0);
+
+  gpgme_ctx_pool_release (pool);
+  return 0;
+}
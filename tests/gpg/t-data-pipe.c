@@ -0,0 +1,302 @@
+/* t-data-pipe.c - Regression test.
+ * Copyright (C) 2021 g10 Code GmbH
+ *
+ * This file is part of GPGME.
+ *
+ * GPGME is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * GPGME is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <https://gnu.org/licenses/>.
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* Run sign, encrypt, decrypt and verify concurrently with the stages
+   connected by pipes.  The plaintext is generated on the fly and the
+   result is compared on the fly so that the memory use does not
+   depend on the size of the data.  The size in MiB may be given as
+   argument.  Also checks that an operation which could not be started
+   can be retried with the same pipe.  */
+
+/* We need to include config.h so that we know whether we are building
+   with large file system (LFS) support. */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+
+#include <gpgme.h>
+
+#define PGM "t-data-pipe"
+#include "t-support.h"
+
+
+struct pattern
+{
+  unsigned long long size;
+  unsigned long long pos;
+};
+
+
+static unsigned char
+pattern_byte (unsigned long long pos)
+{
+  return 'a' + (pos * 7 + pos / 4096) % 26;
+}
+
+
+static ssize_t
+source_read (void *handle, void *buffer, size_t size)
+{
+  struct pattern *src = handle;
+  unsigned char *p = buffer;
+  size_t n;
+
+  if (size > src->size - src->pos)
+    size = src->size - src->pos;
+  for (n = 0; n < size; n++)
+    p[n] = pattern_byte (src->pos++);
+  return size;
+}
+
+
+static ssize_t
+sink_write (void *handle, const void *buffer, size_t size)
+{
+  struct pattern *dst = handle;
+  const unsigned char *p = buffer;
+  size_t n;
+
+  for (n = 0; n < size; n++)
+    if (p[n] != pattern_byte (dst->pos++))
+      {
+        fprintf (stderr, "%s:%i: Mismatch at offset %llu\n",
+                 PGM, __LINE__, dst->pos - 1);
+        exit (1);
+      }
+  return size;
+}
+
+
+static gpgme_ctx_t
+new_ctx (void)
+{
+  gpgme_ctx_t ctx;
+  gpgme_error_t err;
+  char *agent_info;
+
+  err = gpgme_new (&ctx);
+  fail_if_err (err);
+  agent_info = getenv ("GPG_AGENT_INFO");
+  if (!(agent_info && strchr (agent_info, ':')))
+    gpgme_set_passphrase_cb (ctx, passphrase_cb, NULL);
+  return ctx;
+}
+
+
+/* An operation which fails before gpg has been started must leave the
+   pipe ends intact so that it can be retried.  The start is made to
+   fail by running out of file descriptors: the write end of the pipe
+   for the ciphertext is passed to gpg first and then a pipe for the
+   plaintext is created.  */
+static void
+check_retry (gpgme_key_t *key)
+{
+  gpgme_ctx_t ctx;
+  gpgme_error_t err;
+  gpgme_data_t in, cipher_writer, cipher_reader;
+  struct rlimit rl, saved_rl;
+  int fds[256];
+  int nfds;
+  int nfailed = 0;
+  char buffer[256];
+  ssize_t n;
+  size_t total = 0;
+
+  err = gpgme_data_new_pipe (&cipher_writer, &cipher_reader);
+  fail_if_err (err);
+  err = gpgme_data_new_from_mem (&in, "Hallo Leute\n", 12, 0);
+  fail_if_err (err);
+
+  /* Use up all file descriptors.  */
+  if (getrlimit (RLIMIT_NOFILE, &saved_rl))
+    {
+      fprintf (stderr, "%s:%i: getrlimit failed\n", PGM, __LINE__);
+      exit (1);
+    }
+  rl = saved_rl;
+  if (rl.rlim_cur > DIM (fds))
+    rl.rlim_cur = DIM (fds);
+  if (setrlimit (RLIMIT_NOFILE, &rl))
+    {
+      fprintf (stderr, "%s:%i: setrlimit failed\n", PGM, __LINE__);
+      exit (1);
+    }
+  for (nfds = 0; nfds < DIM (fds); nfds++)
+    if ((fds[nfds] = open ("/dev/null", O_RDONLY)) == -1)
+      break;
+
+  /* Release one file descriptor after the other until the operation
+     can be started.  */
+  do
+    {
+      if (!nfds)
+        {
+          fprintf (stderr, "%s:%i: Operation failed after %d retries: %s\n",
+                   PGM, __LINE__, nfailed, gpgme_strerror (err));
+          exit (1);
+        }
+      close (fds[--nfds]);
+      ctx = new_ctx ();
+      gpgme_data_seek (in, 0, SEEK_SET);
+      err = gpgme_op_encrypt (ctx, key, GPGME_ENCRYPT_ALWAYS_TRUST,
+                              in, cipher_writer);
+      gpgme_release (ctx);
+      if (err)
+        nfailed++;
+    }
+  while (err);
+  while (nfds)
+    close (fds[--nfds]);
+  setrlimit (RLIMIT_NOFILE, &saved_rl);
+
+  if (!nfailed)
+    {
+      fprintf (stderr, "%s:%i: Operation did not fail\n", PGM, __LINE__);
+      exit (1);
+    }
+
+  gpgme_data_release (cipher_writer);
+  while ((n = gpgme_data_read (cipher_reader, buffer, sizeof buffer)) > 0)
+    total += n;
+  if (n < 0 || !total)
+    {
+      fprintf (stderr, "%s:%i: No ciphertext received\n", PGM, __LINE__);
+      exit (1);
+    }
+
+  gpgme_data_release (in);
+  gpgme_data_release (cipher_reader);
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  gpgme_ctx_t sign_ctx, encrypt_ctx, decrypt_ctx, verify_ctx, ctx;
+  gpgme_error_t err, status;
+  gpgme_data_t in, out;
+  gpgme_data_t signed_writer, signed_reader;
+  gpgme_data_t cipher_writer, cipher_reader;
+  gpgme_data_t plain_writer, plain_reader;
+  struct gpgme_data_cbs source_cbs = { source_read };
+  struct gpgme_data_cbs sink_cbs = { NULL, sink_write };
+  struct pattern source = { 0, 0 };
+  struct pattern sink = { 0, 0 };
+  gpgme_key_t key[2] = { NULL, NULL };
+  gpgme_verify_result_t result;
+  int i;
+
+  source.size = 1024 * 1024;
+  if (argc > 1)
+    source.size *= strtoul (argv[1], NULL, 10);
+
+  init_gpgme (GPGME_PROTOCOL_OpenPGP);
+
+  err = gpgme_data_new_pipe (&signed_writer, &signed_reader);
+  if (gpgme_err_code (err) == GPG_ERR_NOT_IMPLEMENTED)
+    return 0;
+  fail_if_err (err);
+  err = gpgme_data_new_pipe (&cipher_writer, &cipher_reader);
+  fail_if_err (err);
+  err = gpgme_data_new_pipe (&plain_writer, &plain_reader);
+  fail_if_err (err);
+
+  /* A pipe end can't be positioned.  */
+  if (gpgme_data_seek (signed_reader, 0, SEEK_SET) != -1)
+    {
+      fprintf (stderr, "%s:%i: Seek on a pipe succeeded\n", PGM, __LINE__);
+      exit (1);
+    }
+
+  sign_ctx = new_ctx ();
+  encrypt_ctx = new_ctx ();
+  decrypt_ctx = new_ctx ();
+  verify_ctx = new_ctx ();
+
+  err = gpgme_get_key (encrypt_ctx,
+                       "A0FF4590BB6122EDEF6E3C542D727CC768697734",
+                       &key[0], 0);
+  fail_if_err (err);
+
+  err = gpgme_data_new_from_cbs (&in, &source_cbs, &source);
+  fail_if_err (err);
+  err = gpgme_data_new_from_cbs (&out, &sink_cbs, &sink);
+  fail_if_err (err);
+
+  err = gpgme_op_sign_start (sign_ctx, in, signed_writer,
+                             GPGME_SIG_MODE_NORMAL);
+  fail_if_err (err);
+  err = gpgme_op_encrypt_start (encrypt_ctx, key, GPGME_ENCRYPT_ALWAYS_TRUST,
+                                signed_reader, cipher_writer);
+  fail_if_err (err);
+  err = gpgme_op_decrypt_start (decrypt_ctx, cipher_reader, plain_writer);
+  fail_if_err (err);
+  err = gpgme_op_verify_start (verify_ctx, plain_reader, NULL, out);
+  fail_if_err (err);
+
+  for (i = 0; i < 4; i++)
+    {
+      ctx = gpgme_wait (NULL, &status, 1);
+      if (!ctx)
+        {
+          fprintf (stderr, "%s:%i: gpgme_wait failed\n", PGM, __LINE__);
+          exit (1);
+        }
+      fail_if_err (status);
+    }
+
+  if (sink.pos != source.size)
+    {
+      fprintf (stderr, "%s:%i: Got %llu of %llu bytes\n",
+               PGM, __LINE__, sink.pos, source.size);
+      exit (1);
+    }
+  result = gpgme_op_verify_result (verify_ctx);
+  if (!result || !result->signatures
+      || gpgme_err_code (result->signatures->status) != GPG_ERR_NO_ERROR)
+    {
+      fprintf (stderr, "%s:%i: Unexpected verify result\n", PGM, __LINE__);
+      exit (1);
+    }
+
+  check_retry (key);
+
+  gpgme_data_release (in);
+  gpgme_data_release (out);
+  gpgme_data_release (signed_writer);
+  gpgme_data_release (signed_reader);
+  gpgme_data_release (cipher_writer);
+  gpgme_data_release (cipher_reader);
+  gpgme_data_release (plain_writer);
+  gpgme_data_release (plain_reader);
+  gpgme_key_unref (key[0]);
+  gpgme_release (sign_ctx);
+  gpgme_release (encrypt_ctx);
+  gpgme_release (decrypt_ctx);
+  gpgme_release (verify_ctx);
+  return 0;
+}
@@ -0,0 +1,242 @@
+/* t-data-ring.c - Regression test.
+ * Copyright (C) 2021 g10 Code GmbH
+ *
+ * This file is part of GPGME.
+ *
+ * GPGME is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * GPGME is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <https://gnu.org/licenses/>.
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* We need to include config.h so that we know whether we are building
+   with large file system (LFS) support. */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include <gpgme.h>
+
+#define PGM "t-data-ring"
+#include "t-support.h"
+
+
+#define TEXT_LEN (512 * 1024)
+
+static char text[TEXT_LEN];
+
+
+static void
+check_io (gpgme_ssize_t got, gpgme_ssize_t expected, int err, int line)
+{
+  if (got != expected || (got == -1 && errno != err))
+    {
+      fprintf (stderr, "%s:%i: Got %d (errno=%d) but expected %d\n",
+               PGM, line, (int)got, got == -1? errno : 0, (int)expected);
+      exit (1);
+    }
+}
+
+
+/* Check the semantics of a small ring in non-blocking mode.  */
+static void
+check_nonblock (void)
+{
+  gpgme_error_t err;
+  gpgme_data_t writer, reader;
+  char buffer[32];
+
+  err = gpgme_data_new_ring (&writer, &reader, 16,
+                             GPGME_DATA_RING_NONBLOCK_WRITER
+                             | GPGME_DATA_RING_NONBLOCK_READER);
+  fail_if_err (err);
+
+  check_io (gpgme_data_read (reader, buffer, 1), -1, EAGAIN, __LINE__);
+  check_io (gpgme_data_write (writer, "0123456789abcdefghij", 20), 16, 0,
+            __LINE__);
+  check_io (gpgme_data_write (writer, "x", 1), -1, EAGAIN, __LINE__);
+  check_io (gpgme_data_read (reader, buffer, 10), 10, 0, __LINE__);
+  if (memcmp (buffer, "0123456789", 10))
+    {
+      fprintf (stderr, "%s:%i: Wrong data read\n", PGM, __LINE__);
+      exit (1);
+    }
+
+  /* This wraps around.  */
+  check_io (gpgme_data_write (writer, "ABCDEFGHIJKL", 12), 10, 0, __LINE__);
+  check_io (gpgme_data_read (reader, buffer, sizeof buffer), 16, 0,
+            __LINE__);
+  if (memcmp (buffer, "abcdefABCDEFGHIJ", 16))
+    {
+      fprintf (stderr, "%s:%i: Wrong data read\n", PGM, __LINE__);
+      exit (1);
+    }
+
+  /* The ends can't be mixed up or positioned.  */
+  check_io (gpgme_data_write (reader, "x", 1), -1, EBADF, __LINE__);
+  check_io (gpgme_data_read (writer, buffer, 1), -1, EBADF, __LINE__);
+  check_io (gpgme_data_seek (reader, 0, SEEK_SET), -1, ENOSYS, __LINE__);
+
+  /* Releasing the writer signals EOF.  */
+  check_io (gpgme_data_write (writer, "xyz", 3), 3, 0, __LINE__);
+  gpgme_data_release (writer);
+  check_io (gpgme_data_read (reader, buffer, sizeof buffer), 3, 0, __LINE__);
+  check_io (gpgme_data_read (reader, buffer, sizeof buffer), 0, 0, __LINE__);
+  gpgme_data_release (reader);
+
+  /* Releasing the reader breaks the ring.  */
+  err = gpgme_data_new_ring (&writer, &reader, 0, 0);
+  fail_if_err (err);
+  gpgme_data_release (reader);
+  check_io (gpgme_data_write (writer, "x", 1), -1, EPIPE, __LINE__);
+  gpgme_data_release (writer);
+}
+
+
+/* Write the text in odd sized chunks to the ring.  */
+static void *
+producer (void *arg)
+{
+  gpgme_data_t writer = arg;
+  size_t pos, n;
+
+  for (pos = 0; pos < TEXT_LEN; pos += n)
+    {
+      n = 1 + (pos * 31) % 9000;
+      if (n > TEXT_LEN - pos)
+        n = TEXT_LEN - pos;
+      if (gpgme_data_write (writer, text + pos, n) != (gpgme_ssize_t)n)
+        {
+          fprintf (stderr, "%s:%i: Write failed: %s\n",
+                   PGM, __LINE__, strerror (errno));
+          exit (1);
+        }
+    }
+  gpgme_data_release (writer);
+  return NULL;
+}
+
+
+/* Copy the ring to a memory object.  */
+struct consumer_arg
+{
+  gpgme_data_t reader;
+  gpgme_data_t out;
+};
+
+static void *
+consumer (void *arg)
+{
+  struct consumer_arg *carg = arg;
+  char buffer[777];
+  gpgme_ssize_t n;
+
+  while ((n = gpgme_data_read (carg->reader, buffer, sizeof buffer)) > 0)
+    if (gpgme_data_write (carg->out, buffer, n) != n)
+      break;
+  if (n)
+    {
+      fprintf (stderr, "%s:%i: Read failed: %s\n",
+               PGM, __LINE__, strerror (errno));
+      exit (1);
+    }
+  return NULL;
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  gpgme_ctx_t ctx;
+  gpgme_error_t err;
+  gpgme_data_t plain_writer, plain_reader;
+  gpgme_data_t cipher_writer, cipher_reader;
+  gpgme_data_t cipher, result;
+  gpgme_key_t key[2] = { NULL, NULL };
+  struct consumer_arg carg;
+  pthread_t producer_thread, consumer_thread;
+  char *agent_info;
+  char *buf;
+  size_t len;
+  size_t i;
+
+  (void)argc;
+  (void)argv;
+
+  init_gpgme (GPGME_PROTOCOL_OpenPGP);
+
+  check_nonblock ();
+
+  for (i = 0; i < TEXT_LEN; i++)
+    text[i] = 'a' + (i * 7 + i / 1024) % 26;
+
+  err = gpgme_new (&ctx);
+  fail_if_err (err);
+  agent_info = getenv ("GPG_AGENT_INFO");
+  if (!(agent_info && strchr (agent_info, ':')))
+    gpgme_set_passphrase_cb (ctx, passphrase_cb, NULL);
+  err = gpgme_get_key (ctx, "A0FF4590BB6122EDEF6E3C542D727CC768697734",
+		       &key[0], 0);
+  fail_if_err (err);
+
+  /* Encrypt with the plaintext produced and the ciphertext consumed
+     by other threads.  */
+  err = gpgme_data_new_ring (&plain_writer, &plain_reader, 4096, 0);
+  fail_if_err (err);
+  err = gpgme_data_new_ring (&cipher_writer, &cipher_reader, 1000, 0);
+  fail_if_err (err);
+  err = gpgme_data_new (&cipher);
+  fail_if_err (err);
+  carg.reader = cipher_reader;
+  carg.out = cipher;
+  if (pthread_create (&producer_thread, NULL, producer, plain_writer)
+      || pthread_create (&consumer_thread, NULL, consumer, &carg))
+    {
+      fprintf (stderr, "%s:%i: pthread_create failed\n", PGM, __LINE__);
+      exit (1);
+    }
+
+  err = gpgme_op_encrypt (ctx, key, GPGME_ENCRYPT_ALWAYS_TRUST,
+                          plain_reader, cipher_writer);
+  fail_if_err (err);
+  gpgme_data_release (cipher_writer);
+  pthread_join (producer_thread, NULL);
+  pthread_join (consumer_thread, NULL);
+  gpgme_data_release (plain_reader);
+  gpgme_data_release (cipher_reader);
+
+  err = gpgme_data_rewind (cipher);
+  fail_if_err (err);
+  err = gpgme_data_new (&result);
+  fail_if_err (err);
+  err = gpgme_op_decrypt (ctx, cipher, result);
+  fail_if_err (err);
+  buf = gpgme_data_release_and_get_mem (result, &len);
+  if (len != TEXT_LEN || memcmp (buf, text, TEXT_LEN))
+    {
+      fprintf (stderr, "%s:%i: Decrypted text does not match\n",
+               PGM, __LINE__);
+      exit (1);
+    }
+
+  gpgme_free (buf);
+  gpgme_data_release (cipher);
+  gpgme_key_unref (key[0]);
+  gpgme_release (ctx);
+  return 0;
+}
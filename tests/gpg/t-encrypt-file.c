@@ -0,0 +1,168 @@
+/* t-encrypt-file.c - Regression test.
+ * Copyright (C) 2021 g10 Code GmbH
+ *
+ * This file is part of GPGME.
+ *
+ * GPGME is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * GPGME is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <https://gnu.org/licenses/>.
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* Encrypt and decrypt data objects created from regular files.  On
+   Unix these are handed directly to gpg.  */
+
+/* We need to include config.h so that we know whether we are building
+   with large file system (LFS) support. */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <gpgme.h>
+
+#define PGM "t-encrypt-file"
+#include "t-support.h"
+
+
+/* The number of bytes written before the plaintext.  They are skipped
+   by positioning the file and must not be encrypted.  */
+#define PREFIX_LEN 7
+
+#define TEXT_LEN (256 * 1024)
+
+
+static FILE *
+make_tmpfile (void)
+{
+  FILE *fp = tmpfile ();
+
+  if (!fp)
+    {
+      fprintf (stderr, "%s:%i: tmpfile failed\n", PGM, __LINE__);
+      exit (1);
+    }
+  return fp;
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  gpgme_ctx_t ctx;
+  gpgme_error_t err;
+  gpgme_data_t in, out;
+  gpgme_key_t key[2] = { NULL, NULL };
+  gpgme_encrypt_result_t result;
+  FILE *plain_fp, *cipher_fp, *result_fp;
+  char *text, *buffer;
+  char *agent_info;
+  size_t i;
+
+  (void)argc;
+  (void)argv;
+
+  init_gpgme (GPGME_PROTOCOL_OpenPGP);
+
+  text = malloc (TEXT_LEN);
+  buffer = malloc (TEXT_LEN + 1);
+  if (!text || !buffer)
+    {
+      fprintf (stderr, "%s:%i: out of core\n", PGM, __LINE__);
+      exit (1);
+    }
+  for (i = 0; i < TEXT_LEN; i++)
+    text[i] = 'a' + (i * 7 + i / 1024) % 26;
+
+  plain_fp = make_tmpfile ();
+  cipher_fp = make_tmpfile ();
+  result_fp = make_tmpfile ();
+  if (fwrite ("prefix\n", PREFIX_LEN, 1, plain_fp) != 1
+      || fwrite (text, TEXT_LEN, 1, plain_fp) != 1
+      || fflush (plain_fp)
+      || fseek (plain_fp, PREFIX_LEN, SEEK_SET))
+    {
+      fprintf (stderr, "%s:%i: writing the plaintext failed\n",
+               PGM, __LINE__);
+      exit (1);
+    }
+
+  err = gpgme_new (&ctx);
+  fail_if_err (err);
+  agent_info = getenv ("GPG_AGENT_INFO");
+  if (!(agent_info && strchr (agent_info, ':')))
+    gpgme_set_passphrase_cb (ctx, passphrase_cb, NULL);
+
+  err = gpgme_get_key (ctx, "A0FF4590BB6122EDEF6E3C542D727CC768697734",
+		       &key[0], 0);
+  fail_if_err (err);
+
+  err = gpgme_data_new_from_fd (&in, fileno (plain_fp));
+  fail_if_err (err);
+  err = gpgme_data_new_from_fd (&out, fileno (cipher_fp));
+  fail_if_err (err);
+  err = gpgme_op_encrypt (ctx, key, GPGME_ENCRYPT_ALWAYS_TRUST, in, out);
+  fail_if_err (err);
+  result = gpgme_op_encrypt_result (ctx);
+  if (result->invalid_recipients)
+    {
+      fprintf (stderr, "%s:%i: Invalid recipient encountered: %s\n",
+	       PGM, __LINE__, result->invalid_recipients->fpr);
+      exit (1);
+    }
+  gpgme_data_release (in);
+  gpgme_data_release (out);
+
+  /* The file offsets have been advanced as with a pipe.  */
+  if (gpgme_data_new_from_fd (&in, fileno (plain_fp))
+      || gpgme_data_seek (in, 0, SEEK_CUR) != PREFIX_LEN + TEXT_LEN)
+    {
+      fprintf (stderr, "%s:%i: Plaintext not consumed\n", PGM, __LINE__);
+      exit (1);
+    }
+  gpgme_data_release (in);
+
+  err = gpgme_data_new_from_fd (&in, fileno (cipher_fp));
+  fail_if_err (err);
+  if (gpgme_data_seek (in, 0, SEEK_SET))
+    {
+      fprintf (stderr, "%s:%i: Seek failed\n", PGM, __LINE__);
+      exit (1);
+    }
+  err = gpgme_data_new_from_fd (&out, fileno (result_fp));
+  fail_if_err (err);
+  err = gpgme_op_decrypt (ctx, in, out);
+  fail_if_err (err);
+  gpgme_data_release (in);
+  gpgme_data_release (out);
+
+  rewind (result_fp);
+  if (fread (buffer, 1, TEXT_LEN + 1, result_fp) != TEXT_LEN
+      || memcmp (buffer, text, TEXT_LEN))
+    {
+      fprintf (stderr, "%s:%i: Decrypted text does not match\n",
+               PGM, __LINE__);
+      exit (1);
+    }
+
+  fclose (plain_fp);
+  fclose (cipher_fp);
+  fclose (result_fp);
+  free (text);
+  free (buffer);
+  gpgme_key_unref (key[0]);
+  gpgme_release (ctx);
+  return 0;
+}
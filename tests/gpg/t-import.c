@@ -207,6 +207,30 @@ check_result (gpgme_import_result_t result, const char *fpr, int secret)
 }
 
 
+struct import_cb_parm
+{
+  int count;
+  gpgme_error_t err;
+};
+
+
+static gpgme_error_t
+import_cb (void *opaque, gpgme_import_status_t import)
+{
+  struct import_cb_parm *parm = opaque;
+
+  if (strcmp (import->fpr, "ADAB7FCC1F4DE2616ECFA402AF82244F9CD9FD55")
+      || import->result)
+    {
+      fprintf (stderr, "Unexpected import status %s (%s)\n",
+	       import->fpr, gpgme_strerror (import->result));
+      exit (1);
+    }
+  parm->count++;
+  return parm->err;
+}
+
+
 int
 main (int argc, char *argv[])
 {
@@ -214,6 +238,7 @@ main (int argc, char *argv[])
   gpgme_error_t err;
   gpgme_data_t in;
   gpgme_import_result_t result;
+  struct import_cb_parm parm = { 0, 0 };
   char *pubkey_1_asc = make_filename ("pubkey-1.asc");
   char *seckey_1_asc = make_filename ("seckey-1.asc");
 
@@ -243,6 +268,30 @@ main (int argc, char *argv[])
   fail_if_err (err);
   result = gpgme_op_import_result (ctx);
   check_result (result, "ADAB7FCC1F4DE2616ECFA402AF82244F9CD9FD55", 1);
+
+  /* With an import callback the statuses are not kept.  */
+  gpgme_set_import_cb (ctx, import_cb, &parm);
+  gpgme_data_rewind (in);
+  err = gpgme_op_import (ctx, in);
+  fail_if_err (err);
+  result = gpgme_op_import_result (ctx);
+  if (!parm.count || result->imports || !result->considered)
+    {
+      fprintf (stderr, "Unexpected result with import callback "
+               "(%i calls, %i considered)\n", parm.count, result->considered);
+      exit (1);
+    }
+
+  /* An error returned by the callback cancels the import.  */
+  parm.err = gpg_error (GPG_ERR_CANCELED);
+  gpgme_data_rewind (in);
+  err = gpgme_op_import (ctx, in);
+  if (gpgme_err_code (err) != GPG_ERR_CANCELED)
+    {
+      fprintf (stderr, "Import callback error not returned: %s\n",
+               gpgme_strerror (err));
+      exit (1);
+    }
   gpgme_data_release (in);
 
   gpgme_release (ctx);
@@ -0,0 +1,203 @@
+/* t-keylist-filter.c - Regression test.
+ * Copyright (C) 2021 g10 Code GmbH
+ *
+ * This file is part of GPGME.
+ *
+ * GPGME is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * GPGME is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <https://gnu.org/licenses/>.
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* Compare filtered key listings with full key listings filtered by
+   the test.  */
+
+/* We need to include config.h so that we know whether we are building
+   with large file system (LFS) support. */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include <gpgme.h>
+
+#define PGM "t-keylist-filter"
+#include "t-support.h"
+
+
+#define MAX_KEYS 64
+
+static gpgme_key_t all_keys[MAX_KEYS];
+static int nall_keys;
+
+
+/* The predicate of FILTER as implemented by the test.  The regular
+   expression is always of the form "^PREFIX".  */
+static int
+match (gpgme_keylist_filter_t filter, gpgme_key_t key)
+{
+  gpgme_user_id_t uid;
+
+  if ((filter->can_encrypt && !key->can_encrypt)
+      || (filter->can_sign && !key->can_sign)
+      || (filter->not_expired && key->expired)
+      || (filter->not_revoked && key->revoked)
+      || (filter->secret && !key->secret))
+    return 0;
+  if (filter->expires_after && key->subkeys->expires > 0
+      && (unsigned long)key->subkeys->expires < filter->expires_after)
+    return 0;
+  if (!filter->min_validity && !filter->uid_regex)
+    return 1;
+  for (uid = key->uids; uid; uid = uid->next)
+    if (uid->validity >= filter->min_validity
+        && (!filter->uid_regex
+            || !strncasecmp (uid->uid, filter->uid_regex + 1,
+                             strlen (filter->uid_regex + 1))))
+      return 1;
+  return 0;
+}
+
+
+static void
+list_keys (gpgme_ctx_t ctx, gpgme_key_t *keys, int *nkeys)
+{
+  gpgme_error_t err;
+  gpgme_key_t key;
+
+  *nkeys = 0;
+  err = gpgme_op_keylist_start (ctx, NULL, 0);
+  fail_if_err (err);
+  while (!(err = gpgme_op_keylist_next (ctx, &key)))
+    {
+      if (*nkeys == MAX_KEYS)
+        {
+          fprintf (stderr, "%s:%i: Too many keys\n", PGM, __LINE__);
+          exit (1);
+        }
+      keys[(*nkeys)++] = key;
+    }
+  if (gpgme_err_code (err) != GPG_ERR_EOF)
+    fail_if_err (err);
+}
+
+
+/* Check the listing with FILTER and return the number of keys.  */
+static int
+check_filter (gpgme_ctx_t ctx, gpgme_keylist_filter_t filter, int line)
+{
+  gpgme_error_t err;
+  gpgme_key_t keys[MAX_KEYS];
+  int nkeys, i, j;
+
+  err = gpgme_set_keylist_filter (ctx, filter);
+  fail_if_err (err);
+  list_keys (ctx, keys, &nkeys);
+  for (i = j = 0; i < nall_keys; i++)
+    {
+      if (!match (filter, all_keys[i]))
+        continue;
+      if (j == nkeys || strcmp (keys[j]->fpr, all_keys[i]->fpr))
+        {
+          fprintf (stderr, "%s:%i: Key %s missing in filtered listing\n",
+                   PGM, line, all_keys[i]->fpr);
+          exit (1);
+        }
+      j++;
+    }
+  if (j != nkeys)
+    {
+      fprintf (stderr, "%s:%i: Unexpected key %s in filtered listing\n",
+               PGM, line, keys[j]->fpr);
+      exit (1);
+    }
+  for (i = 0; i < nkeys; i++)
+    gpgme_key_unref (keys[i]);
+  return nkeys;
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  gpgme_ctx_t ctx;
+  gpgme_error_t err;
+  struct _gpgme_keylist_filter filter;
+  int n, i;
+
+  (void)argc;
+  (void)argv;
+
+  init_gpgme (GPGME_PROTOCOL_OpenPGP);
+
+  err = gpgme_new (&ctx);
+  fail_if_err (err);
+  gpgme_set_keylist_mode (ctx, (GPGME_KEYLIST_MODE_LOCAL
+                                | GPGME_KEYLIST_MODE_WITH_SECRET));
+  list_keys (ctx, all_keys, &nall_keys);
+
+  memset (&filter, 0, sizeof filter);
+  if (check_filter (ctx, &filter, __LINE__) != nall_keys)
+    {
+      fprintf (stderr, "%s:%i: Empty filter skipped keys\n", PGM, __LINE__);
+      exit (1);
+    }
+
+  filter.can_encrypt = 1;
+  filter.not_expired = 1;
+  filter.not_revoked = 1;
+  filter.secret = 1;
+  n = check_filter (ctx, &filter, __LINE__);
+  if (!n || n == nall_keys)
+    {
+      fprintf (stderr, "%s:%i: Filter did not select a proper subset (%d)\n",
+               PGM, __LINE__, n);
+      exit (1);
+    }
+
+  memset (&filter, 0, sizeof filter);
+  filter.can_sign = 1;
+  filter.min_validity = GPGME_VALIDITY_FULL;
+  check_filter (ctx, &filter, __LINE__);
+
+  memset (&filter, 0, sizeof filter);
+  filter.uid_regex = "^ALPHA";
+  if (check_filter (ctx, &filter, __LINE__) != 1)
+    {
+      fprintf (stderr, "%s:%i: User ID filter failed\n", PGM, __LINE__);
+      exit (1);
+    }
+
+  memset (&filter, 0, sizeof filter);
+  filter.expires_after = 0x7fffffff;
+  check_filter (ctx, &filter, __LINE__);
+
+  /* An invalid regular expression is rejected and keeps the old
+     filter.  */
+  filter.uid_regex = "(";
+  err = gpgme_set_keylist_filter (ctx, &filter);
+  if (gpgme_err_code (err) != GPG_ERR_INV_VALUE)
+    {
+      fprintf (stderr, "%s:%i: Invalid regex accepted: %s\n",
+               PGM, __LINE__, gpgme_strerror (err));
+      exit (1);
+    }
+
+  for (i = 0; i < nall_keys; i++)
+    gpgme_key_unref (all_keys[i]);
+  gpgme_release (ctx);
+  return 0;
+}
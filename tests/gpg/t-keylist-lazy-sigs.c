@@ -0,0 +1,224 @@
+/* t-keylist-lazy-sigs.c - Regression test.
+ * Copyright (C) 2021 g10 Code GmbH
+ *
+ * This file is part of GPGME.
+ *
+ * GPGME is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * GPGME is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <https://gnu.org/licenses/>.
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* Compare the signatures parsed on demand with those of a normal key
+   listing.  */
+
+/* We need to include config.h so that we know whether we are building
+   with large file system (LFS) support. */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <gpgme.h>
+
+#define PGM "t-keylist-lazy-sigs"
+#include "t-support.h"
+
+
+static gpgme_ctx_t
+new_ctx (int lazy)
+{
+  gpgme_ctx_t ctx;
+  gpgme_error_t err;
+
+  err = gpgme_new (&ctx);
+  fail_if_err (err);
+  err = gpgme_set_keylist_mode (ctx, (GPGME_KEYLIST_MODE_LOCAL
+                                      | GPGME_KEYLIST_MODE_SIGS
+                                      | GPGME_KEYLIST_MODE_SIG_NOTATIONS));
+  fail_if_err (err);
+  if (lazy)
+    {
+      err = gpgme_set_ctx_flag (ctx, "lazy-key-sigs", "1");
+      fail_if_err (err);
+      if (strcmp (gpgme_get_ctx_flag (ctx, "lazy-key-sigs"), "1"))
+        {
+          fprintf (stderr, "%s:%i: Flag not set\n", PGM, __LINE__);
+          exit (1);
+        }
+    }
+  return ctx;
+}
+
+
+static int
+str_equal (const char *a, const char *b)
+{
+  return (!a && !b) || (a && b && !strcmp (a, b));
+}
+
+
+static void
+compare_sigs (gpgme_key_sig_t a, gpgme_key_sig_t b, const char *fpr)
+{
+  gpgme_sig_notation_t na, nb;
+
+  for (; a && b; a = a->next, b = b->next)
+    {
+      if (a->pubkey_algo != b->pubkey_algo
+          || strcmp (a->keyid, b->keyid)
+          || a->timestamp != b->timestamp
+          || a->expires != b->expires
+          || a->status != b->status
+          || a->sig_class != b->sig_class
+          || a->revoked != b->revoked
+          || a->exportable != b->exportable
+          || !str_equal (a->uid, b->uid)
+          || !str_equal (a->name, b->name)
+          || !str_equal (a->email, b->email)
+          || !str_equal (a->comment, b->comment))
+        {
+          fprintf (stderr, "%s:%i: Signature %s on key %s differs\n",
+                   PGM, __LINE__, a->keyid, fpr);
+          exit (1);
+        }
+      for (na = a->notations, nb = b->notations; na && nb;
+           na = na->next, nb = nb->next)
+        if (!str_equal (na->name, nb->name)
+            || !str_equal (na->value, nb->value)
+            || na->flags != nb->flags)
+          {
+            fprintf (stderr, "%s:%i: Notation on key %s differs\n",
+                     PGM, __LINE__, fpr);
+            exit (1);
+          }
+      if (na || nb)
+        {
+          fprintf (stderr, "%s:%i: Number of notations on key %s differs\n",
+                   PGM, __LINE__, fpr);
+          exit (1);
+        }
+    }
+  if (a || b)
+    {
+      fprintf (stderr, "%s:%i: Number of signatures on key %s differs\n",
+               PGM, __LINE__, fpr);
+      exit (1);
+    }
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  gpgme_ctx_t ctx, lazy_ctx;
+  gpgme_error_t err, lazy_err;
+  gpgme_key_t key, lazy_key;
+  gpgme_user_id_t uid, lazy_uid;
+  gpgme_key_sig_t sigs;
+  int nsigs = 0;
+
+  (void)argc;
+  (void)argv;
+
+  init_gpgme (GPGME_PROTOCOL_OpenPGP);
+
+  ctx = new_ctx (0);
+  lazy_ctx = new_ctx (1);
+
+  err = gpgme_op_keylist_start (ctx, NULL, 0);
+  fail_if_err (err);
+  err = gpgme_op_keylist_start (lazy_ctx, NULL, 0);
+  fail_if_err (err);
+
+  for (;;)
+    {
+      err = gpgme_op_keylist_next (ctx, &key);
+      lazy_err = gpgme_op_keylist_next (lazy_ctx, &lazy_key);
+      if (gpgme_err_code (err) == GPG_ERR_EOF
+          && gpgme_err_code (lazy_err) == GPG_ERR_EOF)
+        break;
+      fail_if_err (err);
+      fail_if_err (lazy_err);
+      if (strcmp (key->fpr, lazy_key->fpr))
+        {
+          fprintf (stderr, "%s:%i: Keys differ\n", PGM, __LINE__);
+          exit (1);
+        }
+
+      for (uid = key->uids, lazy_uid = lazy_key->uids; uid && lazy_uid;
+           uid = uid->next, lazy_uid = lazy_uid->next)
+        {
+          /* Nothing has been parsed yet.  */
+          if (lazy_uid->signatures)
+            {
+              fprintf (stderr, "%s:%i: Signatures parsed too early\n",
+                       PGM, __LINE__);
+              exit (1);
+            }
+
+          err = gpgme_key_get_signatures (lazy_key, lazy_uid, &sigs);
+          fail_if_err (err);
+          if (sigs != lazy_uid->signatures)
+            {
+              fprintf (stderr, "%s:%i: Signatures not stored\n",
+                       PGM, __LINE__);
+              exit (1);
+            }
+          compare_sigs (uid->signatures, sigs, key->fpr);
+
+          /* A second call returns the same list.  */
+          err = gpgme_key_get_signatures (lazy_key, lazy_uid, &sigs);
+          fail_if_err (err);
+          if (sigs != lazy_uid->signatures)
+            {
+              fprintf (stderr, "%s:%i: Signatures parsed twice\n",
+                       PGM, __LINE__);
+              exit (1);
+            }
+
+          /* Without the flag the signatures are returned as is.  */
+          err = gpgme_key_get_signatures (key, uid, &sigs);
+          fail_if_err (err);
+          if (sigs != uid->signatures)
+            {
+              fprintf (stderr, "%s:%i: Unexpected signatures\n",
+                       PGM, __LINE__);
+              exit (1);
+            }
+          for (; sigs; sigs = sigs->next)
+            nsigs++;
+        }
+      if (uid || lazy_uid)
+        {
+          fprintf (stderr, "%s:%i: Number of user IDs differs\n",
+                   PGM, __LINE__);
+          exit (1);
+        }
+
+      gpgme_key_unref (key);
+      gpgme_key_unref (lazy_key);
+    }
+
+  if (!nsigs)
+    {
+      fprintf (stderr, "%s:%i: No signatures listed\n", PGM, __LINE__);
+      exit (1);
+    }
+
+  gpgme_release (ctx);
+  gpgme_release (lazy_ctx);
+  return 0;
+}
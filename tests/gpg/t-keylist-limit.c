@@ -0,0 +1,127 @@
+/* t-keylist-limit.c - Regression test.
+ * Copyright (C) 2021 g10 Code GmbH
+ *
+ * This file is part of GPGME.
+ *
+ * GPGME is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * GPGME is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <https://gnu.org/licenses/>.
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* We need to include config.h so that we know whether we are building
+   with large file system (LFS) support. */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <gpgme.h>
+
+#define PGM "t-keylist-limit"
+#include "t-support.h"
+
+
+/* List the keys in CTX and return their number.  */
+static int
+count_keys (gpgme_ctx_t ctx)
+{
+  gpgme_error_t err;
+  gpgme_key_t key;
+  int n = 0;
+
+  err = gpgme_op_keylist_start (ctx, NULL, 0);
+  fail_if_err (err);
+  while (!(err = gpgme_op_keylist_next (ctx, &key)))
+    {
+      gpgme_key_unref (key);
+      n++;
+    }
+  if (gpgme_err_code (err) != GPG_ERR_EOF)
+    fail_if_err (err);
+  err = gpgme_op_keylist_end (ctx);
+  fail_if_err (err);
+  return n;
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  gpgme_ctx_t ctx;
+  gpgme_error_t err;
+  gpgme_key_t key;
+  int total, n;
+
+  (void)argc;
+  (void)argv;
+
+  init_gpgme (GPGME_PROTOCOL_OpenPGP);
+
+  err = gpgme_new (&ctx);
+  fail_if_err (err);
+
+  total = count_keys (ctx);
+  if (total < 3)
+    {
+      fprintf (stderr, "%s:%i: Too few keys (%d)\n", PGM, __LINE__, total);
+      exit (1);
+    }
+
+  /* The limit stops the listing.  */
+  err = gpgme_set_ctx_flag (ctx, "keylist-limit", "2");
+  fail_if_err (err);
+  if (strcmp (gpgme_get_ctx_flag (ctx, "keylist-limit"), "2"))
+    {
+      fprintf (stderr, "%s:%i: Flag not set\n", PGM, __LINE__);
+      exit (1);
+    }
+  n = count_keys (ctx);
+  if (n != 2)
+    {
+      fprintf (stderr, "%s:%i: Got %d keys instead of 2\n", PGM, __LINE__, n);
+      exit (1);
+    }
+
+  /* Ending a listing early stops the engine; the context can be used
+     for the next listing.  */
+  err = gpgme_set_ctx_flag (ctx, "keylist-limit", "0");
+  fail_if_err (err);
+  err = gpgme_op_keylist_start (ctx, NULL, 0);
+  fail_if_err (err);
+  err = gpgme_op_keylist_next (ctx, &key);
+  fail_if_err (err);
+  gpgme_key_unref (key);
+  err = gpgme_op_keylist_end (ctx);
+  fail_if_err (err);
+  err = gpgme_op_keylist_next (ctx, &key);
+  if (gpgme_err_code (err) != GPG_ERR_EOF)
+    {
+      fprintf (stderr, "%s:%i: Listing not ended: %s\n",
+               PGM, __LINE__, gpgme_strerror (err));
+      exit (1);
+    }
+
+  n = count_keys (ctx);
+  if (n != total)
+    {
+      fprintf (stderr, "%s:%i: Got %d keys instead of %d\n",
+               PGM, __LINE__, n, total);
+      exit (1);
+    }
+
+  gpgme_release (ctx);
+  return 0;
+}
@@ -0,0 +1,142 @@
+/* t-keylist-records.c - Regression test.
+ * Copyright (C) 2021 g10 Code GmbH
+ *
+ * This file is part of GPGME.
+ *
+ * GPGME is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * GPGME is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <https://gnu.org/licenses/>.
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* Compare the key records with the keys of a full key listing.  */
+
+/* We need to include config.h so that we know whether we are building
+   with large file system (LFS) support. */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <gpgme.h>
+
+#define PGM "t-keylist-records"
+#include "t-support.h"
+
+
+static void
+check_record (gpgme_keylist_records_result_t result, size_t idx,
+              gpgme_key_t key, unsigned int fields)
+{
+  gpgme_key_record_t rec = result->records + idx;
+  const char *uid = result->strings + rec->uid;
+
+  if (strcmp (rec->fpr, (fields & GPGME_KEYREC_FPR)? key->fpr : "")
+      || strcmp (rec->keyid,
+                 (fields & GPGME_KEYREC_KEYID)? key->subkeys->keyid : "")
+      || strcmp (uid, (fields & GPGME_KEYREC_UID)? key->uids->uid : ""))
+    {
+      fprintf (stderr, "%s:%i: Record %u does not match key %s:"
+               " %s %s <%s>\n", PGM, __LINE__, (unsigned int)idx,
+               key->fpr, rec->fpr, rec->keyid, uid);
+      exit (1);
+    }
+
+  if ((fields & GPGME_KEYREC_FLAGS)
+      && (rec->revoked != key->revoked || rec->expired != key->expired
+          || rec->disabled != key->disabled || rec->invalid != key->invalid
+          || rec->can_encrypt != key->can_encrypt
+          || rec->can_sign != key->can_sign
+          || rec->can_certify != key->can_certify
+          || rec->can_authenticate != key->can_authenticate
+          || rec->secret != key->secret))
+    {
+      fprintf (stderr, "%s:%i: Flags of record %u do not match key %s\n",
+               PGM, __LINE__, (unsigned int)idx, key->fpr);
+      exit (1);
+    }
+}
+
+
+/* List the keys as records in CTX and compare them with a full key
+   listing in LISTCTX.  */
+static void
+check_listing (gpgme_ctx_t ctx, gpgme_ctx_t listctx, int secret_only,
+               unsigned int fields)
+{
+  gpgme_error_t err;
+  gpgme_keylist_records_result_t result;
+  gpgme_key_t key;
+  size_t n = 0;
+
+  err = gpgme_op_keylist_records (ctx, NULL, secret_only, fields);
+  fail_if_err (err);
+  result = gpgme_op_keylist_records_result (ctx);
+  if (!result || !result->strings || *result->strings)
+    {
+      fprintf (stderr, "%s:%i: Invalid result\n", PGM, __LINE__);
+      exit (1);
+    }
+
+  err = gpgme_op_keylist_start (listctx, NULL, secret_only);
+  fail_if_err (err);
+  while (!(err = gpgme_op_keylist_next (listctx, &key)))
+    {
+      if (n >= result->nrecords)
+        {
+          fprintf (stderr, "%s:%i: Too few records\n", PGM, __LINE__);
+          exit (1);
+        }
+      check_record (result, n++, key, fields);
+      gpgme_key_unref (key);
+    }
+  if (gpgme_err_code (err) != GPG_ERR_EOF)
+    fail_if_err (err);
+  if (n != result->nrecords || !n)
+    {
+      fprintf (stderr, "%s:%i: Got %u records for %u keys\n", PGM, __LINE__,
+               (unsigned int)result->nrecords, (unsigned int)n);
+      exit (1);
+    }
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  gpgme_ctx_t ctx, listctx;
+  gpgme_error_t err;
+  unsigned int all = (GPGME_KEYREC_FPR | GPGME_KEYREC_KEYID
+                      | GPGME_KEYREC_UID | GPGME_KEYREC_FLAGS);
+
+  (void)argc;
+  (void)argv;
+
+  init_gpgme (GPGME_PROTOCOL_OpenPGP);
+
+  err = gpgme_new (&ctx);
+  fail_if_err (err);
+  err = gpgme_new (&listctx);
+  fail_if_err (err);
+
+  check_listing (ctx, listctx, 0, all);
+  check_listing (ctx, listctx, 1, all);
+  check_listing (ctx, listctx, 0, GPGME_KEYREC_FPR);
+  check_listing (ctx, listctx, 0, GPGME_KEYREC_UID | GPGME_KEYREC_KEYID);
+
+  gpgme_release (listctx);
+  gpgme_release (ctx);
+  return 0;
+}
@@ -0,0 +1,157 @@
+/* t-progress.c - Regression test.
+ * Copyright (C) 2021 g10 Code GmbH
+ *
+ * This file is part of GPGME.
+ *
+ * GPGME is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * GPGME is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <https://gnu.org/licenses/>.
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* We need to include config.h so that we know whether we are building
+   with large file system (LFS) support. */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <gpgme.h>
+
+#define PGM "t-progress"
+#include "t-support.h"
+
+
+struct progress_parms
+{
+  int calls;
+  int current;
+};
+
+
+static void
+progress_cb (void *opaque, const char *what, int type, int current, int total)
+{
+  struct progress_parms *parms = opaque;
+
+  (void)what;
+  (void)type;
+  (void)total;
+
+  parms->calls++;
+  parms->current = current;
+}
+
+
+/* Encrypt NBYTES of data with the progress policy given by INTERVAL
+   and DELTA and return the number of calls of the progress callback.
+   The last current value is stored at R_CURRENT.  */
+static int
+encrypt_with_progress (size_t nbytes, const char *interval, const char *delta,
+                       int *r_current)
+{
+  gpgme_ctx_t ctx;
+  gpgme_error_t err;
+  gpgme_data_t in, out;
+  gpgme_key_t key[2] = { NULL, NULL };
+  struct progress_parms parms;
+  char *buffer;
+
+  buffer = calloc (1, nbytes);
+  if (!buffer)
+    {
+      fprintf (stderr, "%s:%d: out of core\n", __FILE__, __LINE__);
+      exit (1);
+    }
+
+  err = gpgme_new (&ctx);
+  fail_if_err (err);
+  gpgme_set_armor (ctx, 0);
+  memset (&parms, 0, sizeof parms);
+  gpgme_set_progress_cb (ctx, progress_cb, &parms);
+  err = gpgme_set_ctx_flag (ctx, "progress-interval", interval);
+  fail_if_err (err);
+  err = gpgme_set_ctx_flag (ctx, "progress-delta", delta);
+  fail_if_err (err);
+  if (strcmp (gpgme_get_ctx_flag (ctx, "progress-interval"), interval)
+      || strcmp (gpgme_get_ctx_flag (ctx, "progress-delta"), delta))
+    {
+      fprintf (stderr, "%s:%d: flags not set\n", __FILE__, __LINE__);
+      exit (1);
+    }
+
+  err = gpgme_get_key (ctx, "A0FF4590BB6122EDEF6E3C542D727CC768697734",
+		       &key[0], 0);
+  fail_if_err (err);
+
+  err = gpgme_data_new_from_mem (&in, buffer, nbytes, 0);
+  fail_if_err (err);
+  err = gpgme_data_new (&out);
+  fail_if_err (err);
+
+  err = gpgme_op_encrypt (ctx, key, GPGME_ENCRYPT_ALWAYS_TRUST, in, out);
+  fail_if_err (err);
+
+  gpgme_key_unref (key[0]);
+  gpgme_data_release (in);
+  gpgme_data_release (out);
+  gpgme_release (ctx);
+  free (buffer);
+  *r_current = parms.current;
+  return parms.calls;
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  size_t nbytes = 4 * 1024 * 1024;
+  int all, by_interval, by_delta;
+  int current, current_interval, current_delta;
+
+  if (argc > 1)
+    nbytes = atoi (argv[1]);
+
+  init_gpgme (GPGME_PROTOCOL_OpenPGP);
+
+  all = encrypt_with_progress (nbytes, "0", "0", &current);
+  by_interval = encrypt_with_progress (nbytes, "3600000", "0",
+                                       &current_interval);
+  by_delta = encrypt_with_progress (nbytes, "0", "1024", &current_delta);
+
+  printf ("progress events: all=%d interval=%d delta=%d\n",
+          all, by_interval, by_delta);
+
+  /* gpg itself emits about one event per second, thus the numbers
+     of the other runs can't be compared with ALL.  With an interval
+     of one hour only the first and the last event of the item are
+     passed.  */
+  if (!all || by_interval > 2)
+    {
+      fprintf (stderr, "%s:%d: %d of %d progress events with interval\n",
+               __FILE__, __LINE__, by_interval, all);
+      exit (1);
+    }
+
+  /* The final value is never dropped.  */
+  if (current_interval != current || current_delta != current)
+    {
+      fprintf (stderr, "%s:%d: final values %d and %d instead of %d\n",
+               __FILE__, __LINE__, current_interval, current_delta, current);
+      exit (1);
+    }
+
+  return 0;
+}
@@ -0,0 +1,113 @@
+/* t-verify-batch.c - Regression test.
+ * Copyright (C) 2021 g10 Code GmbH
+ *
+ * This file is part of GPGME.
+ *
+ * GPGME is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * GPGME is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <https://gnu.org/licenses/>.
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* We need to include config.h so that we know whether we are building
+   with large file system (LFS) support. */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <gpgme.h>
+
+#define PGM "t-verify-batch"
+#include "t-support.h"
+
+
+
+
+static const char test_text1[] = "Just GNU it!\n";
+static const char test_text1f[]= "Just GNU it?\n";
+static const char test_sig1[] =
+"-----BEGIN PGP SIGNATURE-----\n"
+"\n"
+"iN0EABECAJ0FAjoS+i9FFIAAAAAAAwA5YmFyw7bDpMO8w58gZGFzIHdhcmVuIFVt\n"
+"bGF1dGUgdW5kIGpldHp0IGVpbiBwcm96ZW50JS1aZWljaGVuNRSAAAAAAAgAJGZv\n"
+"b2Jhci4xdGhpcyBpcyBhIG5vdGF0aW9uIGRhdGEgd2l0aCAyIGxpbmVzGhpodHRw\n"
+"Oi8vd3d3Lmd1Lm9yZy9wb2xpY3kvAAoJEC1yfMdoaXc0JBIAoIiLlUsvpMDOyGEc\n"
+"dADGKXF/Hcb+AKCJWPphZCphduxSvrzH0hgzHdeQaA==\n"
+"=nts1\n"
+"-----END PGP SIGNATURE-----\n";
+
+#define NITEMS 7
+
+
+int
+main (int argc, char *argv[])
+{
+  gpgme_ctx_t ctx;
+  gpgme_error_t err;
+  struct _gpgme_verify_batch_item items[NITEMS];
+  gpgme_signature_t sig;
+  gpgme_err_code_t expected;
+  int i;
+
+  (void)argc;
+  (void)argv;
+
+  init_gpgme (GPGME_PROTOCOL_OpenPGP);
+
+  err = gpgme_new (&ctx);
+  fail_if_err (err);
+
+  /* Every third text is modified and must not verify.  */
+  memset (items, 0, sizeof items);
+  for (i = 0; i < NITEMS; i++)
+    {
+      err = gpgme_data_new_from_mem (&items[i].sig, test_sig1,
+                                     strlen (test_sig1), 0);
+      fail_if_err (err);
+      if (i % 3 == 2)
+        err = gpgme_data_new_from_mem (&items[i].signed_text, test_text1f,
+                                       strlen (test_text1f), 0);
+      else
+        err = gpgme_data_new_from_mem (&items[i].signed_text, test_text1,
+                                       strlen (test_text1), 0);
+      fail_if_err (err);
+    }
+
+  err = gpgme_op_verify_batch (ctx, items, NITEMS, 3);
+  fail_if_err (err);
+
+  for (i = 0; i < NITEMS; i++)
+    {
+      fail_if_err (items[i].err);
+      expected = (i % 3 == 2)? GPG_ERR_BAD_SIGNATURE : GPG_ERR_NO_ERROR;
+      sig = items[i].result? items[i].result->signatures : NULL;
+      if (!sig || sig->next
+          || gpgme_err_code (sig->status) != expected
+          || strlen (sig->fpr) < 16
+          || strcmp (sig->fpr + strlen (sig->fpr) - 16, "2D727CC768697734"))
+        {
+          fprintf (stderr, "%s:%i: Unexpected result for item %d\n",
+                   PGM, __LINE__, i);
+          exit (1);
+        }
+      gpgme_result_unref (items[i].result);
+      gpgme_data_release (items[i].sig);
+      gpgme_data_release (items[i].signed_text);
+    }
+
+  gpgme_release (ctx);
+  return 0;
+}
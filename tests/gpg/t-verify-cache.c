@@ -0,0 +1,163 @@
+/* t-verify-cache.c - Regression test.
+ * Copyright (C) 2021 g10 Code GmbH
+ *
+ * This file is part of GPGME.
+ *
+ * GPGME is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * GPGME is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <https://gnu.org/licenses/>.
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* We need to include config.h so that we know whether we are building
+   with large file system (LFS) support. */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <gpgme.h>
+
+#define PGM "t-verify-cache"
+#include "t-support.h"
+
+
+
+
+static const char test_text1[] = "Just GNU it!\n";
+static const char test_text1f[]= "Just GNU it?\n";
+static const char test_sig1[] =
+"-----BEGIN PGP SIGNATURE-----\n"
+"\n"
+"iN0EABECAJ0FAjoS+i9FFIAAAAAAAwA5YmFyw7bDpMO8w58gZGFzIHdhcmVuIFVt\n"
+"bGF1dGUgdW5kIGpldHp0IGVpbiBwcm96ZW50JS1aZWljaGVuNRSAAAAAAAgAJGZv\n"
+"b2Jhci4xdGhpcyBpcyBhIG5vdGF0aW9uIGRhdGEgd2l0aCAyIGxpbmVzGhpodHRw\n"
+"Oi8vd3d3Lmd1Lm9yZy9wb2xpY3kvAAoJEC1yfMdoaXc0JBIAoIiLlUsvpMDOyGEc\n"
+"dADGKXF/Hcb+AKCJWPphZCphduxSvrzH0hgzHdeQaA==\n"
+"=nts1\n"
+"-----END PGP SIGNATURE-----\n";
+
+
+static void
+check_stats (unsigned long hits, unsigned long misses, unsigned int entries)
+{
+  gpgme_error_t err;
+  struct _gpgme_verify_cache_stats stats;
+
+  err = gpgme_verify_cache_get_stats (&stats);
+  fail_if_err (err);
+  if (stats.hits != hits || stats.misses != misses
+      || stats.entries != entries)
+    {
+      fprintf (stderr, "%s:%i: Unexpected stats: "
+               "hits=%lu misses=%lu entries=%u\n",
+               PGM, __LINE__, stats.hits, stats.misses, stats.entries);
+      exit (1);
+    }
+}
+
+
+static void
+verify_once (gpgme_ctx_t ctx, const char *text, gpgme_err_code_t expected)
+{
+  gpgme_error_t err;
+  gpgme_data_t sig, data;
+  gpgme_verify_result_t result;
+  gpgme_signature_t signature;
+  gpgme_sig_notation_t nota;
+  int nnotations = 0;
+
+  err = gpgme_data_new_from_mem (&data, text, strlen (text), 0);
+  fail_if_err (err);
+  err = gpgme_data_new_from_mem (&sig, test_sig1, strlen (test_sig1), 0);
+  fail_if_err (err);
+  err = gpgme_op_verify (ctx, sig, data, NULL);
+  fail_if_err (err);
+  result = gpgme_op_verify_result (ctx);
+  signature = result? result->signatures : NULL;
+  if (signature)
+    for (nota = signature->notations; nota; nota = nota->next)
+      nnotations++;
+  if (!signature || signature->next
+      || gpgme_err_code (signature->status) != expected
+      || !signature->fpr
+      || (expected == GPG_ERR_NO_ERROR && nnotations != 3))
+    {
+      fprintf (stderr, "%s:%i: Unexpected verify result: %s (%d notations)\n",
+               PGM, __LINE__,
+               signature? gpgme_strerror (signature->status) : "none",
+               nnotations);
+      exit (1);
+    }
+  gpgme_data_release (sig);
+  gpgme_data_release (data);
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  gpgme_ctx_t ctx;
+  gpgme_error_t err;
+
+  (void)argc;
+  (void)argv;
+
+  init_gpgme (GPGME_PROTOCOL_OpenPGP);
+
+  err = gpgme_new (&ctx);
+  fail_if_err (err);
+
+  /* Without the flag the cache is not used.  */
+  verify_once (ctx, test_text1, GPG_ERR_NO_ERROR);
+  check_stats (0, 0, 0);
+
+  err = gpgme_set_ctx_flag (ctx, "verify-cache", "600");
+  fail_if_err (err);
+  if (strcmp (gpgme_get_ctx_flag (ctx, "verify-cache"), "600"))
+    {
+      fprintf (stderr, "%s:%i: Flag not set\n", PGM, __LINE__);
+      exit (1);
+    }
+  verify_once (ctx, test_text1, GPG_ERR_NO_ERROR);
+  check_stats (0, 1, 1);
+  verify_once (ctx, test_text1, GPG_ERR_NO_ERROR);
+  check_stats (1, 1, 1);
+
+  /* Different data is a different entry.  */
+  verify_once (ctx, test_text1f, GPG_ERR_BAD_SIGNATURE);
+  check_stats (1, 2, 2);
+  verify_once (ctx, test_text1f, GPG_ERR_BAD_SIGNATURE);
+  check_stats (2, 2, 2);
+
+  gpgme_verify_cache_clear ();
+  check_stats (2, 2, 0);
+  verify_once (ctx, test_text1, GPG_ERR_NO_ERROR);
+  check_stats (2, 3, 1);
+
+  /* Flags which change the result are part of the key.  */
+  err = gpgme_set_ctx_flag (ctx, "raw-description", "1");
+  fail_if_err (err);
+  verify_once (ctx, test_text1, GPG_ERR_NO_ERROR);
+  check_stats (2, 4, 2);
+  verify_once (ctx, test_text1, GPG_ERR_NO_ERROR);
+  check_stats (3, 4, 2);
+  gpgme_set_offline (ctx, 1);
+  verify_once (ctx, test_text1, GPG_ERR_NO_ERROR);
+  check_stats (3, 5, 3);
+
+  gpgme_release (ctx);
+  return 0;
+}
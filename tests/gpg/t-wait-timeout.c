@@ -0,0 +1,325 @@
+/* t-wait-timeout.c - Regression test.
+ * Copyright (C) 2021 g10 Code GmbH
+ *
+ * This file is part of GPGME.
+ *
+ * GPGME is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * GPGME is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <https://gnu.org/licenses/>.
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* Tests the "timeout" context flag and the wakeup of a blocking
+   operation by gpgme_cancel_async.  A fake engine which never answers
+   is used for that, also for the workers of gpgme_op_verify_batch.
+   Also checks that a wait does not stall after the engine closed its
+   file descriptors.  */
+
+/* We need to include config.h so that we know whether we are building
+   with large file system (LFS) support. */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <pthread.h>
+
+#include <gpgme.h>
+
+#define PGM "t-wait-timeout"
+#include "t-support.h"
+
+
+/* The fake engine: it reports a version and otherwise keeps its file
+   descriptors open for a while without writing a status line.  */
+static const char fake_engine[] =
+  "#!/bin/sh\n"
+  "if [ \"$1\" = \"--version\" ]; then\n"
+  "  echo 'gpg (GnuPG) 2.2.27'\n"
+  "  exit 0\n"
+  "fi\n"
+  "exec sleep 10\n";
+
+#define FAKE_ENGINE "./t-wait-timeout-engine"
+
+
+static long
+now_ms (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec * 1000L + tv.tv_usec / 1000;
+}
+
+
+static void
+write_fake_engine (void)
+{
+  FILE *fp;
+
+  fp = fopen (FAKE_ENGINE, "w");
+  if (!fp || fputs (fake_engine, fp) == EOF || fclose (fp))
+    {
+      fprintf (stderr, "%s:%d: can't write %s\n",
+               __FILE__, __LINE__, FAKE_ENGINE);
+      exit (1);
+    }
+  chmod (FAKE_ENGINE, 0755);
+}
+
+
+/* Return a new context using the fake engine.  */
+static gpgme_ctx_t
+new_fake_context (void)
+{
+  gpgme_ctx_t ctx;
+  gpgme_error_t err;
+
+  err = gpgme_new (&ctx);
+  fail_if_err (err);
+  err = gpgme_ctx_set_engine_info (ctx, GPGME_PROTOCOL_OpenPGP,
+                                   FAKE_ENGINE, NULL);
+  fail_if_err (err);
+  return ctx;
+}
+
+
+/* Run a symmetric encryption with the fake engine in CTX and return
+   its error code.  */
+static gpgme_error_t
+run_encrypt (gpgme_ctx_t ctx)
+{
+  gpgme_error_t err;
+  gpgme_data_t in, out;
+
+  err = gpgme_data_new_from_mem (&in, "Hallo Leute\n", 12, 0);
+  fail_if_err (err);
+  err = gpgme_data_new (&out);
+  fail_if_err (err);
+
+  err = gpgme_op_encrypt (ctx, NULL, 0, in, out);
+
+  gpgme_data_release (in);
+  gpgme_data_release (out);
+  return err;
+}
+
+
+static void
+check_timeout (void)
+{
+  gpgme_ctx_t ctx;
+  gpgme_error_t err;
+  long start, elapsed;
+
+  ctx = new_fake_context ();
+  err = gpgme_set_ctx_flag (ctx, "timeout", "300");
+  fail_if_err (err);
+  if (strcmp (gpgme_get_ctx_flag (ctx, "timeout"), "300"))
+    {
+      fprintf (stderr, "%s:%d: timeout flag is %s\n",
+               __FILE__, __LINE__, gpgme_get_ctx_flag (ctx, "timeout"));
+      exit (1);
+    }
+
+  start = now_ms ();
+  err = run_encrypt (ctx);
+  elapsed = now_ms () - start;
+  if (gpgme_err_code (err) != GPG_ERR_TIMEOUT)
+    {
+      fprintf (stderr, "%s:%d: expected a timeout but got: %s\n",
+               __FILE__, __LINE__, gpgme_strerror (err));
+      exit (1);
+    }
+  /* The deadline is computed in whole milliseconds and thus may
+     expire up to one millisecond early.  */
+  if (elapsed < 299 || elapsed > 1000)
+    {
+      fprintf (stderr, "%s:%d: timeout of 300ms after %ldms\n",
+               __FILE__, __LINE__, elapsed);
+      exit (1);
+    }
+
+  gpgme_release (ctx);
+}
+
+
+static void *
+cancel_thread (void *arg)
+{
+  gpgme_ctx_t ctx = arg;
+
+  usleep (200 * 1000);
+  gpgme_cancel_async (ctx);
+  return NULL;
+}
+
+
+static void
+check_cancel_async (void)
+{
+  gpgme_ctx_t ctx;
+  gpgme_error_t err;
+  pthread_t thread;
+  long start, elapsed;
+
+  ctx = new_fake_context ();
+
+  start = now_ms ();
+  if (pthread_create (&thread, NULL, cancel_thread, ctx))
+    {
+      fprintf (stderr, "%s:%d: can't create thread\n", __FILE__, __LINE__);
+      exit (1);
+    }
+  err = run_encrypt (ctx);
+  elapsed = now_ms () - start;
+  pthread_join (thread, NULL);
+  if (gpgme_err_code (err) != GPG_ERR_CANCELED)
+    {
+      fprintf (stderr, "%s:%d: expected cancellation but got: %s\n",
+               __FILE__, __LINE__, gpgme_strerror (err));
+      exit (1);
+    }
+  /* Without the wakeup the cancellation is only noticed after the
+     select timeout of one second.  */
+  if (elapsed > 800)
+    {
+      fprintf (stderr, "%s:%d: canceled after 200ms but returned after %ldms\n",
+               __FILE__, __LINE__, elapsed);
+      exit (1);
+    }
+
+  gpgme_release (ctx);
+}
+
+
+static void
+check_cancel_batch (void)
+{
+  gpgme_ctx_t ctx;
+  gpgme_error_t err;
+  pthread_t thread;
+  struct _gpgme_verify_batch_item items[4];
+  long start, elapsed;
+  int i;
+
+  ctx = new_fake_context ();
+  memset (items, 0, sizeof items);
+  for (i = 0; i < 4; i++)
+    {
+      err = gpgme_data_new_from_mem (&items[i].sig, "sig\n", 4, 0);
+      fail_if_err (err);
+      err = gpgme_data_new_from_mem (&items[i].signed_text, "text\n", 5, 0);
+      fail_if_err (err);
+    }
+
+  start = now_ms ();
+  if (pthread_create (&thread, NULL, cancel_thread, ctx))
+    {
+      fprintf (stderr, "%s:%d: can't create thread\n", __FILE__, __LINE__);
+      exit (1);
+    }
+  err = gpgme_op_verify_batch (ctx, items, 4, 2);
+  elapsed = now_ms () - start;
+  pthread_join (thread, NULL);
+  if (gpgme_err_code (err) != GPG_ERR_CANCELED)
+    {
+      fprintf (stderr, "%s:%d: expected cancellation but got: %s\n",
+               __FILE__, __LINE__, gpgme_strerror (err));
+      exit (1);
+    }
+  /* The cancellation must interrupt the select on the workers.  */
+  if (elapsed > 800)
+    {
+      fprintf (stderr, "%s:%d: batch canceled after 200ms but returned"
+               " after %ldms\n", __FILE__, __LINE__, elapsed);
+      exit (1);
+    }
+
+  for (i = 0; i < 4; i++)
+    {
+      if (gpgme_err_code (items[i].err) != GPG_ERR_CANCELED)
+        {
+          fprintf (stderr, "%s:%d: item %d not canceled: %s\n",
+                   __FILE__, __LINE__, i, gpgme_strerror (items[i].err));
+          exit (1);
+        }
+      gpgme_result_unref (items[i].result);
+      gpgme_data_release (items[i].sig);
+      gpgme_data_release (items[i].signed_text);
+    }
+  gpgme_release (ctx);
+}
+
+
+static void
+check_no_stall (void)
+{
+  gpgme_ctx_t ctx;
+  gpgme_error_t err;
+  gpgme_key_t key;
+  long start, elapsed;
+  int n = 0;
+
+  err = gpgme_new (&ctx);
+  fail_if_err (err);
+
+  start = now_ms ();
+  err = gpgme_op_keylist_start (ctx, "alfa@example.net", 0);
+  fail_if_err (err);
+  while (!(err = gpgme_op_keylist_next (ctx, &key)))
+    {
+      gpgme_key_unref (key);
+      n++;
+    }
+  if (gpgme_err_code (err) != GPG_ERR_EOF)
+    fail_if_err (err);
+  elapsed = now_ms () - start;
+  if (n != 1)
+    {
+      fprintf (stderr, "%s:%d: %d keys listed instead of 1\n",
+               __FILE__, __LINE__, n);
+      exit (1);
+    }
+  /* The wakeup fd must not delay the end of the listing until the
+     select timeout of one second.  */
+  if (elapsed > 900)
+    {
+      fprintf (stderr, "%s:%d: listing one key took %ldms\n",
+               __FILE__, __LINE__, elapsed);
+      exit (1);
+    }
+
+  gpgme_release (ctx);
+}
+
+
+int
+main (void)
+{
+  init_gpgme (GPGME_PROTOCOL_OpenPGP);
+  write_fake_engine ();
+
+  check_timeout ();
+  check_cancel_async ();
+  check_cancel_batch ();
+  check_no_stall ();
+
+  remove (FAKE_ENGINE);
+  return 0;
+}
@@ -62,6 +62,7 @@ show_usage (int ex)
          "  --from-wkd       list key from a web key directory\n"
          "  --require-gnupg  required at least the given GnuPG version\n"
          "  --trust-model    use the specified trust-model\n"
+         "  --records        list only fpr, keyid and uid as records\n"
          , stderr);
   exit (ex);
 }
@@ -107,6 +108,7 @@ main (int argc, char **argv)
   int from_wkd = 0;
   gpgme_data_t data = NULL;
   char *trust_model = NULL;
+  int records = 0;
 
 
   if (argc)
@@ -219,6 +221,11 @@ main (int argc, char **argv)
           trust_model = strdup (*argv);
           argc--; argv++;
         }
+      else if (!strcmp (*argv, "--records"))
+        {
+          records = 1;
+          argc--; argv++;
+        }
       else if (!strncmp (*argv, "--", 2))
         show_usage (1);
     }
@@ -251,6 +258,25 @@ main (int argc, char **argv)
       fail_if_err (err);
     }
 
+  if (records)
+    {
+      gpgme_keylist_records_result_t recresult;
+      const char *pattern[2] = { argc? argv[0]:NULL, NULL };
+      size_t i;
+
+      err = gpgme_op_keylist_records (ctx, pattern, only_secret,
+                                      (GPGME_KEYREC_FPR | GPGME_KEYREC_KEYID
+                                       | GPGME_KEYREC_UID));
+      fail_if_err (err);
+      recresult = gpgme_op_keylist_records_result (ctx);
+      for (i = 0; i < recresult->nrecords; i++)
+        printf ("%s %s %s\n", recresult->records[i].keyid,
+                recresult->records[i].fpr,
+                recresult->strings + recresult->records[i].uid);
+      gpgme_release (ctx);
+      return 0;
+    }
+
   if (from_file)
     {
       err = gpgme_data_new_from_file (&data, *argv, 1);
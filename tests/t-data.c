@@ -54,6 +54,7 @@ typedef enum
     TEST_INOUT_MEM_FROM_FILE_PART_BY_NAME,
     TEST_INOUT_MEM_FROM_INEXISTANT_FILE_PART,
     TEST_INOUT_MEM_FROM_FILE_PART_BY_FP,
+    TEST_INOUT_CHUNKED,
     TEST_END
   } round_t;
 
@@ -174,6 +175,29 @@ write_test (round_t round, gpgme_data_t data)
 }
 
 
+/* Check that the segments of DATA hold TEXT2 in chunks of
+   CHUNK_SIZE.  */
+void
+segments_test (round_t round, gpgme_data_t data, size_t chunk_size)
+{
+  gpgme_data_segment_t segs;
+  size_t nsegs, i, off;
+
+  fail_if_err (gpgme_data_get_segments (data, &segs, &nsegs));
+  for (i = off = 0; i < nsegs; off += segs[i++].len)
+    if ((i + 1 < nsegs && segs[i].len != chunk_size)
+        || off + segs[i].len > strlen (text2)
+        || memcmp (segs[i].base, text2 + off, segs[i].len))
+      break;
+  if (i != nsegs || off != strlen (text2))
+    {
+      fprintf (stderr, "%s:%d: (%i) gpgme_data_get_segments returned "
+               "wrong data\n", __FILE__, __LINE__, round);
+      exit (1);
+    }
+}
+
+
 int
 main (void)
 {
@@ -254,6 +278,14 @@ main (void)
 						strlen (text), strlen (text));
 	  }
 	  break;
+	case TEST_INOUT_CHUNKED:
+	  err = gpgme_data_new_chunked (&data, 5);
+	  if (!err
+              && gpgme_data_write (data, text, strlen (text)) != strlen (text))
+	    err = gpgme_error_from_errno (errno);
+	  if (!err)
+	    err = gpgme_data_rewind (data);
+	  break;
 	case TEST_END:
 	  goto out;
 	case TEST_INITIALIZER:
@@ -265,6 +297,8 @@ main (void)
 
       read_test (round, data);
       write_test (round, data);
+      if (round == TEST_INOUT_CHUNKED)
+        segments_test (round, data, 5);
       gpgme_data_release (data);
     }
  out: